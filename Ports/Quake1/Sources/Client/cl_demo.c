@@ -245,6 +245,7 @@ void CL_Record_f()
 		Con_Printf("ERROR: couldn't open.\n");
 		return;
 	}
+	COM_FlushFileCache(); // playdemo may have looked it up before
 
 	cls.forcetrack = track;
 	fprintf(cls.demofile, "%i\n", cls.forcetrack);
@@ -482,6 +482,13 @@ void CL_SendMove(usercmd_t *cmd)
 	if (++cl.movemessages <= 2)
 		return;
 
+	// acknowledge the last complete entity frame so the server can delta from it
+	if (cl.entframe_ack >= 0)
+	{
+		MSG_WriteByte(&buf, clc_ackframe);
+		MSG_WriteLong(&buf, cl.entframe_ack);
+	}
+
 	if (NET_SendUnreliableMessage(cls.netcon, &buf) == -1)
 	{
 		Con_Printf("CL_SendMove: lost server connection\n");
@@ -68,6 +68,7 @@ void CL_ClearState()
 
 	// wipe the entire cl structure
 	memset(&cl, 0, sizeof(cl));
+	cl.entframe_ack = -1;
 
 	SZ_Clear(&cls.message);
 
@@ -80,7 +80,8 @@ char *svc_strings[] =
 	"svc_finale", // [string] music [string] text
 	"svc_cdtrack", // [byte] track [byte] looptrack
 	"svc_sellscreen",
-	"svc_cutscene"
+	"svc_cutscene",
+	"svc_entityframe" // [long] frame [long] delta frame
 };
 
 //=============================================================================
@@ -325,6 +326,69 @@ void CL_ParseServerInfo()
 	noclip_anglehack = false; // noclip is turned off at start
 }
 
+/*
+   ==================
+   CL_ParseEntityFrame
+
+   Start a delta compressed frame, the following updates leave out whatever
+   is unchanged from the frame it deltas from
+   ==================
+ */
+void CL_ParseEntityFrame()
+{
+	int sequence, delta;
+	entframe_t *frame, *base;
+
+	sequence = MSG_ReadLong();
+	delta = MSG_ReadLong();
+
+	cl.entframe_bad = false;
+	base = NULL;
+	if (delta != -1)
+	{
+		base = &cl.entframes[delta & UPDATE_MASK];
+		if (base->sequence != delta || !base->valid || sequence - delta >= UPDATE_BACKUP || cl.next_entstate - base->first > MAX_FRAME_STATES - MAX_PACKET_ENTITIES)
+		{
+			// the server only deltas from frames we acknowledged, so this
+			// frame can't be trusted or acknowledged in turn
+			Con_DPrintf("CL_ParseEntityFrame: delta from invalid frame %i\n", delta);
+			cl.entframe_bad = true;
+			base = NULL;
+		}
+	}
+
+	frame = &cl.entframes[sequence & UPDATE_MASK];
+	frame->sequence = sequence;
+	frame->first = cl.next_entstate;
+	frame->num = 0;
+	frame->valid = false;
+
+	cl.entframe = frame;
+	cl.entbase = base;
+	cl.entbase_index = 0;
+}
+
+/*
+   ==================
+   CL_FinishEntityFrame
+   ==================
+ */
+void CL_FinishEntityFrame()
+{
+	if (!cl.entframe)
+		return;
+
+	if (!cl.entframe_bad)
+	{
+		cl.entframe->valid = true;
+		if (cl.entframe->sequence > cl.entframe_ack)
+			cl.entframe_ack = cl.entframe->sequence;
+	}
+
+	cl.entframe = NULL;
+	cl.entbase = NULL;
+}
+
 /*
    ==================
    CL_ParseUpdate
@@ -345,6 +409,9 @@ void CL_ParseUpdate(int bits)
 	entity_t *ent;
 	int num;
 	int skin;
+	int colormap;
+	entity_state_t *base;
+	packet_entity_t *packet;
 
 	if (cls.signon == SIGNONS - 1) // first update is the final signon stage
 	{
@@ -365,6 +432,17 @@ void CL_ParseUpdate(int bits)
 
 	ent = CL_EntityNum(num);
 
+	// unsent fields come from the delta frame or the baseline
+	base = &ent->baseline;
+	if (cl.entbase)
+	{
+		while (cl.entbase_index < cl.entbase->num && cl.entstates[(cl.entbase->first + cl.entbase_index) % MAX_FRAME_STATES].number < num)
+			cl.entbase_index++;
+		packet = &cl.entstates[(cl.entbase->first + cl.entbase_index) % MAX_FRAME_STATES];
+		if (cl.entbase_index < cl.entbase->num && packet->number == num)
+			base = &packet->state;
+	}
+
 	for (i = 0; i < 16; i++)
 		if (bits & (1 << i))
 			bitcounts[i]++;
@@ -384,7 +462,7 @@ void CL_ParseUpdate(int bits)
 			Host_Error("CL_ParseModel: bad modnum");
 	}
 	else
-		modnum = ent->baseline.modelindex;
+		modnum = base->modelindex;
 
 	model = cl.model_precache[modnum];
 	if (model != ent->model)
@@ -408,25 +486,25 @@ void CL_ParseUpdate(int bits)
 	if (bits & U_FRAME)
 		ent->frame = MSG_ReadByte();
 	else
-		ent->frame = ent->baseline.frame;
+		ent->frame = base->frame;
 
 	if (bits & U_COLORMAP)
-		i = MSG_ReadByte();
+		colormap = MSG_ReadByte();
 	else
-		i = ent->baseline.colormap;
-	if (!i)
+		colormap = base->colormap;
+	if (!colormap)
 		ent->colormap = vid.colormap;
 	else
 	{
-		if (i > cl.maxclients)
+		if (colormap > cl.maxclients)
 			Sys_Error("i >= cl.maxclients");
-		ent->colormap = cl.scores[i - 1].translations;
+		ent->colormap = cl.scores[colormap - 1].translations;
 	}
 
 	if (bits & U_SKIN)
 		skin = MSG_ReadByte();
 	else
-		skin = ent->baseline.skin;
+		skin = base->skin;
 	if (skin != ent->skinnum)
 	{
 		ent->skinnum = skin;
@@ -437,7 +515,7 @@ void CL_ParseUpdate(int bits)
 	if (bits & U_EFFECTS)
 		ent->effects = MSG_ReadByte();
 	else
-		ent->effects = ent->baseline.effects;
+		ent->effects = base->effects;
 
 	// shift the known values for interpolation
 	VectorCopy(ent->msg_origins[0], ent->msg_origins[1]);
@@ -446,29 +524,29 @@ void CL_ParseUpdate(int bits)
 	if (bits & U_ORIGIN1)
 		ent->msg_origins[0][0] = MSG_ReadCoord();
 	else
-		ent->msg_origins[0][0] = ent->baseline.origin[0];
+		ent->msg_origins[0][0] = base->origin[0];
 	if (bits & U_ANGLE1)
 		ent->msg_angles[0][0] = MSG_ReadAngle();
 	else
-		ent->msg_angles[0][0] = ent->baseline.angles[0];
+		ent->msg_angles[0][0] = base->angles[0];
 
 	if (bits & U_ORIGIN2)
 		ent->msg_origins[0][1] = MSG_ReadCoord();
 	else
-		ent->msg_origins[0][1] = ent->baseline.origin[1];
+		ent->msg_origins[0][1] = base->origin[1];
 	if (bits & U_ANGLE2)
 		ent->msg_angles[0][1] = MSG_ReadAngle();
 	else
-		ent->msg_angles[0][1] = ent->baseline.angles[1];
+		ent->msg_angles[0][1] = base->angles[1];
 
 	if (bits & U_ORIGIN3)
 		ent->msg_origins[0][2] = MSG_ReadCoord();
 	else
-		ent->msg_origins[0][2] = ent->baseline.origin[2];
+		ent->msg_origins[0][2] = base->origin[2];
 	if (bits & U_ANGLE3)
 		ent->msg_angles[0][2] = MSG_ReadAngle();
 	else
-		ent->msg_angles[0][2] = ent->baseline.angles[2];
+		ent->msg_angles[0][2] = base->angles[2];
 
 	if (bits & U_NOLERP)
 		ent->forcelink = true;
@@ -481,6 +559,23 @@ void CL_ParseUpdate(int bits)
 		VectorCopy(ent->msg_angles[0], ent->angles);
 		ent->forcelink = true;
 	}
+
+	// keep what we have for the next frame to delta from
+	if (cl.entframe && cl.entframe->num < MAX_PACKET_ENTITIES)
+	{
+		packet = &cl.entstates[cl.next_entstate % MAX_FRAME_STATES];
+		cl.next_entstate++;
+		cl.entframe->num++;
+
+		packet->number = num;
+		packet->state.modelindex = modnum;
+		packet->state.frame = ent->frame;
+		packet->state.colormap = colormap;
+		packet->state.skin = skin;
+		packet->state.effects = ent->effects;
+		VectorCopy(ent->msg_origins[0], packet->state.origin);
+		VectorCopy(ent->msg_angles[0], packet->state.angles);
+	}
 }
 
 /*
@@ -713,6 +808,8 @@ void CL_ParseServerMessage()
 		Con_Printf("------------------\n");
 
 	cl.onground = false; // unless the server says otherwise
+	cl.entframe = NULL;
+	cl.entbase = NULL;
 	//
 	// parse the message
 	//
@@ -728,6 +825,7 @@ void CL_ParseServerMessage()
 		if (cmd == -1)
 		{
 			SHOWNET("END OF MESSAGE");
+			CL_FinishEntityFrame();
 			return; // end of message
 		}
 
@@ -937,6 +1035,10 @@ void CL_ParseServerMessage()
 			SCR_CenterPrint(MSG_ReadString());
 			break;
 
+		case svc_entityframe:
+			CL_ParseEntityFrame();
+			break;
+
 		case svc_sellscreen:
 			Cmd_ExecuteString("help", src_command);
 			break;
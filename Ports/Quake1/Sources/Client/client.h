@@ -24,6 +24,7 @@
 #include "Common/cvar.h"
 #include "Common/common.h"
 #include "Common/mathlib.h"
+#include "Networking/protocol.h"
 #include "Rendering/r_public.h"
 #include "Rendering/r_video.h"
 
@@ -164,6 +165,22 @@ extern client_static_t cls;
 #define MAX_MODELS 256 // these are sent over the net as bytes
 #define MAX_SOUNDS 256 // so they cannot be blindly increased
 
+// entity states of one delta compressed frame (PEXT_DELTA), kept on both
+// sides so updates can leave out what the other end already has
+typedef struct
+{
+	int number;
+	entity_state_t state;
+} packet_entity_t;
+
+typedef struct
+{
+	int sequence;
+	int first; // index of the first state in the state ring
+	int num; // states in this frame, sorted by entity number
+	qboolean valid; // completely received
+} entframe_t;
+
 //
 // the client_state_t structure is wiped completely at every
 // server signon
@@ -247,6 +264,16 @@ typedef struct
 
 	// frag scoreboard
 	scoreboard_t *scores; // [cl.maxclients]
+
+	// delta compressed entity frames
+	entframe_t entframes[UPDATE_BACKUP];
+	packet_entity_t entstates[MAX_FRAME_STATES];
+	int next_entstate;
+	entframe_t *entframe; // frame being parsed, NULL outside svc_entityframe
+	entframe_t *entbase; // frame it deltas from, NULL = baselines
+	int entbase_index; // merge position in entbase
+	qboolean entframe_bad; // delta frame missing, don't keep the result
+	int entframe_ack; // last complete frame, -1 = none
 } client_state_t;
 
 //
@@ -70,6 +70,8 @@ qboolean con_initialized;
 
 int con_notifylines; // scan lines to clear for notify lines
 
+#ifndef DEDICATED_ONLY
+
 extern void M_Main_enter();
 
 void Con_ToggleConsole_f()
@@ -173,6 +175,8 @@ void Con_CheckResize()
 	con_current = con_totallines - 1;
 }
 
+#endif
+
 #define MAXGAMEDIRLEN 1000
 
 void Con_Init()
@@ -189,6 +193,7 @@ void Con_Init()
 		}
 	}
 
+	#ifndef DEDICATED_ONLY
 	con_text = Hunk_AllocName(CON_TEXTSIZE, "context");
 	Q_memset(con_text, ' ', CON_TEXTSIZE);
 	con_linewidth = -1;
@@ -205,9 +210,12 @@ void Con_Init()
 	Cmd_AddCommand("messagemode", Con_MessageMode_f);
 	Cmd_AddCommand("messagemode2", Con_MessageMode2_f);
 	Cmd_AddCommand("clear", Con_Clear_f);
+	#endif
 	con_initialized = true;
 }
 
+#ifndef DEDICATED_ONLY
+
 void Con_Linefeed()
 {
 	con_x = 0;
@@ -296,6 +304,8 @@ void Con_Print(char *txt)
 	}
 }
 
+#endif
+
 void Con_DebugLog(char *file, char *fmt, ...)
 {
 	char data[4096];
@@ -319,7 +329,6 @@ void Con_Printf(char *fmt, ...)
 {
 	va_list argptr;
 	char msg[MAXPRINTMSG];
-	static qboolean inupdate;
 
 	va_start(argptr, fmt);
 	vsprintf(msg, fmt, argptr);
@@ -335,6 +344,7 @@ void Con_Printf(char *fmt, ...)
 	if (!con_initialized)
 		return;
 
+	#ifndef DEDICATED_ONLY
 	if (cls.state == ca_dedicated)
 		return;                         // no graphics mode
 
@@ -344,6 +354,8 @@ void Con_Printf(char *fmt, ...)
 	// update the screen if the console is displayed
 	if (cls.signon != SIGNONS && !scr_disabled_for_loading)
 	{
+		static qboolean inupdate;
+
 		// protect against infinite loop if something in SCR_UpdateScreen calls
 		// Con_Printd
 		if (!inupdate)
@@ -353,6 +365,7 @@ void Con_Printf(char *fmt, ...)
 			inupdate = false;
 		}
 	}
+	#endif
 }
 
 /*
@@ -380,18 +393,23 @@ void Con_SafePrintf(char *fmt, ...)
 {
 	va_list argptr;
 	char msg[1024];
-	int temp;
 
 	va_start(argptr, fmt);
 	vsprintf(msg, fmt, argptr);
 	va_end(argptr);
 
-	temp = scr_disabled_for_loading;
+	#ifdef DEDICATED_ONLY
+	Con_Printf("%s", msg);
+	#else
+	int temp = scr_disabled_for_loading;
 	scr_disabled_for_loading = true;
 	Con_Printf("%s", msg);
 	scr_disabled_for_loading = temp;
+	#endif
 }
 
+#ifndef DEDICATED_ONLY
+
 /*
    ==============================================================================
 
@@ -549,3 +567,5 @@ void Con_NotifyBox(char *text)
 	key_dest = key_game;
 	realtime = 0; // put the cursor back to invisible
 }
+
+#endif
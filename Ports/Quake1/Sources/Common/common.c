@@ -30,9 +30,12 @@
 #include "Networking/net.h"
 #include "Rendering/r_draw.h"
 
+#ifndef DEDICATED_ONLY
 #include <SDL2/SDL.h>
+#endif
 
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define NUM_SAFE_ARGVS 3
@@ -1004,6 +1007,7 @@ void COM_CheckRegistered()
 	Cvar_Set("cmdline", com_cmdline);
 	Cvar_Set("registered", "1");
 	static_registered = true;
+	COM_FlushFileCache(); // directory lookups are no longer restricted
 	Con_Printf("Playing registered version.\n");
 }
 
@@ -1072,7 +1076,11 @@ void COM_InitArgv(int argc, char **argv)
 void COM_Init(char *basedir)
 {
 	// set the byte swapping variables in a portable manner
+    #ifdef DEDICATED_ONLY
+    if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    #else
     if (SDL_BYTEORDER == SDL_LIL_ENDIAN)
+    #endif
 	{
 		bigendien = false;
 		BigShort = ShortSwap;
@@ -1136,6 +1144,7 @@ int memsearch(byte *start, int count, int search)
  */
 
 int com_filesize;
+static byte *com_filemap; // set by COM_FindFile when the file lives in a mapped pak
 
 //
 // in memory
@@ -1145,6 +1154,7 @@ typedef struct
 {
 	char name[MAX_QPATH+1];
 	int filepos, filelen;
+	int hashnext; // next file in the same hash chain, -1 terminates
 } packfile_t;
 
 typedef struct pack_s
@@ -1153,6 +1163,10 @@ typedef struct pack_s
 	int handle;
 	int numfiles;
 	packfile_t *files;
+	byte *map; // read only mapping of the whole pak, NULL if not mapped
+	int mapsize;
+	int hashmask; // hashsize - 1, hashsize is a power of two
+	int *hashheads; // first file index of every hash chain, -1 if empty
 } pack_t;
 
 //
@@ -1186,6 +1200,58 @@ typedef struct searchpath_s
 
 static searchpath_t *com_searchpaths;
 
+//
+// negative lookup cache: names that were not found anywhere in the search path
+// are remembered so repeated probes (missing skins, sounds...) don't hit the disk.
+// Must be flushed whenever the search path or the files on disk may have changed.
+//
+#define FILE_MISSCACHE_SIZE 256 // must be a power of two
+
+static char com_misscache[FILE_MISSCACHE_SIZE][MAX_QPATH+1];
+
+unsigned COM_HashKey(char *s)
+{
+	unsigned hash = 0;
+	for (; *s; s++)
+	{
+		int c = *s;
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		hash = hash * 33 + c;
+	}
+	return hash ^ (hash >> 16);
+}
+
+void COM_FlushFileCache()
+{
+	for (int i = 0; i < FILE_MISSCACHE_SIZE; i++)
+		com_misscache[i][0] = 0;
+}
+
+static bool COM_IsCachedMiss(char *filename, unsigned hash)
+{
+	char *entry = com_misscache[hash & (FILE_MISSCACHE_SIZE - 1)];
+	return entry[0] && !strcmp(entry, filename);
+}
+
+static void COM_CacheMiss(char *filename, unsigned hash)
+{
+	if (strlen(filename) > MAX_QPATH)
+		return;
+	Q_strncpy(com_misscache[hash & (FILE_MISSCACHE_SIZE - 1)], filename, MAX_QPATH + 1);
+}
+
+static packfile_t* COM_FindPackFile(pack_t *pak, char *filename, unsigned hash)
+{
+	for (int i = pak->hashheads[hash & pak->hashmask]; i != -1; i = pak->files[i].hashnext)
+	{
+		packfile_t *packFile = &pak->files[i];
+		if (!strcmp(packFile->name, filename))
+			return packFile;
+	}
+	return NULL;
+}
+
 void COM_Path_f()
 {
 	searchpath_t *s;
@@ -1195,7 +1261,7 @@ void COM_Path_f()
 	{
 		if (s->pack)
 		{
-			Con_Printf("%s (%i files)\n", s->pack->filename, s->pack->numfiles);
+			Con_Printf("%s (%i files%s)\n", s->pack->filename, s->pack->numfiles, s->pack->map ? ", mapped" : "");
 		}
 		else
 			Con_Printf("%s\n", s->filename);
@@ -1221,6 +1287,7 @@ void COM_WriteFile(char *filename, void *data, int len)
 	Sys_Printf("COM_WriteFile: %s\n", name);
 	Sys_FileWrite(handle, data, len);
 	Sys_FileClose(handle);
+	COM_FlushFileCache();
 }
 
 /*
@@ -1280,6 +1347,12 @@ int COM_FindFile(char *filename, int *handle, FILE **file)
 	if (!file && !handle)
 		Sys_Error("COM_FindFile: neither handle or file set");
 
+	com_filemap = NULL;
+
+	unsigned hash = COM_HashKey(filename);
+	if (COM_IsCachedMiss(filename, hash))
+		goto notfound;
+
 	//
 	// search through the path, one element at a time
 	//
@@ -1295,32 +1368,30 @@ int COM_FindFile(char *filename, int *handle, FILE **file)
 		// is the element a pak file?
 		if (search->pack)
 		{
-			// look through all the pak file elements
-            pack_t *pak = search->pack;
-            int n = pak->numfiles;
-			for (int i = 0; i < n; i++)
-            {
-                packfile_t *packFile = &pak->files[i];
-				if (!strcmp(packFile->name, filename)) // found it!
+			// look up the pak file directory
+			pack_t *pak = search->pack;
+			packfile_t *packFile = COM_FindPackFile(pak, filename, hash);
+			if (packFile) // found it!
+			{
+				Con_DPrintf("PackFile: %s : %s\n", pak->filename, filename);
+				if (handle)
+				{
+					int h = pak->handle;
+					*handle = h;
+					Sys_FileSeek(h, packFile->filepos);
+					if (pak->map && packFile->filepos + packFile->filelen <= pak->mapsize)
+						com_filemap = pak->map + packFile->filepos;
+				}
+				else // open a new file on the pakfile
 				{
-					Sys_Printf("PackFile: %s : %s\n", pak->filename, filename);
-					if (handle)
-					{
-                        int h = pak->handle;
-						*handle = h;
-						Sys_FileSeek(h, packFile->filepos);
-					}
-					else // open a new file on the pakfile
-					{
-                        FILE *f = fopen(pak->filename, "rb");
-						*file = f;
-						if (f)
-							fseek(f, packFile->filepos, SEEK_SET);
-					}
-					com_filesize = packFile->filelen;
-					return com_filesize;
+					FILE *f = fopen(pak->filename, "rb");
+					*file = f;
+					if (f)
+						fseek(f, packFile->filepos, SEEK_SET);
 				}
-            }
+				com_filesize = packFile->filelen;
+				return com_filesize;
+			}
 		}
 		else
 		{
@@ -1364,7 +1435,7 @@ int COM_FindFile(char *filename, int *handle, FILE **file)
 			}
             #endif
 
-			Sys_Printf("FindFile: %s\n", netpath);
+			Con_DPrintf("FindFile: %s\n", netpath);
             int i;
 			com_filesize = Sys_FileOpenRead(netpath, &i);
 			if (handle)
@@ -1378,7 +1449,10 @@ int COM_FindFile(char *filename, int *handle, FILE **file)
 		}
 	}
 
-	Sys_Printf("FindFile: can't find %s\n", filename);
+	COM_CacheMiss(filename, hash);
+
+notfound:
+	Con_DPrintf("FindFile: can't find %s\n", filename);
 
 	if (handle)
 		*handle = -1;
@@ -1423,7 +1497,7 @@ void COM_CloseFile(int h)
 
 /*
    Filename are reletive to the quake directory.
-   Allways appends a 0 byte.
+   Allways appends a 0 byte, except for read only views (usehunk 5).
  */
 cache_user_t *loadcache;
 byte *loadbuf;
@@ -1436,6 +1510,19 @@ byte* COM_LoadFile(char *path, int usehunk)
 	if (h < 0)
 		return NULL;
 
+	// files in a mapped pak are copied from memory, or not copied at all
+	// for a view when the address is aligned for the struct loads
+	byte *mapped = com_filemap;
+	if (usehunk == 5)
+	{
+		if (mapped && !((size_t)mapped & 3))
+		{
+			COM_CloseFile(h);
+			return mapped;
+		}
+		usehunk = 4;
+	}
+
 	// extract the filename base name for hunk tag
 	char base[32];
 	COM_FileBase(path, base, 32);
@@ -1474,13 +1561,19 @@ byte* COM_LoadFile(char *path, int usehunk)
 
 	buf[len] = 0;
 
+	#ifndef DEDICATED_ONLY
 	Draw_BeginDisc();
-	if (Sys_FileRead(h, buf, len) != len)
+	#endif
+	if (mapped)
+		memcpy(buf, mapped, len);
+	else if (Sys_FileRead(h, buf, len) != len)
     {
 		Con_Printf("COM_LoadFile: cannot load file %s", path);
     }
 	COM_CloseFile(h);
+	#ifndef DEDICATED_ONLY
 	Draw_EndDisc();
+	#endif
 
 	return buf;
 }
@@ -1513,6 +1606,15 @@ byte* COM_LoadStackFile(char *path, void *buffer, int bufsize)
 	return buf;
 }
 
+// returns a read only view when the file is in a mapped pak,
+// else behaves like COM_LoadStackFile
+byte* COM_LoadMappedFile(char *path, void *buffer, int bufsize)
+{
+	loadbuf = (byte *)buffer;
+	loadsize = bufsize;
+	return COM_LoadFile(path, 5);
+}
+
 /*
    Takes an explicit (not game tree related) path to a pak file.
 
@@ -1522,7 +1624,8 @@ byte* COM_LoadStackFile(char *path, void *buffer, int bufsize)
 pack_t* COM_LoadPackFile(char *packfile)
 {
 	int packhandle;
-	if (Sys_FileOpenRead(packfile, &packhandle) < 0)
+	int packsize = Sys_FileOpenRead(packfile, &packhandle);
+	if (packsize < 0)
 	{
 		// Con_Printf ("Couldn't open %s\n", packfile);
 		return NULL;
@@ -1562,12 +1665,37 @@ pack_t* COM_LoadPackFile(char *packfile)
 		newfiles[i].filelen = LittleLong(info[i].filelen);
 	}
 
+	// build the name hash, walking backwards so the first entry of a
+	// duplicated name ends up first in its chain, like the old linear search
+	int hashsize = 1;
+	while (hashsize < numpackfiles)
+		hashsize <<= 1;
+	int *hashheads = Hunk_AllocName(hashsize * sizeof(int), "packhash");
+	for (int i = 0; i < hashsize; i++)
+		hashheads[i] = -1;
+	for (int i = numpackfiles - 1; i >= 0; i--)
+	{
+		int bucket = COM_HashKey(newfiles[i].name) & (hashsize - 1);
+		newfiles[i].hashnext = hashheads[bucket];
+		hashheads[bucket] = i;
+	}
+
 	pack_t *pack = Hunk_Alloc(sizeof(pack_t));
 	Q_strncpy(pack->filename, packfile, MAX_OSPATH);
     pack->filename[MAX_OSPATH] = 0;
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	pack->hashmask = hashsize - 1;
+	pack->hashheads = hashheads;
+
+	// map the whole pak once so members can be used without reading them
+	if (!COM_CheckParm("-nommap"))
+	{
+		pack->map = Sys_FileMap(packhandle, packsize);
+		if (pack->map)
+			pack->mapsize = packsize;
+	}
 
 	Con_Printf("Added packfile %s (%i files)\n", packfile, numpackfiles);
 	return pack;
@@ -1578,7 +1706,18 @@ char* Sys_GetHomeDir()
 	static char *homeDir = NULL;
 	if (homeDir == NULL)
 	{
+		#ifdef DEDICATED_ONLY
+		// the same place SDL_GetPrefPath picks on unix
+		static char path[MAX_OSPATH];
+		char *base = getenv("XDG_DATA_HOME");
+		if (base && base[0])
+			snprintf(path, sizeof(path), "%s/%s/Quake/", base, QUAKE_TEAM_NAME);
+		else
+			snprintf(path, sizeof(path), "%s/.local/share/%s/Quake/", getenv("HOME") ? getenv("HOME") : ".", QUAKE_TEAM_NAME);
+		homeDir = path;
+		#else
 		homeDir = SDL_GetPrefPath(QUAKE_TEAM_NAME, "Quake");
+		#endif
 		#if defined(_WIN32)
 		while (1)
 		{
@@ -1611,6 +1750,7 @@ static int COM_AddGameDirectory(char *dir, bool setAsCurrentDirFlag)
     search->pack = NULL;
 	search->next = com_searchpaths;
 	com_searchpaths = search;
+	COM_FlushFileCache();
 
 	//
 	// add any pak files in the format pak0.pak pak1.pak, ...
@@ -182,8 +182,11 @@ void COM_WriteFile(char *filename, void *data, int len);
 int COM_OpenFile(char *filename, int *hndl);
 int COM_FOpenFile(char *filename, FILE **file);
 void COM_CloseFile(int h);
+void COM_FlushFileCache(); // call after writing files that may be looked up later
+unsigned COM_HashKey(char *s);
 
 byte* COM_LoadStackFile(char *path, void *buffer, int bufsize);
+byte* COM_LoadMappedFile(char *path, void *buffer, int bufsize); // result is read only
 byte* COM_LoadTempFile(char *path);
 byte* COM_LoadHunkFile(char *path);
 void COM_LoadCacheFile(char *path, struct cache_user_s *cu);
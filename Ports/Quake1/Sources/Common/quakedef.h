@@ -124,6 +124,7 @@ extern qboolean noclip_anglehack;
 //
 
 extern cvar_t sys_ticrate;
+extern cvar_t host_maxfps;
 extern cvar_t developer;
 
 extern double real_frametime; // Not bounded
@@ -135,6 +136,7 @@ extern double realtime; // not bounded in any way, changed at start of every fra
 
 void Host_ClearMemory();
 void Host_ServerFrame();
+void Host_BenchReport();
 void Host_InitCommands();
 void Host_Init(quakeparms_t *parms);
 void Host_Shutdown();
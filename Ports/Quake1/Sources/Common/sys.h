@@ -38,6 +38,7 @@ void Sys_FileSeek(int handle, int position);
 int Sys_FileRead(int handle, void *dest, int count);
 int Sys_FileWrite(int handle, void *data, int count);
 int Sys_FileTime(char *path);
+void* Sys_FileMap(int handle, int size); // read only, NULL if unsupported
 bool Sys_mkdir(char *path);
 
 //
@@ -53,15 +54,34 @@ void Sys_Printf(char *fmt, ...);
 
 void Sys_Quit();
 
+char* Sys_ConsoleInput();
+// returns a line typed on stdin of a dedicated server, NULL if there is none
+
 double Sys_FloatTime();
 
+double Sys_ProfileTime();
+// high resolution seconds for profiling, only differences are meaningful
+
 void Sys_Sleep();
 // called to yield for a little bit so as
 // not to hog cpu when paused or debugging
 
+void Sys_FrameStats_f();
+// prints how late the frame scheduler wakes up, "reset" clears it
+
 void Sys_SendKeyEvents();
 // Perform Key_Event () callbacks until the input que is empty
 
 void Sys_SetFPCW();
 
+//
+// threads
+//
+void* Sys_CreateThread(int (*function)(void *), void *data);
+void Sys_WaitThread(void *thread);
+void* Sys_CreateSemaphore(int value);
+void Sys_DestroySemaphore(void *semaphore);
+void Sys_SemaphoreWait(void *semaphore);
+void Sys_SemaphorePost(void *semaphore);
+
 #endif
@@ -20,6 +20,7 @@
 #include "Client/console.h"
 #include "Common/cmd.h"
 #include "Common/common.h"
+#include "Common/cvar.h"
 #include "Common/zone.h"
 
 #include <string.h>
@@ -50,6 +51,32 @@ typedef struct
 void Cache_FreeLow(int new_low_hunk);
 void Cache_FreeHigh(int new_high_hunk);
 
+cvar_t mem_speeds = { "mem_speeds", "0" }; // print allocator activity every frame
+cvar_t cache_compact = { "cache_compact", "0" }; // relocate cache blocks instead of evicting them
+
+#define MAX_ZONE_TAGS 8 // higher tags are counted in the last slot
+#define MAX_HUNK_NAMES 64
+
+// allocator telemetry, see Memory_Stats_f and Memory_Frame
+typedef struct
+{
+	int zone_allocs, zone_frees, zone_failures;
+	int zone_used, zone_peak;
+	int zone_tagbytes[MAX_ZONE_TAGS];
+	int zone_tagpeak[MAX_ZONE_TAGS];
+
+	int hunk_lowpeak, hunk_highpeak;
+
+	int cache_used, cache_peak, cache_blocks;
+	int cache_hits, cache_misses;
+	int cache_allocs, cache_evictions, cache_moves;
+	int cache_compactions, cache_relocations;
+} memstats_t;
+
+static memstats_t memstats;
+static memstats_t memstats_frame; // totals at the start of the frame
+static memstats_t memstats_peak; // largest per frame deltas
+
 /*
    ==============================================================================
 
@@ -100,6 +127,10 @@ void Z_Free(void *ptr)
 	if (block->tag == 0)
 		Sys_Error("Z_Free: freed a freed pointer");
 
+	memstats.zone_frees++;
+	memstats.zone_used -= block->size;
+	memstats.zone_tagbytes[block->tag < MAX_ZONE_TAGS ? block->tag : MAX_ZONE_TAGS - 1] -= block->size;
+
 	block->tag = 0; // mark as free
 
 	other = block->prev;
@@ -159,7 +190,10 @@ void* Z_TagMalloc(int size, int tag)
 	do
 	{
 		if (rover == start) // scaned all the way around the list
+		{
+			memstats.zone_failures++;
 			return NULL;
+		}
 
 		if (rover->tag)
 			base = rover = rover->next;
@@ -187,6 +221,16 @@ void* Z_TagMalloc(int size, int tag)
 
 	base->tag = tag; // no longer a free block
 
+	if (tag >= MAX_ZONE_TAGS)
+		tag = MAX_ZONE_TAGS - 1;
+	memstats.zone_allocs++;
+	memstats.zone_used += base->size;
+	memstats.zone_tagbytes[tag] += base->size;
+	if (memstats.zone_used > memstats.zone_peak)
+		memstats.zone_peak = memstats.zone_used;
+	if (memstats.zone_tagbytes[tag] > memstats.zone_tagpeak[tag])
+		memstats.zone_tagpeak[tag] = memstats.zone_tagbytes[tag];
+
 	mainzone->rover = base->next; // next allocation will start looking here
 
 	base->id = ZONEID;
@@ -375,6 +419,8 @@ void* Hunk_AllocName(int size, char *name)
 
 	h = (hunk_t *)(hunk_base + hunk_low_used);
 	hunk_low_used += size;
+	if (hunk_low_used > memstats.hunk_lowpeak)
+		memstats.hunk_lowpeak = hunk_low_used;
 
 	Cache_FreeLow(hunk_low_used);
 
@@ -455,6 +501,8 @@ void* Hunk_HighAllocName(int size, char *name)
 	}
 
 	hunk_high_used += size;
+	if (hunk_high_used > memstats.hunk_highpeak)
+		memstats.hunk_highpeak = hunk_high_used;
 	Cache_FreeHigh(hunk_high_used);
 
 	h = (hunk_t *)(hunk_base + hunk_size - hunk_high_used);
@@ -527,12 +575,14 @@ void Cache_Move(cache_system_t *c)
 		Q_memcpy(new->name, c->name, sizeof(new->name));
 		Cache_Free(c->user);
 		new->user->data = (void *)(new + 1);
+		memstats.cache_moves++;
 	}
 	else
 	{
 		//		Con_Printf ("cache_move failed\n");
 
 		Cache_Free(c->user); // tough luck...
+		memstats.cache_evictions++;
 	}
 }
 
@@ -574,7 +624,10 @@ void Cache_FreeHigh(int new_high_hunk)
 			return;                                                           // there is space to grow the hunk
 
 		if (c == prev)
+		{
 			Cache_Free(c->user);         // didn't move out of the way
+			memstats.cache_evictions++;
+		}
 		else
 		{
 			Cache_Move(c); // try to move it
@@ -605,6 +658,15 @@ void Cache_MakeLRU(cache_system_t *cs)
 	cache_head.lru_next = cs;
 }
 
+static void Cache_CountNew(cache_system_t *cs)
+{
+	memstats.cache_allocs++;
+	memstats.cache_blocks++;
+	memstats.cache_used += cs->size;
+	if (memstats.cache_used > memstats.cache_peak)
+		memstats.cache_peak = memstats.cache_used;
+}
+
 /*
    Looks for a free block of memory between the high and low hunk marks
    Size should already include the header and padding
@@ -628,6 +690,7 @@ cache_system_t* Cache_TryAlloc(int size, qboolean nobottom)
 		new->prev = new->next = &cache_head;
 
 		Cache_MakeLRU(new);
+		Cache_CountNew(new);
 		return new;
 	}
 
@@ -651,6 +714,7 @@ cache_system_t* Cache_TryAlloc(int size, qboolean nobottom)
 				cs->prev = new;
 
 				Cache_MakeLRU(new);
+				Cache_CountNew(new);
 
 				return new;
 			}
@@ -674,6 +738,7 @@ cache_system_t* Cache_TryAlloc(int size, qboolean nobottom)
 		cache_head.prev = new;
 
 		Cache_MakeLRU(new);
+		Cache_CountNew(new);
 
 		return new;
 	}
@@ -705,8 +770,36 @@ void Cache_Report()
 	Con_DPrintf("%4.1f megabyte data cache\n", (hunk_size - hunk_high_used - hunk_low_used) / (float)(1024 * 1024));
 }
 
+/*
+   Slides every cache block down to the low hunk mark, so all free cache
+   memory ends up in one piece above the last block. Users are pointed at
+   the new location, like Cache_Move does.
+ */
 void Cache_Compact()
 {
+	cache_system_t *cs, *next, *new;
+
+	new = (cache_system_t *)(hunk_base + hunk_low_used);
+
+	for (cs = cache_head.next; cs != &cache_head; cs = next)
+	{
+		next = cs->next;
+
+		if (cs != new)
+		{
+			memmove(new, cs, cs->size);
+			new->prev->next = new;
+			new->next->prev = new;
+			new->lru_prev->lru_next = new;
+			new->lru_next->lru_prev = new;
+			new->user->data = (void *)(new + 1);
+			memstats.cache_relocations++;
+		}
+
+		new = (cache_system_t *)((byte *)new + new->size);
+	}
+
+	memstats.cache_compactions++;
 }
 
 void Cache_Init()
@@ -733,6 +826,9 @@ void Cache_Free(cache_user_t *c)
 	cs->next->prev = cs->prev;
 	cs->next = cs->prev = NULL;
 
+	memstats.cache_blocks--;
+	memstats.cache_used -= cs->size;
+
 	c->data = NULL;
 
 	Cache_UnlinkLRU(cs);
@@ -743,7 +839,12 @@ void* Cache_Check(cache_user_t *c)
 	cache_system_t *cs;
 
 	if (!c->data)
+	{
+		memstats.cache_misses++;
 		return NULL;
+	}
+
+	memstats.cache_hits++;
 
 	cs = ((cache_system_t *)c->data) - 1;
 
@@ -778,11 +879,19 @@ void* Cache_Alloc(cache_user_t *c, int size, char *name)
 			break;
 		}
 
+		// the space may be there, just split between blocks
+		if (cache_compact.value && hunk_size - hunk_high_used - hunk_low_used - memstats.cache_used >= size)
+		{
+			Cache_Compact();
+			continue;
+		}
+
 		// free the least recently used cahedat
 		if (cache_head.lru_prev == &cache_head)
 			Sys_Error("Cache_Alloc: out of memory");
 		// not enough memory at all
 		Cache_Free(cache_head.lru_prev->user);
+		memstats.cache_evictions++;
 	}
 
 	return Cache_Check(c);
@@ -790,6 +899,102 @@ void* Cache_Alloc(cache_user_t *c, int size, char *name)
 
 //============================================================================
 
+static void Memory_PrintHunkNames(byte *start, byte *end)
+{
+	char names[MAX_HUNK_NAMES][9];
+	int bytes[MAX_HUNK_NAMES];
+	int count, i;
+	hunk_t *h;
+
+	count = 0;
+	for (h = (hunk_t *)start; (byte *)h < end; h = (hunk_t *)((byte *)h + h->size))
+	{
+		for (i = 0; i < count; i++)
+		{
+			if (!strncmp(names[i], h->name, 8))
+				break;
+		}
+		if (i == count)
+		{
+			if (count == MAX_HUNK_NAMES)
+				continue;
+			memcpy(names[i], h->name, 8);
+			names[i][8] = 0;
+			bytes[i] = 0;
+			count++;
+		}
+		bytes[i] += h->size;
+	}
+
+	for (i = 0; i < count; i++)
+		Con_Printf("  %-8s %8i\n", names[i], bytes[i]);
+}
+
+/*
+   Prints the allocator telemetry, per tag and per name
+ */
+void Memory_Stats_f()
+{
+	int i;
+
+	Con_Printf("zone: %i of %i used, peak %i\n", memstats.zone_used, mainzone->size, memstats.zone_peak);
+	Con_Printf("  %i allocs, %i frees, %i failed\n", memstats.zone_allocs, memstats.zone_frees, memstats.zone_failures);
+	for (i = 1; i < MAX_ZONE_TAGS; i++)
+	{
+		if (memstats.zone_tagpeak[i])
+			Con_Printf("  tag %i%s %8i, peak %i\n", i, i == MAX_ZONE_TAGS - 1 ? "+" : " ",
+				memstats.zone_tagbytes[i], memstats.zone_tagpeak[i]);
+	}
+
+	Con_Printf("hunk: %i of %i, low %i (peak %i), high %i (peak %i)\n",
+		hunk_low_used + hunk_high_used, hunk_size,
+		hunk_low_used, memstats.hunk_lowpeak, hunk_high_used, memstats.hunk_highpeak);
+	Memory_PrintHunkNames(hunk_base, hunk_base + hunk_low_used);
+	Memory_PrintHunkNames(hunk_base + hunk_size - hunk_high_used, hunk_base + hunk_size);
+
+	Con_Printf("cache: %i blocks, %i of %i used, peak %i\n", memstats.cache_blocks, memstats.cache_used,
+		hunk_size - hunk_high_used - hunk_low_used, memstats.cache_peak);
+	Con_Printf("  %i hits, %i misses, %i allocs, %i evictions\n",
+		memstats.cache_hits, memstats.cache_misses, memstats.cache_allocs, memstats.cache_evictions);
+	Con_Printf("  %i moves, %i compactions relocating %i blocks\n",
+		memstats.cache_moves, memstats.cache_compactions, memstats.cache_relocations);
+	Con_Printf("per frame peaks: %i zone allocs, %i zone frees, %i cache misses, %i evictions\n",
+		memstats_peak.zone_allocs, memstats_peak.zone_frees, memstats_peak.cache_misses, memstats_peak.cache_evictions);
+}
+
+/*
+   Called once per host frame to track the allocation rates
+ */
+void Memory_Frame()
+{
+	memstats_t delta;
+
+	delta.zone_allocs = memstats.zone_allocs - memstats_frame.zone_allocs;
+	delta.zone_frees = memstats.zone_frees - memstats_frame.zone_frees;
+	delta.cache_hits = memstats.cache_hits - memstats_frame.cache_hits;
+	delta.cache_misses = memstats.cache_misses - memstats_frame.cache_misses;
+	delta.cache_evictions = memstats.cache_evictions - memstats_frame.cache_evictions;
+	delta.cache_relocations = memstats.cache_relocations - memstats_frame.cache_relocations;
+
+	if (delta.zone_allocs > memstats_peak.zone_allocs)
+		memstats_peak.zone_allocs = delta.zone_allocs;
+	if (delta.zone_frees > memstats_peak.zone_frees)
+		memstats_peak.zone_frees = delta.zone_frees;
+	if (delta.cache_misses > memstats_peak.cache_misses)
+		memstats_peak.cache_misses = delta.cache_misses;
+	if (delta.cache_evictions > memstats_peak.cache_evictions)
+		memstats_peak.cache_evictions = delta.cache_evictions;
+
+	if (mem_speeds.value)
+	{
+		Con_Printf("%3i zalloc %3i zfree %4i hit %3i miss %3i evict %3i moved\n",
+			delta.zone_allocs, delta.zone_frees, delta.cache_hits, delta.cache_misses,
+			delta.cache_evictions, delta.cache_relocations);
+	}
+
+	memstats_frame = memstats;
+}
+
 void Memory_Init(void *buf, int size)
 {
 	int p;
@@ -811,4 +1016,9 @@ void Memory_Init(void *buf, int size)
 	}
 	mainzone = Hunk_AllocName(zonesize, "zone");
 	Z_ClearZone(mainzone, zonesize);
+	mainzone->size = zonesize;
+
+	Cvar_RegisterVariable(&mem_speeds);
+	Cvar_RegisterVariable(&cache_compact);
+	Cmd_AddCommand("memstats", Memory_Stats_f);
 }
@@ -127,4 +127,10 @@ void* Cache_Alloc(cache_user_t *c, int size, char *name);
 
 void Cache_Report();
 
+void Cache_Compact();
+// moves all cache blocks together, leaving the free space in one piece
+
+void Memory_Frame();
+// updates the per frame allocator statistics
+
 #endif
@@ -31,6 +31,7 @@
 #include "Common/quakedef.h"
 #include "Common/sys.h"
 #include "Networking/net.h"
+#include "Networking/net_vcr.h"
 #include "Networking/protocol.h"
 #include "Rendering/r_draw.h"
 #include "Rendering/r_model.h"
@@ -70,12 +71,19 @@ int minimum_memory;
 
 client_t *host_client; // current client
 
+#ifdef DEDICATED_ONLY
+// there is no client, only its state is kept to say so
+client_static_t cls;
+keydest_t key_dest;
+#endif
+
 jmp_buf host_abortserver;
 
 byte *host_basepal;
 byte *host_colormap;
 
 cvar_t host_framerate = { "host_framerate", "0" }; // set for slow motion
+cvar_t host_maxfps = { "host_maxfps", "72", true }; // frame rate the system loop paces the client to
 cvar_t host_speeds = { "host_speeds", "0" }; // set for running times
 
 cvar_t sys_ticrate = { "sys_ticrate", "0.05" };
@@ -112,10 +120,12 @@ void Host_EndGame(char *message, ...)
 	if (cls.state == ca_dedicated)
 		Sys_Error("Host_EndGame: %s\n", string); // dedicated servers exit
 
+	#ifndef DEDICATED_ONLY
 	if (cls.demonum != -1)
 		CL_NextDemo();
 	else
 		CL_Disconnect();
+	#endif
 
 	longjmp(host_abortserver, 1);
 }
@@ -133,7 +143,9 @@ void Host_Error(char *error, ...)
 		Sys_Error("Host_Error: recursively entered");
 	inerror = true;
 
+	#ifndef DEDICATED_ONLY
 	SCR_EndLoadingPlaque(); // reenable screen updates
+	#endif
 
 	va_start(argptr, error);
 	vsprintf(string, error, argptr);
@@ -146,8 +158,10 @@ void Host_Error(char *error, ...)
 	if (cls.state == ca_dedicated)
 		Sys_Error("Host_Error: %s\n", string); // dedicated servers exit
 
+	#ifndef DEDICATED_ONLY
 	CL_Disconnect();
 	cls.demonum = -1;
+	#endif
 
 	inerror = false;
 
@@ -161,6 +175,12 @@ void Host_FindMaxClients()
 	svs.maxclients = 1;
 
 	i = COM_CheckParm("-dedicated");
+	#ifdef DEDICATED_ONLY
+	cls.state = ca_dedicated;
+	svs.maxclients = 8;
+	if (i && i != (com_argc - 1))
+		svs.maxclients = Q_atoi(com_argv[i + 1]);
+	#else
 	if (i)
 	{
 		cls.state = ca_dedicated;
@@ -171,6 +191,7 @@ void Host_FindMaxClients()
 	}
 	else
 		cls.state = ca_disconnected;
+	#endif
 
 	i = COM_CheckParm("-listen");
 	if (i)
@@ -204,6 +225,7 @@ void Host_InitLocal()
 	Host_InitCommands();
 
 	Cvar_RegisterVariable(&host_framerate);
+	Cvar_RegisterVariable(&host_maxfps);
 	Cvar_RegisterVariable(&host_speeds);
 
 	Cvar_RegisterVariable(&sys_ticrate);
@@ -229,6 +251,7 @@ void Host_InitLocal()
 // Writes key bindings and archived cvars to autoexec.cfg
 void Host_WriteConfiguration()
 {
+	#ifndef DEDICATED_ONLY
 	// dedicated servers initialize the host but don't parse and set the autoexec.cfg cvars
 	if (host_initialized && cls.state != ca_dedicated)
 	{
@@ -242,6 +265,7 @@ void Host_WriteConfiguration()
 		Cvar_WriteVariables(f);
 		fclose(f);
 	}
+	#endif
 }
 
 /*
@@ -373,9 +397,11 @@ void Host_ShutdownServer(qboolean crash)
 
 	sv.active = false;
 
+	#ifndef DEDICATED_ONLY
 	// stop all client sounds immediately
 	if (cls.state == ca_connected)
 		CL_Disconnect();
+	#endif
 
 	// flush any pending messages - like the score!!!
 	start = Sys_FloatTime();
@@ -437,21 +463,21 @@ void Host_ClearMemory()
 
 	cls.signon = 0;
 	memset(&sv, 0, sizeof(sv));
+	#ifndef DEDICATED_ONLY
 	memset(&cl, 0, sizeof(cl));
+	#endif
 }
 
 //============================================================================
 
 /*
-   Returns false if the time is too short to run a frame
+   Returns false if the time is too short to run a frame.  The system loop
+   already paces frames to host_maxfps, so that no longer happens.
  */
 qboolean Host_FilterTime(float time)
 {
 	realtime += time;
 
-	if (!cls.timedemo && realtime - oldrealtime < 1.0f / 72.0f)
-		return false;                                                    // framerate is too high
-
     real_frametime = realtime - oldrealtime;
 	host_frametime = real_frametime;
 	oldrealtime = realtime;
@@ -469,6 +495,138 @@ qboolean Host_FilterTime(float time)
 	return true;
 }
 
+/*
+   ===============================================================================
+
+   SERVER BENCHMARK
+
+   While a -record or -playback file is open every server frame is timed and
+   split up between reading the clients, physics and sending the updates,
+   with the time spent in QuakeC taken out of each of them.  A checksum of
+   the globals and entity fields is taken after each frame, written into the
+   recording and compared against it on playback, so a replay that drifts
+   from what was recorded is noticed.  Play a recording back on a dedicated
+   server to replay it as fast as possible.
+
+   ===============================================================================
+ */
+
+#define BENCH_CLIENTS 0
+#define BENCH_PHYSICS 1
+#define BENCH_SEND 2
+#define BENCH_SECTIONS 3
+
+#define BENCH_BUCKETS 10000 // 10 usec each, frames longer than 100 msec go in the last one
+
+static qboolean host_bench;
+static qboolean host_playback;
+
+static double bench_start, bench_mark, bench_prmark;
+static double bench_sections[BENCH_SECTIONS];
+static double bench_quakec;
+static double bench_total, bench_max;
+static int bench_frames;
+static int bench_histogram[BENCH_BUCKETS + 1];
+static unsigned bench_checksum;
+static int bench_mismatches, bench_firstmismatch;
+
+static void Host_BenchBegin()
+{
+	if (!host_bench)
+		return;
+
+	bench_start = bench_mark = Sys_ProfileTime();
+	bench_prmark = pr_time;
+}
+
+static void Host_BenchEnd(int section)
+{
+	double now;
+
+	if (!host_bench)
+		return;
+
+	now = Sys_ProfileTime();
+	bench_sections[section] += now - bench_mark - (pr_time - bench_prmark);
+	bench_quakec += pr_time - bench_prmark;
+	bench_mark = now;
+	bench_prmark = pr_time;
+}
+
+static void Host_BenchFrame()
+{
+	double time;
+	int bucket;
+
+	if (!host_bench)
+		return;
+
+	time = Sys_ProfileTime() - bench_start;
+	bench_total += time;
+	if (time > bench_max)
+		bench_max = time;
+	bucket = (int)(time * 100000);
+	if (bucket > BENCH_BUCKETS)
+		bucket = BENCH_BUCKETS;
+	bench_histogram[bucket]++;
+	bench_frames++;
+
+	bench_checksum = ED_Checksum();
+	if (host_playback)
+	{
+		if (!VCR_Checksum(bench_checksum) && !bench_mismatches++)
+			bench_firstmismatch = bench_frames;
+	}
+	else
+		NET_RecordChecksum(bench_checksum);
+}
+
+static double Host_BenchPercentile(double fraction)
+{
+	int i, count, target;
+
+	target = (int)(bench_frames * fraction);
+	count = 0;
+	for (i = 0; i < BENCH_BUCKETS; i++)
+	{
+		count += bench_histogram[i];
+		if (count > target)
+			return (i + 1) * 0.01;
+	}
+	return bench_max * 1000;
+}
+
+/*
+   ==================
+   Host_BenchReport
+
+   Prints the server frame times of a -record or -playback session
+   ==================
+ */
+void Host_BenchReport()
+{
+	double frames;
+
+	if (!host_bench || !bench_frames)
+		return;
+
+	frames = bench_frames;
+	Con_Printf("%i server frames, %.1f frames per second\n", bench_frames, frames / bench_total);
+	Con_Printf("frame msec: mean %.3f p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f max %.3f\n",
+		bench_total * 1000 / frames, Host_BenchPercentile(0.5), Host_BenchPercentile(0.9),
+		Host_BenchPercentile(0.99), Host_BenchPercentile(0.999), bench_max * 1000);
+	Con_Printf("msec per frame: clients %.3f physics %.3f send %.3f quakec %.3f\n",
+		bench_sections[BENCH_CLIENTS] * 1000 / frames, bench_sections[BENCH_PHYSICS] * 1000 / frames,
+		bench_sections[BENCH_SEND] * 1000 / frames, bench_quakec * 1000 / frames);
+	Con_Printf("final checksum %08x\n", bench_checksum);
+	if (bench_mismatches)
+		Con_Printf("%i frames differ from the recording, the first at frame %i\n", bench_mismatches, bench_firstmismatch);
+	else if (host_playback)
+		Con_Printf("all frames match the recording\n");
+}
+
+//============================================================================
+
 #ifdef FPS_20
 
 void _Host_ServerFrame()
@@ -478,11 +636,13 @@ void _Host_ServerFrame()
 
 	// read client messages
 	SV_RunClients();
+	Host_BenchEnd(BENCH_CLIENTS);
 
 	// move things around and think
 	// always pause in single player if in console or menus
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game))
 		SV_Physics();
+	Host_BenchEnd(BENCH_PHYSICS);
 }
 
 void Host_ServerFrame()
@@ -490,6 +650,8 @@ void Host_ServerFrame()
 	float save_host_frametime;
 	float temp_host_frametime;
 
+	Host_BenchBegin();
+
 	// run the world state
 	pr_global_struct->frametime = host_frametime;
 
@@ -498,6 +660,7 @@ void Host_ServerFrame()
 
 	// check for new clients
 	SV_CheckForNewClients();
+	Host_BenchEnd(BENCH_CLIENTS);
 
 	temp_host_frametime = save_host_frametime = host_frametime;
 	while (temp_host_frametime > (1.0f / 72.0f))
@@ -513,12 +676,17 @@ void Host_ServerFrame()
 
 	// send all messages to the clients
 	SV_SendClientMessages();
+	Host_BenchEnd(BENCH_SEND);
+
+	Host_BenchFrame();
 }
 
 #else
 
 void Host_ServerFrame()
 {
+	Host_BenchBegin();
+
 	// run the world state
 	pr_global_struct->frametime = host_frametime;
 
@@ -530,18 +698,69 @@ void Host_ServerFrame()
 
 	// read client messages
 	SV_RunClients();
+	Host_BenchEnd(BENCH_CLIENTS);
 
 	// move things around and think
 	// always pause in single player if in console or menus
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game))
 		SV_Physics();
+	Host_BenchEnd(BENCH_PHYSICS);
 
 	// send all messages to the clients
 	SV_SendClientMessages();
+	Host_BenchEnd(BENCH_SEND);
+
+	Host_BenchFrame();
 }
 
 #endif
 
+/*
+   Add them exactly as if they had been typed at the console
+ */
+static void Host_GetConsoleCommands()
+{
+	char *cmd;
+
+	while ((cmd = Sys_ConsoleInput()) != NULL)
+		Cbuf_AddText(cmd);
+}
+
+#ifdef DEDICATED_ONLY
+
+/*
+   Runs the server, there is no client, video or sound to update
+ */
+void _Host_Frame(float time)
+{
+	if (setjmp(host_abortserver))
+		return;                        // something bad happened, or the server disconnected
+
+	// keep the random time dependent
+	(void)rand();
+
+	// decide the simulation time
+	if (!Host_FilterTime(time))
+		return;                      // don't run too fast, or packets will flood out
+
+	// process console commands
+	Host_GetConsoleCommands();
+	Cbuf_Execute();
+
+	NET_Poll();
+
+	if (sv.active)
+		Host_ServerFrame();
+
+	host_time += host_frametime;
+
+	Memory_Frame();
+
+	host_framecount++;
+}
+
+#else
+
 /*
    Runs all active servers
  */
@@ -569,6 +788,8 @@ void _Host_Frame(float time)
 	IN_Commands();
 
 	// process console commands
+	if (cls.state == ca_dedicated)
+		Host_GetConsoleCommands();
 	Cbuf_Execute();
 
 	NET_Poll();
@@ -625,6 +846,8 @@ void _Host_Frame(float time)
 
 	CDAudio_Update();
 
+	Memory_Frame();
+
 	if (host_speeds.value)
 	{
 		pass1 = (time1 - time3) * 1000;
@@ -638,6 +861,8 @@ void _Host_Frame(float time)
 	host_framecount++;
 }
 
+#endif
+
 void Host_Frame(float time)
 {
 	double time1, time2;
@@ -677,20 +902,31 @@ void Host_Frame(float time)
 //============================================================================
 
 extern int vcrFile;
-#define VCR_SIGNATURE 0x56435231
-// "VCR1"
+#define VCR_SIGNATURE 0x56435232
+// "VCR2"
+
+/*
+   -record and -playback take an optional file name, quake.vcr if there is none
+ */
+static char* Host_VCRFile(int parm)
+{
+	if (parm + 1 < com_argc && com_argv[parm + 1][0] != '-' && com_argv[parm + 1][0] != '+')
+		return com_argv[parm + 1];
+	return NULL;
+}
 
 void Host_InitVCR(quakeparms_t *parms)
 {
 	int i, len, n;
-	char *p;
+	char *p, *name;
 
-	if (COM_CheckParm("-playback"))
+	if ((n = COM_CheckParm("-playback")) != 0)
 	{
-		if (com_argc != 2)
+		name = Host_VCRFile(n);
+		if (com_argc != (name ? 3 : 2))
 			Sys_Error("No other parameters allowed with -playback\n");
 
-		Sys_FileOpenRead("quake.vcr", &vcrFile);
+		Sys_FileOpenRead(name ? name : "quake.vcr", &vcrFile);
 		if (vcrFile == -1)
 			Sys_Error("playback file not found\n");
 
@@ -699,7 +935,7 @@ void Host_InitVCR(quakeparms_t *parms)
 			Sys_Error("Invalid signature in vcr file\n");
 
 		Sys_FileRead(vcrFile, &com_argc, sizeof(int));
-		com_argv = malloc(com_argc * sizeof(char *));
+		com_argv = malloc((com_argc + 1) * sizeof(char *));
 		com_argv[0] = parms->argv[0];
 		for (i = 0; i < com_argc; i++)
 		{
@@ -711,15 +947,19 @@ void Host_InitVCR(quakeparms_t *parms)
 		com_argc++; /* add one for arg[0] */
 		parms->argc = com_argc;
 		parms->argv = com_argv;
+
+		host_playback = true;
 	}
 
 	if ((n = COM_CheckParm("-record")) != 0)
 	{
-		vcrFile = Sys_FileOpenWrite("quake.vcr");
+		name = Host_VCRFile(n);
+		vcrFile = Sys_FileOpenWrite(name ? name : "quake.vcr");
 
+		// the recorded command line has -playback in place of -record and its file name
 		i = VCR_SIGNATURE;
 		Sys_FileWrite(vcrFile, &i, sizeof(int));
-		i = com_argc - 1;
+		i = com_argc - 1 - (name ? 1 : 0);
 		Sys_FileWrite(vcrFile, &i, sizeof(int));
 		for (i = 1; i < com_argc; i++)
 		{
@@ -728,6 +968,8 @@ void Host_InitVCR(quakeparms_t *parms)
 				len = 10;
 				Sys_FileWrite(vcrFile, &len, sizeof(int));
 				Sys_FileWrite(vcrFile, "-playback", len);
+				if (name)
+					i++;
 				continue;
 			}
 			len = Q_strlen(com_argv[i]) + 1;
@@ -735,6 +977,9 @@ void Host_InitVCR(quakeparms_t *parms)
 			Sys_FileWrite(vcrFile, com_argv[i], len);
 		}
 	}
+
+	if (vcrFile != -1)
+		host_bench = pr_timing = true;
 }
 
 void Host_Init(quakeparms_t *parms)
@@ -758,15 +1003,21 @@ void Host_Init(quakeparms_t *parms)
 	Memory_Init(parms->membase, parms->memsize);
 	Cbuf_Init();
 	Cmd_Init();
+	#ifndef DEDICATED_ONLY
 	V_Init();
 	Chase_Init();
+	#endif
 	Host_InitVCR(parms);
 	COM_Init(parms->basedir);
 	Host_InitLocal();
+	#ifndef DEDICATED_ONLY
 	W_LoadWadFile("gfx.wad");
 	Key_Init();
+	#endif
 	Con_Init();
+	#ifndef DEDICATED_ONLY
 	M_Init();
+	#endif
 	PR_Init();
 	Mod_Init();
 	NET_Init();
@@ -775,6 +1026,7 @@ void Host_Init(quakeparms_t *parms)
 	Con_Printf("Exe: "__TIME__ " "__DATE__ "\n");
 	Con_Printf("%4.1f megabyte heap\n", parms->memsize / (1024 * 1024.0));
 
+	#ifndef DEDICATED_ONLY
 	R_initTextures(); // needed even for dedicated servers
 
 	if (cls.state != ca_dedicated)
@@ -796,6 +1048,7 @@ void Host_Init(quakeparms_t *parms)
 		Sbar_Init();
 		CL_Init();
 	}
+	#endif
 
 	Cbuf_InsertText("exec quake.rc\n");
 
@@ -822,11 +1075,17 @@ void Host_Shutdown()
 	}
 	isdown = true;
 
+	#ifndef DEDICATED_ONLY
 	// keep Con_Printf from trying to update the screen
 	scr_disabled_for_loading = true;
+	#endif
 
 	Host_WriteConfiguration();
 
+	SV_ShutdownPhysWorkers();
+	#ifdef DEDICATED_ONLY
+	NET_Shutdown();
+	#else
 	CDAudio_Shutdown();
 	NET_Shutdown();
 	S_Shutdown();
@@ -834,4 +1093,5 @@ void Host_Shutdown()
 
 	if (cls.state != ca_dedicated)
 		VID_Shutdown();
+	#endif
 }
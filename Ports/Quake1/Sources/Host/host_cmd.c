@@ -44,18 +44,22 @@ extern void M_Quit_enter();
 
 void Host_Exit()
 {
+	#ifndef DEDICATED_ONLY
 	CL_Disconnect();
+	#endif
 	Host_ShutdownServer(false);
 	Sys_Quit();
 }
 
 void Host_Quit_f()
 {
+	#ifndef DEDICATED_ONLY
 	if (key_dest != key_console && cls.state != ca_dedicated)
 	{
 		M_Quit_enter();
 		return;
 	}
+	#endif
     Host_Exit();
 }
 
@@ -244,11 +248,15 @@ void Host_Map_f()
 
 	cls.demonum = -1; // stop demo loop in case this fails
 
+	#ifndef DEDICATED_ONLY
 	CL_Disconnect();
+	#endif
 	Host_ShutdownServer(false);
 
+	#ifndef DEDICATED_ONLY
 	key_dest = key_game; // remove console or menu
 	SCR_BeginLoadingPlaque();
+	#endif
 
 	cls.mapstring[0] = 0;
 	for (i = 0; i < Cmd_Argc(); i++)
@@ -317,6 +325,8 @@ void Host_Restart_f()
 	SV_SpawnServer(mapname);
 }
 
+#ifndef DEDICATED_ONLY
+
 /*
    This command causes the client to wait for the signon messages again.
    This is sent just before a server changes levels
@@ -344,6 +354,8 @@ void Host_Connect_f()
 	Host_Reconnect_f();
 }
 
+#endif
+
 /*
    ===============================================================================
 
@@ -364,8 +376,15 @@ void Host_SavegameComment(char *text)
 
 	for (i = 0; i < SAVEGAME_COMMENT_LENGTH; i++)
 		text[i] = ' ';
+	#ifdef DEDICATED_ONLY
+	// what the server sends the client for its level name and kill counts
+	char *levelname = pr_strings + sv.edicts->v.message;
+	memcpy(text, levelname, strlen(levelname) < 22 ? strlen(levelname) : 22);
+	sprintf(kills, "kills:%3i/%3i", (int)pr_global_struct->killed_monsters, (int)pr_global_struct->total_monsters);
+	#else
 	memcpy(text, cl.levelname, strlen(cl.levelname));
 	sprintf(kills, "kills:%3i/%3i", cl.stats[STAT_MONSTERS], cl.stats[STAT_TOTALMONSTERS]);
+	#endif
 	memcpy(text + 22, kills, strlen(kills));
 	// convert space to _ to make stdio happy
 	for (i = 0; i < SAVEGAME_COMMENT_LENGTH; i++)
@@ -391,11 +410,13 @@ void Host_Savegame_f()
 		return;
 	}
 
+	#ifndef DEDICATED_ONLY
 	if (cl.intermission)
 	{
 		Con_Printf("Can't save in intermission.\n");
 		return;
 	}
+	#endif
 
 	if (svs.maxclients != 1)
 	{
@@ -524,7 +545,9 @@ void Host_Loadgame_f()
 	fscanf(f, "%s\n", mapname);
 	fscanf(f, "%f\n", &time);
 
+	#ifndef DEDICATED_ONLY
 	CL_Disconnect_f();
+	#endif
 
 	SV_SpawnServer(mapname);
 	if (!sv.active)
@@ -597,11 +620,13 @@ void Host_Loadgame_f()
 	for (i = 0; i < NUM_SPAWN_PARMS; i++)
 		svs.clients->spawn_parms[i] = spawn_parms[i];
 
+	#ifndef DEDICATED_ONLY
 	if (cls.state != ca_dedicated)
 	{
 		CL_EstablishConnection("local");
 		Host_Reconnect_f();
 	}
+	#endif
 }
 
 //============================================================================
@@ -612,7 +637,9 @@ void Host_Name_f()
 
 	if (Cmd_Argc() == 1)
 	{
+		#ifndef DEDICATED_ONLY
 		Con_Printf("\"name\" is \"%s\"\n", cl_name.string);
+		#endif
 		return;
 	}
 	if (Cmd_Argc() == 2)
@@ -623,12 +650,14 @@ void Host_Name_f()
 
 	if (cmd_source == src_command)
 	{
+		#ifndef DEDICATED_ONLY
 		if (Q_strcmp(cl_name.string, newName) == 0)
 			return;
 
 		Cvar_Set("_cl_name", newName);
 		if (cls.state == ca_connected)
 			Cmd_ForwardToServer();
+		#endif
 		return;
 	}
 
@@ -646,6 +675,35 @@ void Host_Name_f()
 	MSG_WriteString(&sv.reliable_datagram, host_client->name);
 }
 
+/*
+   ==================
+   Host_Pext_f
+
+   Protocol extension handshake.  The server stuffs "pext" at signon and the
+   client answers with the extensions it supports.  None while recording, a
+   demo has to stay playable by clients without them
+   ==================
+ */
+void Host_Pext_f()
+{
+	if (cmd_source == src_command)
+	{
+		if (cls.state != ca_connected || cls.demoplayback)
+			return;
+
+		MSG_WriteByte(&cls.message, clc_stringcmd);
+		MSG_WriteString(&cls.message, va("pext %i", cls.demorecording ? 0 : PEXT_SUPPORTED));
+		return;
+	}
+
+	if (Cmd_Argc() != 2)
+		return;
+
+	host_client->pext = Q_atoi(Cmd_Argv(1)) & PEXT_SUPPORTED;
+	if (!sv_delta.value)
+		host_client->pext &= ~PEXT_DELTA;
+}
+
 void Host_Version_f()
 {
 	Con_Printf("Version %4.2f\n", QUAKE_HOST_VERSION);
@@ -839,7 +897,9 @@ void Host_Color_f()
 
 	if (Cmd_Argc() == 1)
 	{
+		#ifndef DEDICATED_ONLY
 		Con_Printf("\"color\" is \"%i %i\"\n", ((int)cl_color.value) >> 4, ((int)cl_color.value) & 0x0f);
+		#endif
 		Con_Printf("color <0-13> [0-13]\n");
 		return;
 	}
@@ -863,9 +923,11 @@ void Host_Color_f()
 
 	if (cmd_source == src_command)
 	{
+		#ifndef DEDICATED_ONLY
 		Cvar_SetValue("_cl_color", playercolor);
 		if (cls.state == ca_connected)
 			Cmd_ForwardToServer();
+		#endif
 		return;
 	}
 
@@ -1127,10 +1189,14 @@ void Host_Kick_f()
 	if (i < svs.maxclients)
 	{
 		if (cmd_source == src_command)
+			#ifdef DEDICATED_ONLY
+			who = "Console";
+			#else
 			if (cls.state == ca_dedicated)
 				who = "Console";
 			else
 				who = cl_name.string;
+			#endif
 
 		else
 			who = save->name;
@@ -1327,6 +1393,8 @@ void Host_Give_f()
 	}
 }
 
+#ifndef DEDICATED_ONLY
+
 edict_t* FindViewthing()
 {
 	int i;
@@ -1431,6 +1499,8 @@ void Host_Viewprev_f()
 	PrintFrameName(m, e->v.frame);
 }
 
+#endif
+
 /*
    ===============================================================================
 
@@ -1441,8 +1511,6 @@ void Host_Viewprev_f()
 
 void Host_Startdemos_f()
 {
-	int i, c;
-
 	if (cls.state == ca_dedicated)
 	{
 		if (!sv.active)
@@ -1450,6 +1518,9 @@ void Host_Startdemos_f()
 		return;
 	}
 
+	#ifndef DEDICATED_ONLY
+	int i, c;
+
 	c = Cmd_Argc() - 1;
 	if (c > MAX_DEMOS)
 	{
@@ -1468,8 +1539,11 @@ void Host_Startdemos_f()
 	}
 	else
 		cls.demonum = -1;
+	#endif
 }
 
+#ifndef DEDICATED_ONLY
+
 /*
    Return to looping demos
  */
@@ -1499,6 +1573,8 @@ void Host_Stopdemo_f()
 	CL_Disconnect();
 }
 
+#endif
+
 //=============================================================================
 
 void Host_InitCommands()
@@ -1511,9 +1587,12 @@ void Host_InitCommands()
 	Cmd_AddCommand("map", Host_Map_f);
 	Cmd_AddCommand("restart", Host_Restart_f);
 	Cmd_AddCommand("changelevel", Host_Changelevel_f);
+	#ifndef DEDICATED_ONLY
 	Cmd_AddCommand("connect", Host_Connect_f);
 	Cmd_AddCommand("reconnect", Host_Reconnect_f);
+	#endif
 	Cmd_AddCommand("name", Host_Name_f);
+	Cmd_AddCommand("pext", Host_Pext_f);
 	Cmd_AddCommand("noclip", Host_Noclip_f);
 	Cmd_AddCommand("version", Host_Version_f);
 	#ifdef IDGODS
@@ -1535,6 +1614,7 @@ void Host_InitCommands()
 	Cmd_AddCommand("give", Host_Give_f);
 
 	Cmd_AddCommand("startdemos", Host_Startdemos_f);
+	#ifndef DEDICATED_ONLY
 	Cmd_AddCommand("demos", Host_Demos_f);
 	Cmd_AddCommand("stopdemo", Host_Stopdemo_f);
 
@@ -1542,6 +1622,8 @@ void Host_InitCommands()
 	Cmd_AddCommand("viewframe", Host_Viewframe_f);
 	Cmd_AddCommand("viewnext", Host_Viewnext_f);
 	Cmd_AddCommand("viewprev", Host_Viewprev_f);
+	#endif
 
 	Cmd_AddCommand("mcache", Mod_Print);
+	Cmd_AddCommand("sys_framestats", Sys_FrameStats_f);
 }
@@ -148,6 +148,8 @@ typedef struct qsocket_s
 
 	struct qsockaddr addr;
 	char address[NET_NAMELEN];
+
+	int vcrsession; // connection number in a -record file
 } qsocket_t;
 
 extern qsocket_t *net_activeSockets;
@@ -309,6 +311,9 @@ void NET_Close(struct qsocket_s *sock);
 
 void NET_Poll();
 
+void NET_RecordChecksum(unsigned checksum);
+// appends the server state checksum of this frame to a -record file
+
 typedef struct _PollProcedure
 {
 	struct _PollProcedure *next;
@@ -464,6 +464,8 @@ void PrintStats(qsocket_t *s)
 void NET_Stats_f()
 {
 	qsocket_t *s;
+	client_t *cl;
+	int i;
 
 	if (Cmd_Argc() == 1)
 	{
@@ -477,6 +479,21 @@ void NET_Stats_f()
 		Con_Printf("receivedDuplicateCount     = %i\n", receivedDuplicateCount);
 		Con_Printf("shortPacketCount           = %i\n", shortPacketCount);
 		Con_Printf("droppedDatagrams           = %i\n", droppedDatagrams);
+
+		if (sv.active)
+		{
+			Con_Printf("\nclient           bytes/frame  entity bytes  delta  dropped\n");
+			for (i = 0, cl = svs.clients; i < svs.maxclients; i++, cl++)
+			{
+				if (!cl->active || !cl->stat_frames)
+					continue;
+				Con_Printf("%-16s %11i  %12i  %4i%%  %7i\n", cl->name,
+				           cl->stat_bytes / cl->stat_frames,
+				           cl->stat_entitybytes / cl->stat_frames,
+				           cl->stat_deltaframes * 100 / cl->stat_frames,
+				           cl->stat_dropped);
+			}
+		}
 	}
 	else
 	if (Q_strcmp(Cmd_Argv(1), "*") == 0)
@@ -1229,7 +1246,10 @@ static qsocket_t* _Datagram_Connect(char *host)
 		goto ErrorReturn;
 
 	// send the connection request
-	Con_Printf("trying...\n"); SCR_UpdateScreen();
+	Con_Printf("trying...\n");
+	#ifndef DEDICATED_ONLY
+	SCR_UpdateScreen();
+	#endif
 	start_time = net_time;
 
 	for (reps = 0; reps < 3; reps++)
@@ -1256,8 +1276,10 @@ static qsocket_t* _Datagram_Connect(char *host)
 					Con_Printf("wrong reply address\n");
 					Con_Printf("Expected: %s\n", StrAddr(&sendaddr));
 					Con_Printf("Received: %s\n", StrAddr(&readaddr));
+					#ifndef DEDICATED_ONLY
 					SCR_UpdateScreen();
 					#endif
+					#endif
 					ret = 0;
 					continue;
 				}
@@ -1293,7 +1315,10 @@ static qsocket_t* _Datagram_Connect(char *host)
 		while (ret == 0 && (SetNetTime() - start_time) < 2.5);
 		if (ret)
 			break;
-		Con_Printf("still trying...\n"); SCR_UpdateScreen();
+		Con_Printf("still trying...\n");
+		#ifndef DEDICATED_ONLY
+		SCR_UpdateScreen();
+		#endif
 		start_time = SetNetTime();
 	}
 
@@ -1301,7 +1326,9 @@ static qsocket_t* _Datagram_Connect(char *host)
 	{
 		reason = "No Response";
 		Con_Printf("%s\n", reason);
+		#ifndef DEDICATED_ONLY
 		Q_strcpy(m_return_reason, reason);
+		#endif
 		goto ErrorReturn;
 	}
 
@@ -1309,7 +1336,9 @@ static qsocket_t* _Datagram_Connect(char *host)
 	{
 		reason = "Network Error";
 		Con_Printf("%s\n", reason);
+		#ifndef DEDICATED_ONLY
 		Q_strcpy(m_return_reason, reason);
+		#endif
 		goto ErrorReturn;
 	}
 
@@ -1318,7 +1347,9 @@ static qsocket_t* _Datagram_Connect(char *host)
 	{
 		reason = MSG_ReadString();
 		Con_Printf(reason);
+		#ifndef DEDICATED_ONLY
 		Q_strncpy(m_return_reason, reason, 31);
+		#endif
 		goto ErrorReturn;
 	}
 
@@ -1331,7 +1362,9 @@ static qsocket_t* _Datagram_Connect(char *host)
 	{
 		reason = "Bad Response";
 		Con_Printf("%s\n", reason);
+		#ifndef DEDICATED_ONLY
 		Q_strcpy(m_return_reason, reason);
+		#endif
 		goto ErrorReturn;
 	}
 
@@ -1345,23 +1378,29 @@ static qsocket_t* _Datagram_Connect(char *host)
 	{
 		reason = "Connect to Game failed";
 		Con_Printf("%s\n", reason);
+		#ifndef DEDICATED_ONLY
 		Q_strcpy(m_return_reason, reason);
+		#endif
 		goto ErrorReturn;
 	}
 
+	#ifndef DEDICATED_ONLY
 	m_return_onerror = false;
+	#endif
 	return sock;
 
 ErrorReturn:
 	NET_FreeQSocket(sock);
 ErrorReturn2:
 	dfunc.CloseSocket(newsock);
+	#ifndef DEDICATED_ONLY
 	if (m_return_onerror)
 	{
 		key_dest = key_menu;
 		m_state = m_return_state;
 		m_return_onerror = false;
 	}
+	#endif
 	return NULL;
 }
 
@@ -112,6 +112,7 @@ qsocket_t* NET_NewQSocket()
 	sock->driver = net_driverlevel;
 	sock->socket = 0;
 	sock->driverdata = NULL;
+	sock->vcrsession = 0;
 	sock->canSend = true;
 	sock->sendNext = false;
 	sock->lastMessageTime = net_time;
@@ -412,12 +413,27 @@ JustDoIt:
    ===================
  */
 
-struct
+/*
+   Every record in a vcr file starts with the host time, the operation and
+   the connection it was done on, numbered from 1 in the order they came in
+ */
+static int vcrSessions;
+
+static void NET_RecordOp(int op, int session)
 {
-	double time;
-	int op;
-	long session;
-} vcrConnect;
+	Sys_FileWrite(vcrFile, &host_time, sizeof(double));
+	Sys_FileWrite(vcrFile, &op, sizeof(int));
+	Sys_FileWrite(vcrFile, &session, sizeof(int));
+}
+
+void NET_RecordChecksum(unsigned checksum)
+{
+	if (!recording)
+		return;
+
+	NET_RecordOp(VCR_OP_CHECKSUM, 0);
+	Sys_FileWrite(vcrFile, &checksum, sizeof(unsigned));
+}
 
 qsocket_t* NET_CheckNewConnections()
 {
@@ -436,10 +452,8 @@ qsocket_t* NET_CheckNewConnections()
 		{
 			if (recording)
 			{
-				vcrConnect.time = host_time;
-				vcrConnect.op = VCR_OP_CONNECT;
-				vcrConnect.session = (long)ret;
-				Sys_FileWrite(vcrFile, &vcrConnect, sizeof(vcrConnect));
+				ret->vcrsession = ++vcrSessions;
+				NET_RecordOp(VCR_OP_CONNECT, ret->vcrsession);
 				Sys_FileWrite(vcrFile, ret->address, NET_NAMELEN);
 			}
 			return ret;
@@ -447,12 +461,7 @@ qsocket_t* NET_CheckNewConnections()
 	}
 
 	if (recording)
-	{
-		vcrConnect.time = host_time;
-		vcrConnect.op = VCR_OP_CONNECT;
-		vcrConnect.session = 0;
-		Sys_FileWrite(vcrFile, &vcrConnect, sizeof(vcrConnect));
-	}
+		NET_RecordOp(VCR_OP_CONNECT, 0);
 
 	return NULL;
 }
@@ -490,15 +499,6 @@ void NET_Close(qsocket_t *sock)
    =================
  */
 
-struct
-{
-	double time;
-	int op;
-	long session;
-	int ret;
-	int len;
-} vcrGetMessage;
-
 extern void PrintStats(qsocket_t *s);
 
 int NET_GetMessage(qsocket_t *sock)
@@ -542,12 +542,9 @@ int NET_GetMessage(qsocket_t *sock)
 
 		if (recording)
 		{
-			vcrGetMessage.time = host_time;
-			vcrGetMessage.op = VCR_OP_GETMESSAGE;
-			vcrGetMessage.session = (long)sock;
-			vcrGetMessage.ret = ret;
-			vcrGetMessage.len = net_message.cursize;
-			Sys_FileWrite(vcrFile, &vcrGetMessage, 24);
+			NET_RecordOp(VCR_OP_GETMESSAGE, sock->vcrsession);
+			Sys_FileWrite(vcrFile, &ret, sizeof(int));
+			Sys_FileWrite(vcrFile, &net_message.cursize, sizeof(int));
 			Sys_FileWrite(vcrFile, net_message.data, net_message.cursize);
 		}
 	}
@@ -555,11 +552,8 @@ int NET_GetMessage(qsocket_t *sock)
 	{
 		if (recording)
 		{
-			vcrGetMessage.time = host_time;
-			vcrGetMessage.op = VCR_OP_GETMESSAGE;
-			vcrGetMessage.session = (long)sock;
-			vcrGetMessage.ret = ret;
-			Sys_FileWrite(vcrFile, &vcrGetMessage, 20);
+			NET_RecordOp(VCR_OP_GETMESSAGE, sock->vcrsession);
+			Sys_FileWrite(vcrFile, &ret, sizeof(int));
 		}
 	}
 
@@ -577,14 +571,6 @@ int NET_GetMessage(qsocket_t *sock)
    returns -1 if the connection died
    ==================
  */
-struct
-{
-	double time;
-	int op;
-	long session;
-	int r;
-} vcrSendMessage;
-
 int NET_SendMessage(qsocket_t *sock, sizebuf_t *data)
 {
 	int r;
@@ -605,11 +591,8 @@ int NET_SendMessage(qsocket_t *sock, sizebuf_t *data)
 
 	if (recording)
 	{
-		vcrSendMessage.time = host_time;
-		vcrSendMessage.op = VCR_OP_SENDMESSAGE;
-		vcrSendMessage.session = (long)sock;
-		vcrSendMessage.r = r;
-		Sys_FileWrite(vcrFile, &vcrSendMessage, 20);
+		NET_RecordOp(VCR_OP_SENDMESSAGE, sock->vcrsession);
+		Sys_FileWrite(vcrFile, &r, sizeof(int));
 	}
 
 	return r;
@@ -635,11 +618,8 @@ int NET_SendUnreliableMessage(qsocket_t *sock, sizebuf_t *data)
 
 	if (recording)
 	{
-		vcrSendMessage.time = host_time;
-		vcrSendMessage.op = VCR_OP_SENDMESSAGE;
-		vcrSendMessage.session = (long)sock;
-		vcrSendMessage.r = r;
-		Sys_FileWrite(vcrFile, &vcrSendMessage, 20);
+		NET_RecordOp(VCR_OP_SENDMESSAGE, sock->vcrsession);
+		Sys_FileWrite(vcrFile, &r, sizeof(int));
 	}
 
 	return r;
@@ -669,11 +649,8 @@ qboolean NET_CanSendMessage(qsocket_t *sock)
 
 	if (recording)
 	{
-		vcrSendMessage.time = host_time;
-		vcrSendMessage.op = VCR_OP_CANSENDMESSAGE;
-		vcrSendMessage.session = (long)sock;
-		vcrSendMessage.r = r;
-		Sys_FileWrite(vcrFile, &vcrSendMessage, 20);
+		NET_RecordOp(VCR_OP_CANSENDMESSAGE, sock->vcrsession);
+		Sys_FileWrite(vcrFile, &r, sizeof(int));
 	}
 
 	return r;
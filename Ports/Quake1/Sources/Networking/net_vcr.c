@@ -19,6 +19,7 @@
  */
 // net_vcr.c
 
+#include "Client/console.h"
 #include "Common/quakedef.h"
 #include "Common/sys.h"
 #include "Networking/net_vcr.h"
@@ -35,9 +36,18 @@ static struct
 {
 	double time;
 	int op;
-	long session;
+	int session;
 }       next;
 
+static qboolean VCR_ReadHeader()
+{
+	if (Sys_FileRead(vcrFile, &next.time, sizeof(double)) != sizeof(double))
+		return false;
+	Sys_FileRead(vcrFile, &next.op, sizeof(int));
+	Sys_FileRead(vcrFile, &next.session, sizeof(int));
+	return true;
+}
+
 int VCR_Init()
 {
 	net_drivers[0].Init = VCR_Init;
@@ -51,21 +61,31 @@ int VCR_Init()
 	net_drivers[0].Close = VCR_Close;
 	net_drivers[0].Shutdown = VCR_Shutdown;
 
-	Sys_FileRead(vcrFile, &next, sizeof(next));
+	if (!VCR_ReadHeader())
+		next.op = 255;
 	return 0;
 }
 
 void VCR_ReadNext()
 {
-	if (Sys_FileRead(vcrFile, &next, sizeof(next)) == 0)
+	if (!VCR_ReadHeader())
 	{
+		// the recording is exhausted, report how the server did on it
 		next.op = 255;
-		Sys_Error("=== END OF PLAYBACK===\n");
+		Con_Printf("=== END OF PLAYBACK ===\n");
+		Host_BenchReport();
+		Sys_Quit();
 	}
 	if (next.op < 1 || next.op > VCR_MAX_MESSAGE)
 		Sys_Error("VCR_ReadNext: bad op");
 }
 
+static void VCR_Expect(int op, qsocket_t *sock)
+{
+	if (host_time != next.time || next.op != op || (sock && next.session != sock->vcrsession))
+		Sys_Error("VCR missmatch");
+}
+
 void VCR_Listen(qboolean state)
 {
 }
@@ -76,33 +96,28 @@ void VCR_Shutdown()
 
 int VCR_GetMessage(qsocket_t *sock)
 {
-    long *driverData = (long*)&sock->driverdata;
-	if (host_time != next.time || next.op != VCR_OP_GETMESSAGE || next.session != *driverData)
-		Sys_Error("VCR missmatch");
-
 	int ret;
+
+	VCR_Expect(VCR_OP_GETMESSAGE, sock);
+
 	Sys_FileRead(vcrFile, &ret, sizeof(int));
-	if (ret != 1)
+	if (ret > 0)
 	{
-		VCR_ReadNext();
-		return ret;
+		Sys_FileRead(vcrFile, &net_message.cursize, sizeof(int));
+		Sys_FileRead(vcrFile, net_message.data, net_message.cursize);
 	}
 
-	Sys_FileRead(vcrFile, &net_message.cursize, sizeof(int));
-	Sys_FileRead(vcrFile, net_message.data, net_message.cursize);
-
 	VCR_ReadNext();
 
-	return 1;
+	return ret;
 }
 
 int VCR_SendMessage(qsocket_t *sock, sizebuf_t *data)
 {
-    long *driverData = (long*)&sock->driverdata;
-	if (host_time != next.time || next.op != VCR_OP_SENDMESSAGE || next.session != *driverData)
-		Sys_Error("VCR missmatch");
-
 	int ret;
+
+	VCR_Expect(VCR_OP_SENDMESSAGE, sock);
+
 	Sys_FileRead(vcrFile, &ret, sizeof(int));
 
 	VCR_ReadNext();
@@ -112,11 +127,10 @@ int VCR_SendMessage(qsocket_t *sock, sizebuf_t *data)
 
 qboolean VCR_CanSendMessage(qsocket_t *sock)
 {
-    long *driverData = (long*)&sock->driverdata;
-	if (host_time != next.time || next.op != VCR_OP_CANSENDMESSAGE || next.session != *driverData)
-		Sys_Error("VCR missmatch");
+	int ret;
+
+	VCR_Expect(VCR_OP_CANSENDMESSAGE, sock);
 
-	qboolean ret;
 	Sys_FileRead(vcrFile, &ret, sizeof(int));
 
 	VCR_ReadNext();
@@ -124,6 +138,27 @@ qboolean VCR_CanSendMessage(qsocket_t *sock)
 	return ret;
 }
 
+/*
+   ================
+   VCR_Checksum
+
+   Compares the server state checksum of this frame with the one that was
+   recorded, returns false when the replay has drifted
+   ================
+ */
+qboolean VCR_Checksum(unsigned checksum)
+{
+	unsigned recorded;
+
+	VCR_Expect(VCR_OP_CHECKSUM, NULL);
+
+	Sys_FileRead(vcrFile, &recorded, sizeof(unsigned));
+
+	VCR_ReadNext();
+
+	return recorded == checksum;
+}
+
 void VCR_Close(qsocket_t *sock)
 {
 }
@@ -141,8 +176,7 @@ qsocket_t* VCR_CheckNewConnections()
 {
 	qsocket_t *sock;
 
-	if (host_time != next.time || next.op != VCR_OP_CONNECT)
-		Sys_Error("VCR missmatch");
+	VCR_Expect(VCR_OP_CONNECT, NULL);
 
 	if (!next.session)
 	{
@@ -151,8 +185,7 @@ qsocket_t* VCR_CheckNewConnections()
 	}
 
 	sock = NET_NewQSocket();
-    long *driverData = (long*)&sock->driverdata;
-	*driverData = next.session;
+	sock->vcrsession = next.session;
 
 	Sys_FileRead(vcrFile, sock->address, NET_NAMELEN);
 	VCR_ReadNext();
@@ -26,7 +26,8 @@
 #define VCR_OP_GETMESSAGE 2
 #define VCR_OP_SENDMESSAGE 3
 #define VCR_OP_CANSENDMESSAGE 4
-#define VCR_MAX_MESSAGE 4
+#define VCR_OP_CHECKSUM 5
+#define VCR_MAX_MESSAGE 5
 
 int VCR_Init();
 void VCR_Listen(qboolean state);
@@ -36,6 +37,7 @@ qsocket_t* VCR_CheckNewConnections();
 int VCR_GetMessage(qsocket_t *sock);
 int VCR_SendMessage(qsocket_t *sock, sizebuf_t *data);
 qboolean VCR_CanSendMessage(qsocket_t *sock);
+qboolean VCR_Checksum(unsigned checksum);
 void VCR_Close(qsocket_t *sock);
 void VCR_Shutdown();
 
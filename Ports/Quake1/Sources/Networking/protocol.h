@@ -129,6 +129,19 @@
 
 #define svc_cutscene 34
 
+#define svc_entityframe 35 // [long] frame [long] delta frame, -1 = baselines
+// the entity updates that follow are deltas from the delta frame
+
+// protocol extensions, offered by the server with a stuffed "pext"
+// and accepted by the client with "pext <bits>"
+#define PEXT_DELTA (1 << 0) // entity updates delta from acknowledged frames
+#define PEXT_SUPPORTED (PEXT_DELTA)
+
+#define UPDATE_BACKUP 16 // copies of entity frames kept for deltas, must be power of 2
+#define UPDATE_MASK (UPDATE_BACKUP - 1)
+#define MAX_PACKET_ENTITIES 256 // entity updates in a single frame
+#define MAX_FRAME_STATES (UPDATE_BACKUP * 64) // entity states kept for all frames
+
 //
 // client to server
 //
@@ -137,6 +150,7 @@
 #define clc_disconnect 2
 #define clc_move 3 // [usercmd_t]
 #define clc_stringcmd 4 // [string] message
+#define clc_ackframe 5 // [long] last complete entity frame, PEXT_DELTA only
 
 //
 // temp entity events
@@ -28,7 +28,9 @@
 #include "Rendering/r_model.h"
 #include "Rendering/r_private.h"
 
+#ifndef DEDICATED_ONLY
 #include "OpenGLES/OpenGLWrapper.h"
+#endif
 
 #include <string.h>
 
@@ -46,7 +48,13 @@ static byte mod_novis[MAX_MAP_LEAFS / 8];
 static model_t mod_known[MAX_MOD_KNOWN];
 static int mod_numknown;
 
+#ifdef DEDICATED_ONLY
+// the server never draws, it only needs texture names for the surface flags
+static texture_t mod_notexture = { "notexture" };
+texture_t *r_notexture_mip = &mod_notexture;
+#else
 void GL_MakeAliasModelDisplayLists(model_t *m, aliashdr_t *hdr, mtriangle_t *triangles, stvert_t *stverts);
+#endif
 
 void Mod_Init()
 {
@@ -324,10 +332,12 @@ static void Mod_LoadTextures(lump_t *l)
 		// the pixels immediately follow the structures
 		memcpy(tx + 1, mt + 1, pixels);
 
+		#ifndef DEDICATED_ONLY
 		if (!Q_strncmp(mt->name, "sky", 3))
 			R_Sky_init(tx);
 		else
 			tx->textureId = R_Texture_create(mt->name, tx->width, tx->height, (byte *)(tx + 1), true, false, true, true);
+		#endif
 	}
 
 	//
@@ -677,7 +687,9 @@ void Mod_LoadFaces(lump_t *l)
 		if (!Q_strncmp(out->texinfo->texture->name, "sky", 3)) // sky
 		{
 			out->flags |= (SURF_DRAWSKY | SURF_DRAWTILED);
+			#ifndef DEDICATED_ONLY
 			R_Surface_subdivide(loadmodel, out, r_sky_subdivision.value); // cut up polygon for warps
+			#endif
 			continue;
 		}
 
@@ -689,7 +701,9 @@ void Mod_LoadFaces(lump_t *l)
 				out->extents[i] = 16384;
 				out->texturemins[i] = -8192;
 			}
+			#ifndef DEDICATED_ONLY
 			R_Surface_subdivide(loadmodel, out, r_water_subdivision.value); // cut up polygon for warps
+			#endif
 			continue;
 		}
 	}
@@ -1140,6 +1154,7 @@ typedef struct
 	short x, y;
 } floodfill_t;
 
+#ifndef DEDICATED_ONLY
 extern unsigned d_8to24table[];
 
 // must be a power of 2
@@ -1210,11 +1225,14 @@ void Mod_FloodFillSkin(byte *skin, int skinwidth, int skinheight)
 		skin[x + skinwidth * y] = fdc;
 	}
 }
+#endif
 
 void* Mod_LoadAllSkins(aliashdr_t *pheader, int numskins, daliasskintype_t *pskintype)
 {
 	int i, j, k;
+	#ifndef DEDICATED_ONLY
 	char name[32];
+	#endif
 	int s;
 	byte *skin;
 	byte *texels;
@@ -1233,7 +1251,9 @@ void* Mod_LoadAllSkins(aliashdr_t *pheader, int numskins, daliasskintype_t *pski
 	{
 		if (pskintype->type == ALIAS_SKIN_SINGLE)
 		{
+			#ifndef DEDICATED_ONLY
 			Mod_FloodFillSkin(skin, pheader->skinwidth, pheader->skinheight);
+			#endif
 
 			// save 8 bit texels for the player model to remap
 			//		if (!strcmp(loadmodel->name,"progs/player.mdl")) {
@@ -1241,9 +1261,11 @@ void* Mod_LoadAllSkins(aliashdr_t *pheader, int numskins, daliasskintype_t *pski
 			pheader->texels[i] = texels - (byte *)pheader;
 			memcpy(texels, (byte *)(pskintype + 1), s);
 			//		}
+			#ifndef DEDICATED_ONLY
 			sprintf(name, "%s_%i", loadmodel->name, i);
             GLuint textureId = R_Texture_create(name, pheader->skinwidth, pheader->skinheight, (byte *)(pskintype + 1), true, false, true, true);
 			pheader->textureId[i][0] = pheader->textureId[i][1] = pheader->textureId[i][2] = pheader->textureId[i][3] = textureId;
+			#endif
 			                                
 			pskintype = (daliasskintype_t *)((byte *)(pskintype + 1) + s);
 		}
@@ -1259,15 +1281,19 @@ void* Mod_LoadAllSkins(aliashdr_t *pheader, int numskins, daliasskintype_t *pski
 
 			for (j = 0; j < groupskins; j++)
 			{
+				#ifndef DEDICATED_ONLY
 				Mod_FloodFillSkin(skin, pheader->skinwidth, pheader->skinheight);
+				#endif
 				if (j == 0)
 				{
 					texels = Hunk_AllocName(s, loadname);
 					pheader->texels[i] = texels - (byte *)pheader;
 					memcpy(texels, (byte *)(pskintype), s);
 				}
+				#ifndef DEDICATED_ONLY
 				sprintf(name, "%s_%i_%i", loadmodel->name, i, j);
 				pheader->textureId[i][j & 3] = R_Texture_create(name, pheader->skinwidth, pheader->skinheight, (byte *)(pskintype), true, false, true, true);
+				#endif
 				pskintype = (daliasskintype_t *)((byte *)(pskintype) + s);
 			}
 			k = j;
@@ -1403,7 +1429,9 @@ void Mod_LoadAliasModel(model_t *mod, void *buffer)
 	//
 	// build the draw lists
 	//
+	#ifndef DEDICATED_ONLY
 	GL_MakeAliasModelDisplayLists(mod, pheader, l_triangles, l_stverts);
+	#endif
 
 	//
 	// move the complete, relocatable alias model to the cache
@@ -1448,9 +1476,11 @@ void* Mod_LoadSpriteFrame(void *pin, mspriteframe_t **ppframe, int framenum)
 	pspriteframe->left = origin[0];
 	pspriteframe->right = width + origin[0];
 
+	#ifndef DEDICATED_ONLY
 	char name[64];
 	sprintf(name, "%s_%i", loadmodel->name, framenum);
 	pspriteframe->textureId = R_Texture_create(name, width, height, (byte *)(pinframe + 1), true, true, true, true);
+	#endif
 
 	return (void *)((byte *)pinframe + sizeof(dspriteframe_t) + size);
 }
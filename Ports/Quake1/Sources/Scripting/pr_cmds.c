@@ -849,17 +849,35 @@ void PF_findradius()
 	edict_t *ent, *chain;
 	float rad;
 	float *org;
-	vec3_t eorg;
-	int i, j;
+	vec3_t eorg, mins, maxs;
+	int i, j, count;
+	static edict_t *touch[MAX_EDICTS];
 
 	chain = (edict_t *)sv.edicts;
 
 	org = G_VECTOR(OFS_PARM0);
 	rad = G_FLOAT(OFS_PARM1);
 
-	ent = NEXT_EDICT(sv.edicts);
-	for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+	// anything whose center is within rad has its linked box touching this one
+	for (j = 0; j < 3; j++)
+	{
+		mins[j] = org[j] - rad;
+		maxs[j] = org[j] + rad;
+	}
+	count = SV_AreaEdicts(mins, maxs, touch, MAX_EDICTS);
+
+	// put them in edict order, so the chain comes out like a scan over all edicts did
+	for (i = 1; i < count; i++)
 	{
+		ent = touch[i];
+		for (j = i; j > 0 && touch[j - 1] > ent; j--)
+			touch[j] = touch[j - 1];
+		touch[j] = ent;
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		ent = touch[i];
 		if (ent->free)
 			continue;
 		if (ent->v.solid == SOLID_NOT)
@@ -942,6 +960,13 @@ void PF_Find()
 	if (!s)
 		PR_RunError("PF_Find: bad search string");
 
+	ed = ED_FindIndexed(e, f, s);
+	if (ed)
+	{
+		RETURN_EDICT(ed);
+		return;
+	}
+
 	for (e++; e < sv.num_edicts; e++)
 	{
 		ed = EDICT_NUM(e);
@@ -29,6 +29,7 @@
 #include "Server/server.h"
 #include "Server/world.h"
 
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -46,6 +47,14 @@ unsigned short pr_crc;
 
 int type_size[8] = { 1, sizeof(string_t) / 4, 1, 3, 1, 1, sizeof(func_t) / 4, sizeof(void *) / 4 };
 
+// what ED_Checksum hashes of each global and field, built by PR_LoadProgs
+#define SLOT_SKIP 0
+#define SLOT_RAW 1
+#define SLOT_STRING 2
+
+static byte *pr_globalslots;
+static byte *pr_fieldslots;
+
 ddef_t* ED_FieldAtOfs(int ofs);
 qboolean ED_ParseEpair(void *base, ddef_t *key, char *s);
 
@@ -61,16 +70,44 @@ cvar_t saved2 = { "saved2", "0", true };
 cvar_t saved3 = { "saved3", "0", true };
 cvar_t saved4 = { "saved4", "0", true };
 
-#define MAX_FIELD_LEN 64
-#define GEFV_CACHESIZE 2
+// name lookup for fields, globals and functions, built by PR_LoadProgs
+typedef struct
+{
+	int mask;
+	int *first; // lowest def index in each bucket, -1 for none
+	int *next; // next higher def index with the same hash
+} prhash_t;
+
+static prhash_t pr_fieldhash;
+static prhash_t pr_globalhash;
+static prhash_t pr_functionhash;
+
+// strings made by ED_NewString, shared between all edicts of a level
+#define STRINGHASH_SIZE 4096
+
+typedef struct prstring_s
+{
+	char *string;
+	struct prstring_s *next;
+} prstring_t;
+
+static prstring_t **pr_stringhash;
+
+// edicts by classname and targetname, so PF_Find only looks at the ones that
+// can match. Buckets are kept in edict order. An edict is moved when one of the
+// fields is stored to, and the field is checked again before it is returned
+#define FINDHASH_SIZE 1024
+#define NUM_FINDFIELDS 2
 
 typedef struct
 {
-	ddef_t *pcache;
-	char field[MAX_FIELD_LEN];
-} gefv_cache;
+	int first[FINDHASH_SIZE]; // lowest edict in each bucket, -1 for none
+	int next[MAX_EDICTS];
+	int bucket[MAX_EDICTS]; // -1 when the edict isn't in the index
+} prfindindex_t;
 
-static gefv_cache gefvCache[GEFV_CACHESIZE] = { { NULL, "" }, { NULL, "" } };
+static prfindindex_t *pr_findindex; // one per field in pr_findfields
+static int pr_findfields[NUM_FINDFIELDS] = { offsetof(entvars_t, classname) / 4, offsetof(entvars_t, targetname) / 4 };
 
 /*
    =================
@@ -83,6 +120,7 @@ void ED_ClearEdict(edict_t *e)
 {
 	memset(&e->v, 0, progs->entityfields * 4);
 	e->free = false;
+	ED_IndexEdict(e);
 }
 
 /*
@@ -148,6 +186,8 @@ void ED_Free(edict_t *ed)
 	ed->v.solid = 0;
 
 	ed->freetime = sv.time;
+	ed->linkcount = ++sv_linkcount;
+	ED_IndexEdict(ed);
 }
 
 //===========================================================================
@@ -190,6 +230,150 @@ ddef_t* ED_FieldAtOfs(int ofs)
 	return NULL;
 }
 
+static unsigned PR_HashName(char *name)
+{
+	unsigned hash = 0;
+
+	while (*name)
+		hash = hash * 31 + (byte)*name++;
+
+	return hash ^ (hash >> 16);
+}
+
+static void PR_InitHash(prhash_t *hash, int count, char *name)
+{
+	int size;
+
+	size = 64;
+	while (size < count * 2)
+		size <<= 1;
+
+	hash->mask = size - 1;
+	hash->first = Hunk_AllocName(size * sizeof(int), name);
+	hash->next = Hunk_AllocName(count * sizeof(int), name);
+	memset(hash->first, -1, size * sizeof(int));
+}
+
+/*
+   Defs are added from the highest index down so a lookup finds the
+   first def with a name, like the old linear search did
+ */
+static void PR_HashAdd(prhash_t *hash, int index, int s_name)
+{
+	int *first;
+
+	first = &hash->first[PR_HashName(pr_strings + s_name) & hash->mask];
+	hash->next[index] = *first;
+	*first = index;
+}
+
+static void ED_UnindexField(prfindindex_t *index, int num)
+{
+	int *link;
+
+	if (index->bucket[num] < 0)
+		return;
+
+	for (link = &index->first[index->bucket[num]]; *link != num; link = &index->next[*link])
+		;
+	*link = index->next[num];
+	index->bucket[num] = -1;
+}
+
+static void ED_IndexField(prfindindex_t *index, int num, char *s)
+{
+	int bucket;
+	int *link;
+
+	bucket = s[0] ? (int)(PR_HashName(s) & (FINDHASH_SIZE - 1)) : -1; // empty strings are searched for the slow way
+	if (index->bucket[num] == bucket)
+		return;
+
+	ED_UnindexField(index, num);
+	if (bucket < 0)
+		return;
+
+	for (link = &index->first[bucket]; *link >= 0 && *link < num; link = &index->next[*link])
+		;
+	index->next[num] = *link;
+	*link = num;
+	index->bucket[num] = bucket;
+}
+
+/*
+   =================
+   ED_IndexEdict
+
+   Puts the edict in the buckets for its current classname and targetname
+   =================
+ */
+void ED_IndexEdict(edict_t *ed)
+{
+	int i, num;
+
+	if (!pr_findindex)
+		return;
+
+	num = ((byte *)ed - (byte *)sv.edicts) / pr_edict_size; // loadgame parses edicts past sv.num_edicts
+	for (i = 0; i < NUM_FINDFIELDS; i++)
+	{
+		if (ed->free)
+			ED_UnindexField(&pr_findindex[i], num);
+		else
+			ED_IndexField(&pr_findindex[i], num, E_STRING(ed, pr_findfields[i]));
+	}
+}
+
+/*
+   =================
+   ED_StringStored
+
+   Called after the progs store a string through an entity field pointer
+   =================
+ */
+void ED_StringStored(int ofs)
+{
+	int num, field;
+
+	num = ofs / pr_edict_size;
+	field = (ofs - num * pr_edict_size - (int)offsetof(edict_t, v)) / 4;
+	if (field == pr_findfields[0] || field == pr_findfields[1])
+		ED_IndexEdict(EDICT_NUM(num));
+}
+
+/*
+   =================
+   ED_FindIndexed
+
+   Returns the first edict after start with the field set to s, or the world
+   if there is none. Returns NULL if the field isn't indexed.
+   =================
+ */
+edict_t* ED_FindIndexed(int start, int field, char *s)
+{
+	prfindindex_t *index;
+	edict_t *ed;
+	int i, num;
+
+	for (i = 0; i < NUM_FINDFIELDS; i++)
+		if (pr_findfields[i] == field)
+			break;
+	if (i == NUM_FINDFIELDS || !s[0] || !pr_findindex)
+		return NULL;
+
+	index = &pr_findindex[i];
+	for (num = index->first[PR_HashName(s) & (FINDHASH_SIZE - 1)]; num >= 0 && num < sv.num_edicts; num = index->next[num])
+	{
+		if (num <= start)
+			continue;
+		ed = EDICT_NUM(num);
+		if (!ed->free && !strcmp(E_STRING(ed, field), s))
+			return ed;
+	}
+
+	return sv.edicts;
+}
+
 /*
    ============
    ED_FindField
@@ -200,7 +384,7 @@ ddef_t* ED_FindField(char *name)
 	ddef_t *def;
 	int i;
 
-	for (i = 0; i < progs->numfielddefs; i++)
+	for (i = pr_fieldhash.first[PR_HashName(name) & pr_fieldhash.mask]; i >= 0; i = pr_fieldhash.next[i])
 	{
 		def = &pr_fielddefs[i];
 		if (!strcmp(pr_strings + def->s_name, name))
@@ -219,7 +403,7 @@ ddef_t* ED_FindGlobal(char *name)
 	ddef_t *def;
 	int i;
 
-	for (i = 0; i < progs->numglobaldefs; i++)
+	for (i = pr_globalhash.first[PR_HashName(name) & pr_globalhash.mask]; i >= 0; i = pr_globalhash.next[i])
 	{
 		def = &pr_globaldefs[i];
 		if (!strcmp(pr_strings + def->s_name, name))
@@ -238,7 +422,7 @@ dfunction_t* ED_FindFunction(char *name)
 	dfunction_t *func;
 	int i;
 
-	for (i = 0; i < progs->numfunctions; i++)
+	for (i = pr_functionhash.first[PR_HashName(name) & pr_functionhash.mask]; i >= 0; i = pr_functionhash.next[i])
 	{
 		func = &pr_functions[i];
 		if (!strcmp(pr_strings + func->s_name, name))
@@ -249,29 +433,9 @@ dfunction_t* ED_FindFunction(char *name)
 
 eval_t* GetEdictFieldValue(edict_t *ed, char *field)
 {
-	ddef_t *def = NULL;
-	int i;
-	static int rep = 0;
-
-	for (i = 0; i < GEFV_CACHESIZE; i++)
-	{
-		if (!strcmp(field, gefvCache[i].field))
-		{
-			def = gefvCache[i].pcache;
-			goto Done;
-		}
-	}
+	ddef_t *def;
 
 	def = ED_FindField(field);
-
-	if (strlen(field) < MAX_FIELD_LEN)
-	{
-		gefvCache[rep].pcache = def;
-		strcpy(gefvCache[rep].field, field);
-		rep ^= 1;
-	}
-
-Done:
 	if (!def)
 		return NULL;
 
@@ -607,6 +771,61 @@ void ED_Count()
 	Con_Printf("step      :%3i\n", step);
 }
 
+/*
+   =============
+   ED_Checksum
+
+   Hashes the globals and the fields of every edict in use, so two runs of
+   the same vcr recording can be told apart as soon as they go different ways.
+   Strings are hashed by their text, their offsets may point outside
+   pr_strings and move with the process layout.  Temporaries without a def
+   are left out
+   =============
+ */
+static unsigned ED_HashSlots(unsigned hash, int *v, byte *slots, int count)
+{
+	char *c;
+	int i;
+
+	for (i = 0; i < count; i++)
+	{
+		if (slots[i] == SLOT_RAW)
+			hash = (hash ^ v[i]) * 16777619u;
+		else
+		if (slots[i] == SLOT_STRING)
+		{
+			for (c = pr_strings + v[i]; *c; c++)
+				hash = (hash ^ (byte)*c) * 16777619u;
+			hash = (hash ^ 0xff) * 16777619u;
+		}
+	}
+
+	return hash;
+}
+
+unsigned ED_Checksum()
+{
+	unsigned hash;
+	int e;
+	edict_t *ent;
+
+	hash = 2166136261u;
+
+	hash = ED_HashSlots(hash, (int *)pr_globals, pr_globalslots, progs->numglobals);
+
+	for (e = 0; e < sv.num_edicts; e++)
+	{
+		ent = EDICT_NUM(e);
+		hash = (hash ^ ent->free) * 16777619u;
+		if (ent->free)
+			continue;
+
+		hash = ED_HashSlots(hash, (int *)&ent->v, pr_fieldslots, progs->entityfields);
+	}
+
+	return hash;
+}
+
 /*
    ==============================================================================
 
@@ -699,9 +918,11 @@ void ED_ParseGlobals(char *data)
  */
 char* ED_NewString(char *string)
 {
+	prstring_t *str, **link;
 	char *new, *new_p;
-	int i, l;
+	int i, l, mark;
 
+	mark = Hunk_LowMark();
 	l = strlen(string) + 1;
 	new = Hunk_Alloc(l);
 	new_p = new;
@@ -720,6 +941,22 @@ char* ED_NewString(char *string)
 			*new_p++ = string[i];
 	}
 
+	// entities repeat the same classnames, targets and messages a lot
+	link = &pr_stringhash[PR_HashName(new) & (STRINGHASH_SIZE - 1)];
+	for (str = *link; str; str = str->next)
+	{
+		if (!strcmp(str->string, new))
+		{
+			Hunk_FreeToLowMark(mark);
+			return str->string;
+		}
+	}
+
+	str = Hunk_Alloc(sizeof(*str));
+	str->string = new;
+	str->next = *link;
+	*link = str;
+
 	return new;
 }
 
@@ -889,6 +1126,8 @@ char* ED_ParseEdict(char *data, edict_t *ent)
 	if (!init)
 		ent->free = true;
 
+	ED_IndexEdict(ent);
+
 	return data;
 }
 
@@ -982,14 +1221,40 @@ void ED_LoadFromFile(char *data)
 	Con_DPrintf("%i entities inhibited\n", inhibit);
 }
 
+static byte* PR_ClassifySlots(ddef_t *defs, int numdefs, int numslots, char *name)
+{
+	byte *slots;
+	int i, j, type;
+
+	slots = Hunk_AllocName(numslots, name);
+	memset(slots, SLOT_SKIP, numslots);
+
+	for (i = 0; i < numdefs; i++)
+	{
+		type = defs[i].type & ~DEF_SAVEGLOBAL;
+		if (type < 0 || type >= (int)(sizeof(type_size) / sizeof(type_size[0])))
+			continue;
+
+		for (j = 0; j < type_size[type]; j++)
+		{
+			if (defs[i].ofs + j >= numslots)
+				break;
+
+			if (type == ev_string)
+				slots[defs[i].ofs + j] = SLOT_STRING;
+			else
+			if (slots[defs[i].ofs + j] == SLOT_SKIP)
+				slots[defs[i].ofs + j] = SLOT_RAW;
+		}
+	}
+
+	return slots;
+}
+
 void PR_LoadProgs()
 {
 	int i;
 
-	// flush the non-C variable lookup cache
-	for (i = 0; i < GEFV_CACHESIZE; i++)
-		gefvCache[i].field[0] = 0;
-
 	CRC_Init(&pr_crc);
 
 	progs = (dprograms_t *)COM_LoadHunkFile("progs.dat");
@@ -1057,6 +1322,29 @@ void PR_LoadProgs()
 
 	for (i = 0; i < progs->numglobals; i++)
 		((int *)pr_globals)[i] = LittleLong(((int *)pr_globals)[i]);
+
+	PR_InitHash(&pr_fieldhash, progs->numfielddefs, "fieldhash");
+	for (i = progs->numfielddefs - 1; i >= 0; i--)
+		PR_HashAdd(&pr_fieldhash, i, pr_fielddefs[i].s_name);
+
+	PR_InitHash(&pr_globalhash, progs->numglobaldefs, "globalhash");
+	for (i = progs->numglobaldefs - 1; i >= 0; i--)
+		PR_HashAdd(&pr_globalhash, i, pr_globaldefs[i].s_name);
+
+	PR_InitHash(&pr_functionhash, progs->numfunctions, "funchash");
+	for (i = progs->numfunctions - 1; i >= 0; i--)
+		PR_HashAdd(&pr_functionhash, i, pr_functions[i].s_name);
+
+	pr_stringhash = Hunk_AllocName(STRINGHASH_SIZE * sizeof(prstring_t *), "strhash");
+
+	pr_findindex = Hunk_AllocName(NUM_FINDFIELDS * sizeof(prfindindex_t), "findindex");
+	memset(pr_findindex, -1, NUM_FINDFIELDS * sizeof(prfindindex_t));
+
+	pr_globalslots = PR_ClassifySlots(pr_globaldefs, progs->numglobaldefs, progs->numglobals, "globalslots");
+	pr_fieldslots = PR_ClassifySlots(pr_fielddefs, progs->numfielddefs, progs->entityfields, "fieldslots");
+
+	PR_DecodeStatements();
+	PR_InitProfile();
 }
 
 void PR_Init()
@@ -1065,6 +1353,7 @@ void PR_Init()
 	Cmd_AddCommand("edicts", ED_PrintEdicts);
 	Cmd_AddCommand("edictcount", ED_Count);
 	Cmd_AddCommand("profile", PR_Profile_f);
+	Cvar_RegisterVariable(&pr_profile);
 	Cvar_RegisterVariable(&nomonsters);
 	Cvar_RegisterVariable(&gamecfg);
 	Cvar_RegisterVariable(&scratch1);
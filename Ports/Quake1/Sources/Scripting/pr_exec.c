@@ -19,11 +19,16 @@
  */
 
 #include "Client/console.h"
+#include "Common/cmd.h"
+#include "Common/common.h"
+#include "Common/cvar.h"
 #include "Common/sys.h"
+#include "Common/zone.h"
 #include "Scripting/progs.h"
 #include "Server/server.h"
 
 #include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 
 typedef struct
@@ -46,6 +51,8 @@ int pr_xstatement;
 
 int pr_argc;
 
+cvar_t pr_profile = { "pr_profile", "0" }; // count statements per function, see PR_Profile_f
+
 char *pr_opnames[] =
 {
 	"DONE",
@@ -212,10 +219,261 @@ void PR_StackTrace()
 	}
 }
 
+/*
+   ============================================================================
+   Profiling
+
+   With pr_profile set, every script function and builtin call is timed.
+   Each function gets inclusive and exclusive time and a call count, and
+   the exclusive time is also kept per call path so "profile folded" can
+   write stacks for flamegraph tools.
+   ============================================================================
+ */
+
+#define MAX_PROFILE_NODES 8192
+#define MAX_PROFILE_DEPTH (MAX_STACK_DEPTH * 3)
+
+typedef struct
+{
+	double total; // inclusive, counted once through recursion
+	double self; // exclusive
+	int calls;
+	int active; // activations on the profile stack
+} prfuncprofile_t;
+
+typedef struct
+{
+	int func; // index into pr_functions
+	int parent;
+	int child; // first callee
+	int sibling;
+	double self;
+	int calls;
+} prprofnode_t;
+
+typedef struct
+{
+	int func;
+	int node;
+	double start;
+	double children; // time spent in callees
+} prprofframe_t;
+
+static prfuncprofile_t *pr_funcprofile;
+
+// node 0 is the engine, top level calls hang off it
+static prprofnode_t pr_profnodes[MAX_PROFILE_NODES];
+static int pr_numprofnodes;
+
+static prprofframe_t pr_profstack[MAX_PROFILE_DEPTH];
+static int pr_profdepth;
+
+static void PR_ResetProfile()
+{
+	int i;
+
+	for (i = 0; i < progs->numfunctions; i++)
+		pr_functions[i].profile = 0;
+	memset(pr_funcprofile, 0, progs->numfunctions * sizeof(prfuncprofile_t));
+
+	pr_profnodes[0].func = 0;
+	pr_profnodes[0].parent = -1;
+	pr_profnodes[0].child = -1;
+	pr_profnodes[0].sibling = -1;
+	pr_numprofnodes = 1;
+	pr_profdepth = 0;
+}
+
+/*
+   ============
+   PR_InitProfile
+
+   Called by PR_LoadProgs
+   ============
+ */
+void PR_InitProfile()
+{
+	pr_funcprofile = Hunk_AllocName(progs->numfunctions * sizeof(prfuncprofile_t), "profile");
+	PR_ResetProfile();
+}
+
+static void PR_ProfileEnter(int fnum)
+{
+	prprofframe_t *frame;
+	prprofnode_t *node;
+	int parent, n;
+
+	if (pr_profdepth >= MAX_PROFILE_DEPTH)
+	{
+		pr_profdepth++;
+		return;
+	}
+
+	parent = pr_profdepth ? pr_profstack[pr_profdepth - 1].node : 0;
+	for (n = pr_profnodes[parent].child; n >= 0; n = pr_profnodes[n].sibling)
+	{
+		if (pr_profnodes[n].func == fnum)
+			break;
+	}
+
+	if (n < 0)
+	{
+		if (pr_numprofnodes < MAX_PROFILE_NODES)
+		{
+			n = pr_numprofnodes++;
+			node = &pr_profnodes[n];
+			node->func = fnum;
+			node->parent = parent;
+			node->child = -1;
+			node->sibling = pr_profnodes[parent].child;
+			node->self = 0;
+			node->calls = 0;
+			pr_profnodes[parent].child = n;
+		}
+		else
+			n = parent; // out of nodes, charge the caller's path
+	}
+
+	pr_profnodes[n].calls++;
+	pr_funcprofile[fnum].calls++;
+	pr_funcprofile[fnum].active++;
+
+	frame = &pr_profstack[pr_profdepth++];
+	frame->func = fnum;
+	frame->node = n;
+	frame->children = 0;
+	frame->start = Sys_ProfileTime();
+}
+
+static void PR_ProfileLeave()
+{
+	prprofframe_t *frame;
+	prfuncprofile_t *fp;
+	double elapsed, self;
+
+	if (pr_profdepth <= 0)
+		return;
+	if (--pr_profdepth >= MAX_PROFILE_DEPTH)
+		return;
+
+	frame = &pr_profstack[pr_profdepth];
+	fp = &pr_funcprofile[frame->func];
+
+	elapsed = Sys_ProfileTime() - frame->start;
+	self = elapsed - frame->children;
+
+	pr_profnodes[frame->node].self += self;
+	fp->self += self;
+	if (!--fp->active)
+		fp->total += elapsed;
+
+	if (pr_profdepth)
+		pr_profstack[pr_profdepth - 1].children += elapsed;
+}
+
+/*
+   Drops frames left on the profile stack by a program that was aborted
+   with PR_RunError or Host_Error
+ */
+static void PR_ProfileUnwind()
+{
+	while (pr_profdepth > 0)
+	{
+		pr_profdepth--;
+		if (pr_profdepth < MAX_PROFILE_DEPTH)
+			pr_funcprofile[pr_profstack[pr_profdepth].func].active--;
+	}
+}
+
+static void PR_ProfileFolded(char *filename)
+{
+	char name[MAX_OSPATH];
+	int path[MAX_PROFILE_DEPTH + 1];
+	FILE *f;
+	int i, n, depth;
+
+	if (strstr(filename, "..") || strchr(filename, '/') || strchr(filename, '\\'))
+	{
+		Con_Printf("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	if (snprintf(name, sizeof(name), "%s/%s", com_writableGamedir, filename) >= (int)sizeof(name))
+	{
+		Con_Printf("ERROR: file name too long.\n");
+		return;
+	}
+	f = fopen(name, "w");
+	if (!f)
+	{
+		Con_Printf("ERROR: couldn't open %s.\n", name);
+		return;
+	}
+
+	// one line per call path, exclusive microseconds as the sample count
+	for (i = 1; i < pr_numprofnodes; i++)
+	{
+		if (pr_profnodes[i].self < 0.0000005)
+			continue;
+
+		depth = 0;
+		for (n = i; n > 0 && depth <= MAX_PROFILE_DEPTH; n = pr_profnodes[n].parent)
+			path[depth++] = n;
+
+		while (depth--)
+			fprintf(f, "%s%s", pr_strings + pr_functions[pr_profnodes[path[depth]].func].s_name, depth ? ";" : " ");
+		fprintf(f, "%.0f\n", pr_profnodes[i].self * 1000000.0);
+	}
+
+	fclose(f);
+	Con_Printf("Wrote %i call paths to %s\n", pr_numprofnodes - 1, name);
+}
+
+static void PR_ProfileTimes()
+{
+	prfuncprofile_t *fp;
+	dfunction_t *f;
+	int best[10];
+	int i, j, num;
+
+	num = 0;
+	for (i = 0; i < progs->numfunctions; i++)
+	{
+		if (!pr_funcprofile[i].calls)
+			continue;
+
+		// insertion into the ten highest exclusive times
+		for (j = num; j > 0 && pr_funcprofile[best[j - 1]].self < pr_funcprofile[i].self; j--)
+		{
+			if (j < 10)
+				best[j] = best[j - 1];
+		}
+		if (j < 10)
+			best[j] = i;
+		if (num < 10)
+			num++;
+	}
+
+	if (!num)
+		return;
+
+	Con_Printf("   self ms   total ms    calls\n");
+	for (i = 0; i < num; i++)
+	{
+		fp = &pr_funcprofile[best[i]];
+		f = &pr_functions[best[i]];
+		Con_Printf("%10.3f %10.3f %8i %s%s\n", fp->self * 1000.0, fp->total * 1000.0, fp->calls,
+		        pr_strings + f->s_name, f->first_statement < 0 ? " (builtin)" : "");
+	}
+}
+
 /*
    ============
    PR_Profile_f
 
+   profile : statement counts and the most expensive functions
+   profile reset : clear everything that was gathered
+   profile folded [file] : write call stacks for flamegraph tools
    ============
  */
 void PR_Profile_f()
@@ -225,6 +483,20 @@ void PR_Profile_f()
 	int num;
 	int i;
 
+	if (!sv.active)
+		return;
+
+	if (Cmd_Argc() > 1)
+	{
+		if (!strcmp(Cmd_Argv(1), "reset"))
+			PR_ResetProfile();
+		else if (!strcmp(Cmd_Argv(1), "folded"))
+			PR_ProfileFolded(Cmd_Argc() > 2 ? Cmd_Argv(2) : "profile.folded");
+		else
+			Con_Printf("usage: profile [reset | folded [file]]\n");
+		return;
+	}
+
 	num = 0;
 	do
 	{
@@ -248,6 +520,11 @@ void PR_Profile_f()
 		}
 	}
 	while (best);
+
+	PR_ProfileTimes();
+
+	if (!num && !pr_profile.value)
+		Con_Printf("set pr_profile 1 to count statements per function\n");
 }
 
 /*
@@ -342,22 +619,322 @@ int PR_LeaveFunction()
 	return pr_stack[pr_depth].s;
 }
 
+/*
+   ============================================================================
+   Threaded code
+
+   PR_DecodeStatements turns pr_statements into pr_code once at load time.
+   Operand offsets become pointers into pr_globals, branch offsets become
+   absolute statement numbers, and a few statement pairs that pass a value
+   through a temp are fused into one superinstruction.
+   ============================================================================
+ */
+
+// superinstructions, numbered after the last real opcode
+enum
+{
+	OPX_LOAD_STORE = OP_BITOR + 1, // LOAD_F/S/ENT/FLD/FNC then STORE of the loaded temp
+	OPX_LOAD_STORE_V,
+
+	// compare then IF/IFNOT on the result
+	OPX_EQ_F_IF,
+	OPX_EQ_F_IFNOT,
+	OPX_NE_F_IF,
+	OPX_NE_F_IFNOT,
+	OPX_LE_IF,
+	OPX_LE_IFNOT,
+	OPX_GE_IF,
+	OPX_GE_IFNOT,
+	OPX_LT_IF,
+	OPX_LT_IFNOT,
+	OPX_GT_IF,
+	OPX_GT_IFNOT,
+	OPX_EQ_E_IF,
+	OPX_EQ_E_IFNOT,
+	OPX_NE_E_IF,
+	OPX_NE_E_IFNOT,
+	OPX_NOT_F_IF,
+	OPX_NOT_F_IFNOT,
+	OPX_NOT_ENT_IF,
+	OPX_NOT_ENT_IFNOT,
+
+	OPX_BAD, // unknown opcode, the raw number is kept in jump
+
+	OPX_NUMOPS
+};
+
+typedef struct
+{
+	int op;
+	int jump; // branch target statement, or argument count for calls
+	eval_t *a, *b, *c;
+	eval_t *d; // store destination of a fused LOAD+STORE
+} prcode_t;
+
+static prcode_t *pr_code;
+
+static int PR_FusedBranch(int op)
+{
+	switch (op)
+	{
+	case OP_EQ_F: return OPX_EQ_F_IF;
+	case OP_NE_F: return OPX_NE_F_IF;
+	case OP_LE: return OPX_LE_IF;
+	case OP_GE: return OPX_GE_IF;
+	case OP_LT: return OPX_LT_IF;
+	case OP_GT: return OPX_GT_IF;
+	case OP_EQ_E: return OPX_EQ_E_IF;
+	case OP_NE_E: return OPX_NE_E_IF;
+	case OP_NOT_F: return OPX_NOT_F_IF;
+	case OP_NOT_ENT: return OPX_NOT_ENT_IF;
+	default: return 0;
+	}
+}
+
+static qboolean PR_IsIntLoad(int op)
+{
+	return op >= OP_LOAD_F && op <= OP_LOAD_FNC && op != OP_LOAD_V;
+}
+
+static qboolean PR_IsIntStore(int op)
+{
+	return op >= OP_STORE_F && op <= OP_STORE_FNC && op != OP_STORE_V;
+}
+
 /*
    ====================
-   PR_ExecuteProgram
+   PR_DecodeStatements
+
+   Called by PR_LoadProgs once the statements are byte swapped
    ====================
  */
-void PR_ExecuteProgram(func_t fnum)
+void PR_DecodeStatements()
+{
+	dstatement_t *st;
+	prcode_t *code;
+	int i, fused;
+
+	pr_code = Hunk_AllocName(progs->numstatements * sizeof(prcode_t), "prcode");
+
+	for (i = 0; i < progs->numstatements; i++)
+	{
+		st = &pr_statements[i];
+		code = &pr_code[i];
+
+		code->op = st->op;
+		code->jump = 0;
+		code->a = (eval_t *)&pr_globals[st->a];
+		code->b = (eval_t *)&pr_globals[st->b];
+		code->c = (eval_t *)&pr_globals[st->c];
+		code->d = NULL;
+
+		if (st->op == OP_IF || st->op == OP_IFNOT)
+			code->jump = i + st->b;
+		else if (st->op == OP_GOTO)
+			code->jump = i + st->a;
+		else if (st->op >= OP_CALL0 && st->op <= OP_CALL8)
+			code->jump = st->op - OP_CALL0;
+		else if (st->op > OP_BITOR)
+		{
+			code->op = OPX_BAD;
+			code->jump = st->op;
+		}
+	}
+
+	// the first statement of a pair takes the fused op and the second keeps
+	// its own, so a branch straight to the second one still runs it alone
+	for (i = 0; i < progs->numstatements - 1; i++)
+	{
+		st = &pr_statements[i];
+		code = &pr_code[i];
+
+		if (st[1].a != st->c)
+			continue;
+
+		if (PR_IsIntLoad(st->op) && PR_IsIntStore(st[1].op))
+		{
+			code->op = OPX_LOAD_STORE;
+			code->d = code[1].b;
+		}
+		else if (st->op == OP_LOAD_V && st[1].op == OP_STORE_V)
+		{
+			code->op = OPX_LOAD_STORE_V;
+			code->d = code[1].b;
+		}
+		else if (st[1].op == OP_IF || st[1].op == OP_IFNOT)
+		{
+			fused = PR_FusedBranch(st->op);
+			if (!fused)
+				continue;
+			code->op = fused + (st[1].op == OP_IFNOT);
+			code->jump = code[1].jump;
+		}
+	}
+}
+
+/*
+   ====================
+   PR_RunProgram
+
+   Runs from pr_code, and only drops to the plain statement loop below it
+   when pr_profile is set or a builtin turns tracing on.
+   pr_xstatement is only stored where something can call PR_RunError, and
+   runaway is charged for a whole straight run of statements at each taken
+   branch, call and return.
+   ====================
+ */
+#ifdef __GNUC__
+#define PR_OP(op) op_ ## op:
+#define PR_DISPATCH goto *dispatch[code->op]
+#else
+#define PR_OP(op) case op:
+#define PR_DISPATCH continue
+#endif
+
+#define PR_NEXT code++; PR_DISPATCH
+
+// charge the run ending n statements after code
+#define PR_ENDRUN(n) runaway -= code - run + (n)
+
+#define PR_BRANCH(n) \
+	PR_ENDRUN(n); \
+	if (runaway <= 0) \
+	{ \
+		pr_xstatement = code - pr_code + (n) - 1; \
+		PR_RunError("runaway loop error"); \
+	} \
+	code = run = pr_code + code->jump; \
+	PR_DISPATCH
+
+#define PR_FUSED_BRANCH(op, test) \
+	PR_OP(op ## _IF) \
+	t = (test); \
+	code->c->_float = t; \
+	if (t) \
+	{ \
+		PR_BRANCH(2); \
+	} \
+	code += 2; \
+	PR_DISPATCH; \
+	PR_OP(op ## _IFNOT) \
+	t = (test); \
+	code->c->_float = t; \
+	if (!t) \
+	{ \
+		PR_BRANCH(2); \
+	} \
+	code += 2; \
+	PR_DISPATCH;
+
+static void PR_RunProgram(func_t fnum)
 {
 	eval_t *a, *b, *c;
 	int s;
 	dstatement_t *st;
 	dfunction_t *f, *newf;
 	int runaway;
-	int i;
+	int i, t;
+	vec3_t v;
 	edict_t *ed;
 	int exitdepth;
 	eval_t *ptr;
+	prcode_t *code, *run;
+	qboolean profiling;
+
+#ifdef __GNUC__
+	static const void *dispatch[OPX_NUMOPS] =
+	{
+		[OP_DONE] = &&op_OP_DONE,
+		[OP_MUL_F] = &&op_OP_MUL_F,
+		[OP_MUL_V] = &&op_OP_MUL_V,
+		[OP_MUL_FV] = &&op_OP_MUL_FV,
+		[OP_MUL_VF] = &&op_OP_MUL_VF,
+		[OP_DIV_F] = &&op_OP_DIV_F,
+		[OP_ADD_F] = &&op_OP_ADD_F,
+		[OP_ADD_V] = &&op_OP_ADD_V,
+		[OP_SUB_F] = &&op_OP_SUB_F,
+		[OP_SUB_V] = &&op_OP_SUB_V,
+		[OP_EQ_F] = &&op_OP_EQ_F,
+		[OP_EQ_V] = &&op_OP_EQ_V,
+		[OP_EQ_S] = &&op_OP_EQ_S,
+		[OP_EQ_E] = &&op_OP_EQ_E,
+		[OP_EQ_FNC] = &&op_OP_EQ_FNC,
+		[OP_NE_F] = &&op_OP_NE_F,
+		[OP_NE_V] = &&op_OP_NE_V,
+		[OP_NE_S] = &&op_OP_NE_S,
+		[OP_NE_E] = &&op_OP_NE_E,
+		[OP_NE_FNC] = &&op_OP_NE_FNC,
+		[OP_LE] = &&op_OP_LE,
+		[OP_GE] = &&op_OP_GE,
+		[OP_LT] = &&op_OP_LT,
+		[OP_GT] = &&op_OP_GT,
+		[OP_LOAD_F] = &&op_OP_LOAD_F,
+		[OP_LOAD_V] = &&op_OP_LOAD_V,
+		[OP_LOAD_S] = &&op_OP_LOAD_S,
+		[OP_LOAD_ENT] = &&op_OP_LOAD_ENT,
+		[OP_LOAD_FLD] = &&op_OP_LOAD_FLD,
+		[OP_LOAD_FNC] = &&op_OP_LOAD_FNC,
+		[OP_ADDRESS] = &&op_OP_ADDRESS,
+		[OP_STORE_F] = &&op_OP_STORE_F,
+		[OP_STORE_V] = &&op_OP_STORE_V,
+		[OP_STORE_S] = &&op_OP_STORE_S,
+		[OP_STORE_ENT] = &&op_OP_STORE_ENT,
+		[OP_STORE_FLD] = &&op_OP_STORE_FLD,
+		[OP_STORE_FNC] = &&op_OP_STORE_FNC,
+		[OP_STOREP_F] = &&op_OP_STOREP_F,
+		[OP_STOREP_V] = &&op_OP_STOREP_V,
+		[OP_STOREP_S] = &&op_OP_STOREP_S,
+		[OP_STOREP_ENT] = &&op_OP_STOREP_ENT,
+		[OP_STOREP_FLD] = &&op_OP_STOREP_FLD,
+		[OP_STOREP_FNC] = &&op_OP_STOREP_FNC,
+		[OP_RETURN] = &&op_OP_RETURN,
+		[OP_NOT_F] = &&op_OP_NOT_F,
+		[OP_NOT_V] = &&op_OP_NOT_V,
+		[OP_NOT_S] = &&op_OP_NOT_S,
+		[OP_NOT_ENT] = &&op_OP_NOT_ENT,
+		[OP_NOT_FNC] = &&op_OP_NOT_FNC,
+		[OP_IF] = &&op_OP_IF,
+		[OP_IFNOT] = &&op_OP_IFNOT,
+		[OP_CALL0] = &&op_OP_CALL0,
+		[OP_CALL1] = &&op_OP_CALL1,
+		[OP_CALL2] = &&op_OP_CALL2,
+		[OP_CALL3] = &&op_OP_CALL3,
+		[OP_CALL4] = &&op_OP_CALL4,
+		[OP_CALL5] = &&op_OP_CALL5,
+		[OP_CALL6] = &&op_OP_CALL6,
+		[OP_CALL7] = &&op_OP_CALL7,
+		[OP_CALL8] = &&op_OP_CALL8,
+		[OP_STATE] = &&op_OP_STATE,
+		[OP_GOTO] = &&op_OP_GOTO,
+		[OP_AND] = &&op_OP_AND,
+		[OP_OR] = &&op_OP_OR,
+		[OP_BITAND] = &&op_OP_BITAND,
+		[OP_BITOR] = &&op_OP_BITOR,
+		[OPX_LOAD_STORE] = &&op_OPX_LOAD_STORE,
+		[OPX_LOAD_STORE_V] = &&op_OPX_LOAD_STORE_V,
+		[OPX_EQ_F_IF] = &&op_OPX_EQ_F_IF,
+		[OPX_EQ_F_IFNOT] = &&op_OPX_EQ_F_IFNOT,
+		[OPX_NE_F_IF] = &&op_OPX_NE_F_IF,
+		[OPX_NE_F_IFNOT] = &&op_OPX_NE_F_IFNOT,
+		[OPX_LE_IF] = &&op_OPX_LE_IF,
+		[OPX_LE_IFNOT] = &&op_OPX_LE_IFNOT,
+		[OPX_GE_IF] = &&op_OPX_GE_IF,
+		[OPX_GE_IFNOT] = &&op_OPX_GE_IFNOT,
+		[OPX_LT_IF] = &&op_OPX_LT_IF,
+		[OPX_LT_IFNOT] = &&op_OPX_LT_IFNOT,
+		[OPX_GT_IF] = &&op_OPX_GT_IF,
+		[OPX_GT_IFNOT] = &&op_OPX_GT_IFNOT,
+		[OPX_EQ_E_IF] = &&op_OPX_EQ_E_IF,
+		[OPX_EQ_E_IFNOT] = &&op_OPX_EQ_E_IFNOT,
+		[OPX_NE_E_IF] = &&op_OPX_NE_E_IF,
+		[OPX_NE_E_IFNOT] = &&op_OPX_NE_E_IFNOT,
+		[OPX_NOT_F_IF] = &&op_OPX_NOT_F_IF,
+		[OPX_NOT_F_IFNOT] = &&op_OPX_NOT_F_IFNOT,
+		[OPX_NOT_ENT_IF] = &&op_OPX_NOT_ENT_IF,
+		[OPX_NOT_ENT_IFNOT] = &&op_OPX_NOT_ENT_IFNOT,
+		[OPX_BAD] = &&op_OPX_BAD
+	};
+#endif
 
 	if (!fnum || fnum >= progs->numfunctions)
 	{
@@ -374,8 +951,352 @@ void PR_ExecuteProgram(func_t fnum)
 	// make a stack frame
 	exitdepth = pr_depth;
 
+	profiling = pr_profile.value != 0;
+	if (profiling)
+	{
+		if (!exitdepth)
+			PR_ProfileUnwind();
+		PR_ProfileEnter(fnum);
+	}
+
 	s = PR_EnterFunction(f);
 
+	if (profiling)
+		goto statements;
+
+	code = run = pr_code + s + 1;
+
+#ifdef __GNUC__
+	PR_DISPATCH;
+#else
+	while (1)
+	{
+		switch (code->op)
+		{
+#endif
+
+	PR_OP(OP_ADD_F)
+	code->c->_float = code->a->_float + code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_ADD_V)
+	code->c->vector[0] = code->a->vector[0] + code->b->vector[0];
+	code->c->vector[1] = code->a->vector[1] + code->b->vector[1];
+	code->c->vector[2] = code->a->vector[2] + code->b->vector[2];
+	PR_NEXT;
+
+	PR_OP(OP_SUB_F)
+	code->c->_float = code->a->_float - code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_SUB_V)
+	code->c->vector[0] = code->a->vector[0] - code->b->vector[0];
+	code->c->vector[1] = code->a->vector[1] - code->b->vector[1];
+	code->c->vector[2] = code->a->vector[2] - code->b->vector[2];
+	PR_NEXT;
+
+	PR_OP(OP_MUL_F)
+	code->c->_float = code->a->_float * code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_MUL_V)
+	code->c->_float = code->a->vector[0] * code->b->vector[0]
+	        + code->a->vector[1] * code->b->vector[1]
+	        + code->a->vector[2] * code->b->vector[2];
+	PR_NEXT;
+	PR_OP(OP_MUL_FV)
+	code->c->vector[0] = code->a->_float * code->b->vector[0];
+	code->c->vector[1] = code->a->_float * code->b->vector[1];
+	code->c->vector[2] = code->a->_float * code->b->vector[2];
+	PR_NEXT;
+	PR_OP(OP_MUL_VF)
+	code->c->vector[0] = code->b->_float * code->a->vector[0];
+	code->c->vector[1] = code->b->_float * code->a->vector[1];
+	code->c->vector[2] = code->b->_float * code->a->vector[2];
+	PR_NEXT;
+
+	PR_OP(OP_DIV_F)
+	code->c->_float = code->a->_float / code->b->_float;
+	PR_NEXT;
+
+	PR_OP(OP_BITAND)
+	code->c->_float = (int)code->a->_float & (int)code->b->_float;
+	PR_NEXT;
+
+	PR_OP(OP_BITOR)
+	code->c->_float = (int)code->a->_float | (int)code->b->_float;
+	PR_NEXT;
+
+	PR_OP(OP_GE)
+	code->c->_float = code->a->_float >= code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_LE)
+	code->c->_float = code->a->_float <= code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_GT)
+	code->c->_float = code->a->_float > code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_LT)
+	code->c->_float = code->a->_float < code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_AND)
+	code->c->_float = code->a->_float && code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_OR)
+	code->c->_float = code->a->_float || code->b->_float;
+	PR_NEXT;
+
+	PR_OP(OP_NOT_F)
+	code->c->_float = !code->a->_float;
+	PR_NEXT;
+	PR_OP(OP_NOT_V)
+	code->c->_float = !code->a->vector[0] && !code->a->vector[1] && !code->a->vector[2];
+	PR_NEXT;
+	PR_OP(OP_NOT_S)
+	code->c->_float = !code->a->string || !pr_strings[code->a->string];
+	PR_NEXT;
+	PR_OP(OP_NOT_FNC)
+	code->c->_float = !code->a->function;
+	PR_NEXT;
+	PR_OP(OP_NOT_ENT)
+	code->c->_float = (PROG_TO_EDICT(code->a->edict) == sv.edicts);
+	PR_NEXT;
+
+	PR_OP(OP_EQ_F)
+	code->c->_float = code->a->_float == code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_EQ_V)
+	code->c->_float = (code->a->vector[0] == code->b->vector[0]) &&
+	        (code->a->vector[1] == code->b->vector[1]) &&
+	        (code->a->vector[2] == code->b->vector[2]);
+	PR_NEXT;
+	PR_OP(OP_EQ_S)
+	code->c->_float = !strcmp(pr_strings + code->a->string, pr_strings + code->b->string);
+	PR_NEXT;
+	PR_OP(OP_EQ_E)
+	code->c->_float = code->a->_int == code->b->_int;
+	PR_NEXT;
+	PR_OP(OP_EQ_FNC)
+	code->c->_float = code->a->function == code->b->function;
+	PR_NEXT;
+
+	PR_OP(OP_NE_F)
+	code->c->_float = code->a->_float != code->b->_float;
+	PR_NEXT;
+	PR_OP(OP_NE_V)
+	code->c->_float = (code->a->vector[0] != code->b->vector[0]) ||
+	        (code->a->vector[1] != code->b->vector[1]) ||
+	        (code->a->vector[2] != code->b->vector[2]);
+	PR_NEXT;
+	PR_OP(OP_NE_S)
+	code->c->_float = strcmp(pr_strings + code->a->string, pr_strings + code->b->string);
+	PR_NEXT;
+	PR_OP(OP_NE_E)
+	code->c->_float = code->a->_int != code->b->_int;
+	PR_NEXT;
+	PR_OP(OP_NE_FNC)
+	code->c->_float = code->a->function != code->b->function;
+	PR_NEXT;
+
+	//==================
+	PR_OP(OP_STORE_F)
+	PR_OP(OP_STORE_ENT)
+	PR_OP(OP_STORE_FLD) // integers
+	PR_OP(OP_STORE_S)
+	PR_OP(OP_STORE_FNC) // pointers
+	code->b->_int = code->a->_int;
+	PR_NEXT;
+	PR_OP(OP_STORE_V)
+	code->b->vector[0] = code->a->vector[0];
+	code->b->vector[1] = code->a->vector[1];
+	code->b->vector[2] = code->a->vector[2];
+	PR_NEXT;
+
+	PR_OP(OP_STOREP_F)
+	PR_OP(OP_STOREP_ENT)
+	PR_OP(OP_STOREP_FLD) // integers
+	PR_OP(OP_STOREP_FNC) // pointers
+	ptr = (eval_t *)((byte *)sv.edicts + code->b->_int);
+	ptr->_int = code->a->_int;
+	PR_NEXT;
+	PR_OP(OP_STOREP_S)
+	ptr = (eval_t *)((byte *)sv.edicts + code->b->_int);
+	ptr->_int = code->a->_int;
+	ED_StringStored(code->b->_int);
+	PR_NEXT;
+	PR_OP(OP_STOREP_V)
+	ptr = (eval_t *)((byte *)sv.edicts + code->b->_int);
+	ptr->vector[0] = code->a->vector[0];
+	ptr->vector[1] = code->a->vector[1];
+	ptr->vector[2] = code->a->vector[2];
+	PR_NEXT;
+
+	PR_OP(OP_ADDRESS)
+	ed = PROG_TO_EDICT(code->a->edict);
+	#ifdef PARANOID
+	NUM_FOR_EDICT(ed); // make sure it's in range
+	#endif
+	if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+	{
+		pr_xstatement = code - pr_code;
+		PR_RunError("assignment to world entity");
+	}
+	code->c->_int = (byte *)((int *)&ed->v + code->b->_int) - (byte *)sv.edicts;
+	PR_NEXT;
+
+	PR_OP(OP_LOAD_F)
+	PR_OP(OP_LOAD_FLD)
+	PR_OP(OP_LOAD_ENT)
+	PR_OP(OP_LOAD_S)
+	PR_OP(OP_LOAD_FNC)
+	ed = PROG_TO_EDICT(code->a->edict);
+	#ifdef PARANOID
+	NUM_FOR_EDICT(ed); // make sure it's in range
+	#endif
+	ptr = (eval_t *)((int *)&ed->v + code->b->_int);
+	code->c->_int = ptr->_int;
+	PR_NEXT;
+
+	PR_OP(OP_LOAD_V)
+	ed = PROG_TO_EDICT(code->a->edict);
+	#ifdef PARANOID
+	NUM_FOR_EDICT(ed); // make sure it's in range
+	#endif
+	ptr = (eval_t *)((int *)&ed->v + code->b->_int);
+	code->c->vector[0] = ptr->vector[0];
+	code->c->vector[1] = ptr->vector[1];
+	code->c->vector[2] = ptr->vector[2];
+	PR_NEXT;
+
+	PR_OP(OPX_LOAD_STORE)
+	ed = PROG_TO_EDICT(code->a->edict);
+	#ifdef PARANOID
+	NUM_FOR_EDICT(ed); // make sure it's in range
+	#endif
+	ptr = (eval_t *)((int *)&ed->v + code->b->_int);
+	code->c->_int = code->d->_int = ptr->_int;
+	code += 2;
+	PR_DISPATCH;
+
+	PR_OP(OPX_LOAD_STORE_V)
+	ed = PROG_TO_EDICT(code->a->edict);
+	#ifdef PARANOID
+	NUM_FOR_EDICT(ed); // make sure it's in range
+	#endif
+	ptr = (eval_t *)((int *)&ed->v + code->b->_int);
+	v[0] = ptr->vector[0];
+	v[1] = ptr->vector[1];
+	v[2] = ptr->vector[2];
+	code->c->vector[0] = code->d->vector[0] = v[0];
+	code->c->vector[1] = code->d->vector[1] = v[1];
+	code->c->vector[2] = code->d->vector[2] = v[2];
+	code += 2;
+	PR_DISPATCH;
+
+	//==================
+
+	PR_OP(OP_IFNOT)
+	if (!code->a->_int)
+	{
+		PR_BRANCH(1);
+	}
+	PR_NEXT;
+
+	PR_OP(OP_IF)
+	if (code->a->_int)
+	{
+		PR_BRANCH(1);
+	}
+	PR_NEXT;
+
+	PR_OP(OP_GOTO)
+	PR_BRANCH(1);
+
+	PR_FUSED_BRANCH(OPX_EQ_F, code->a->_float == code->b->_float)
+	PR_FUSED_BRANCH(OPX_NE_F, code->a->_float != code->b->_float)
+	PR_FUSED_BRANCH(OPX_LE, code->a->_float <= code->b->_float)
+	PR_FUSED_BRANCH(OPX_GE, code->a->_float >= code->b->_float)
+	PR_FUSED_BRANCH(OPX_LT, code->a->_float < code->b->_float)
+	PR_FUSED_BRANCH(OPX_GT, code->a->_float > code->b->_float)
+	PR_FUSED_BRANCH(OPX_EQ_E, code->a->_int == code->b->_int)
+	PR_FUSED_BRANCH(OPX_NE_E, code->a->_int != code->b->_int)
+	PR_FUSED_BRANCH(OPX_NOT_F, !code->a->_float)
+	PR_FUSED_BRANCH(OPX_NOT_ENT, PROG_TO_EDICT(code->a->edict) == sv.edicts)
+
+	PR_OP(OP_CALL0)
+	PR_OP(OP_CALL1)
+	PR_OP(OP_CALL2)
+	PR_OP(OP_CALL3)
+	PR_OP(OP_CALL4)
+	PR_OP(OP_CALL5)
+	PR_OP(OP_CALL6)
+	PR_OP(OP_CALL7)
+	PR_OP(OP_CALL8)
+	pr_xstatement = code - pr_code;
+	pr_argc = code->jump;
+	if (!code->a->function)
+		PR_RunError("NULL function");
+
+	newf = &pr_functions[code->a->function];
+
+	if (newf->first_statement < 0) // negative statements are built in functions
+	{
+		i = -newf->first_statement;
+		if (i >= pr_numbuiltins)
+			PR_RunError("Bad builtin call number");
+		pr_builtins[i]();
+		if (pr_trace)
+		{
+			// traceon, finish this call in the statement loop
+			PR_ENDRUN(1);
+			s = pr_xstatement;
+			goto statements;
+		}
+		PR_NEXT;
+	}
+
+	PR_ENDRUN(1);
+	s = PR_EnterFunction(newf);
+	code = run = pr_code + s + 1;
+	PR_DISPATCH;
+
+	PR_OP(OP_DONE)
+	PR_OP(OP_RETURN)
+	pr_xstatement = code - pr_code;
+	pr_globals[OFS_RETURN] = code->a->vector[0];
+	pr_globals[OFS_RETURN + 1] = code->a->vector[1];
+	pr_globals[OFS_RETURN + 2] = code->a->vector[2];
+
+	PR_ENDRUN(1);
+	s = PR_LeaveFunction();
+	if (pr_depth == exitdepth)
+		return;                     // all done
+
+	code = run = pr_code + s + 1;
+	PR_DISPATCH;
+
+	PR_OP(OP_STATE)
+	ed = PROG_TO_EDICT(pr_global_struct->self);
+	#ifdef FPS_20
+	ed->v.nextthink = pr_global_struct->time + 0.05f;
+	#else
+	ed->v.nextthink = pr_global_struct->time + 0.1f;
+	#endif
+	if (code->a->_float != ed->v.frame)
+	{
+		ed->v.frame = code->a->_float;
+	}
+	ed->v.think = code->b->function;
+	PR_NEXT;
+
+	PR_OP(OPX_BAD)
+	pr_xstatement = code - pr_code;
+	PR_RunError("Bad opcode %i", code->jump);
+
+#ifndef __GNUC__
+		}
+	}
+#endif
+
+	// one statement at a time, with profiling and tracing
+statements:
 	while (1)
 	{
 		s++; // next statement
@@ -385,7 +1306,7 @@ void PR_ExecuteProgram(func_t fnum)
 		b = (eval_t *)&pr_globals[st->b];
 		c = (eval_t *)&pr_globals[st->c];
 
-		if (!--runaway)
+		if (--runaway <= 0)
 			PR_RunError("runaway loop error");
 
 		pr_xfunction->profile++;
@@ -533,11 +1454,15 @@ void PR_ExecuteProgram(func_t fnum)
 		case OP_STOREP_F:
 		case OP_STOREP_ENT:
 		case OP_STOREP_FLD: // integers
-		case OP_STOREP_S:
 		case OP_STOREP_FNC: // pointers
 			ptr = (eval_t *)((byte *)sv.edicts + b->_int);
 			ptr->_int = a->_int;
 			break;
+		case OP_STOREP_S:
+			ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+			ptr->_int = a->_int;
+			ED_StringStored(b->_int);
+			break;
 		case OP_STOREP_V:
 			ptr = (eval_t *)((byte *)sv.edicts + b->_int);
 			ptr->vector[0] = a->vector[0];
@@ -615,10 +1540,16 @@ void PR_ExecuteProgram(func_t fnum)
 				i = -newf->first_statement;
 				if (i >= pr_numbuiltins)
 					PR_RunError("Bad builtin call number");
+				if (profiling)
+					PR_ProfileEnter(a->function);
 				pr_builtins[i]();
+				if (profiling)
+					PR_ProfileLeave();
 				break;
 			}
 
+			if (profiling)
+				PR_ProfileEnter(a->function);
 			s = PR_EnterFunction(newf);
 			break;
 
@@ -628,6 +1559,8 @@ void PR_ExecuteProgram(func_t fnum)
 			pr_globals[OFS_RETURN + 1] = pr_globals[st->a + 1];
 			pr_globals[OFS_RETURN + 2] = pr_globals[st->a + 2];
 
+			if (profiling)
+				PR_ProfileLeave();
 			s = PR_LeaveFunction();
 			if (pr_depth == exitdepth)
 				return;                     // all done
@@ -653,3 +1586,29 @@ void PR_ExecuteProgram(func_t fnum)
 		}
 	}
 }
+
+/*
+   ====================
+   PR_ExecuteProgram
+
+   With pr_timing set, the time spent in programs started from the engine is
+   added up in pr_time.  Programs started by builtins are part of their caller
+   ====================
+ */
+qboolean pr_timing;
+double pr_time;
+
+void PR_ExecuteProgram(func_t fnum)
+{
+	double start;
+
+	if (!pr_timing || pr_depth)
+	{
+		PR_RunProgram(fnum);
+		return;
+	}
+
+	start = Sys_ProfileTime();
+	PR_RunProgram(fnum);
+	pr_time += Sys_ProfileTime() - start;
+}
@@ -20,6 +20,7 @@
 #ifndef progs_h
 #define progs_h
 
+#include "Common/cvar.h"
 #include "Rendering/r_public.h"
 #include "Scripting/pr_comp.h" // defs shared with qcc
 #include "Scripting/progdefs.h" // generated by program cdefs
@@ -43,9 +44,11 @@ typedef struct edict_s
 
 	int num_leafs;
 	short leafnums[MAX_ENT_LEAFS];
+	unsigned leafgroups; // a bit for each sv.leafgroupshift range of leafnums
 
 	entity_state_t baseline;
 
+	int linkcount; // sv_linkcount when last linked, unlinked or freed
 	float freetime; // sv.time when the object was freed
 	entvars_t v; // C exported fields from progs
 	// other fields from progs come immediately after
@@ -71,12 +74,19 @@ void PR_Init();
 
 void PR_ExecuteProgram(func_t fnum);
 void PR_LoadProgs();
+void PR_DecodeStatements();
 
 void PR_Profile_f();
+void PR_InitProfile();
 
 edict_t* ED_Alloc();
 void ED_Free(edict_t *ed);
 
+void ED_IndexEdict(edict_t *ed);
+void ED_StringStored(int ofs);
+edict_t* ED_FindIndexed(int start, int field, char *s);
+// classname and targetname lookups for PF_Find
+
 char* ED_NewString(char *string);
 // returns a copy of the string allocated from the server's string heap
 
@@ -124,6 +134,9 @@ extern int pr_numbuiltins;
 extern int pr_argc;
 
 extern qboolean pr_trace;
+extern cvar_t pr_profile;
+extern qboolean pr_timing;
+extern double pr_time; // seconds in programs while pr_timing is set
 extern dfunction_t *pr_xfunction;
 extern int pr_xstatement;
 
@@ -133,6 +146,7 @@ void PR_RunError(char *error, ...);
 
 void ED_PrintEdicts();
 void ED_PrintNum(int ent);
+unsigned ED_Checksum();
 
 eval_t* GetEdictFieldValue(edict_t *ed, char *field);
 
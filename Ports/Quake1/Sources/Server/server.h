@@ -55,6 +55,7 @@ typedef struct
 	char name[64]; // map name
 	char modelname[64]; // maps/<name>.bsp, for model_precache[0]
 	struct model_s *worldmodel;
+	int leafgroupshift; // leafnum >> leafgroupshift is the bit for the leaf in edict_t leafgroups
 	char *model_precache[MAX_MODELS]; // NULL terminated
 	struct model_s *models[MAX_MODELS];
 	char *sound_precache[MAX_SOUNDS]; // NULL terminated
@@ -110,6 +111,22 @@ typedef struct client_s
 
 	// client known data for deltas
 	int old_frags;
+
+	// delta compressed entity frames
+	int pext; // protocol extensions accepted by the client
+	entframe_t entframes[UPDATE_BACKUP];
+	packet_entity_t entstates[MAX_FRAME_STATES];
+	int next_entstate;
+	int entframe; // sequence of the next frame
+	int entframe_acked; // last frame the client has, -1 = none
+	int entframe_valid; // acks for frames before this one are stale
+
+	// bandwidth statistics for net_stats
+	int stat_frames;
+	int stat_bytes;
+	int stat_entitybytes;
+	int stat_deltaframes;
+	int stat_dropped; // entities left out for lack of room
 } client_t;
 
 //=============================================================================
@@ -179,6 +196,7 @@ extern cvar_t deathmatch;
 extern cvar_t coop;
 extern cvar_t fraglimit;
 extern cvar_t timelimit;
+extern cvar_t sv_delta;
 
 extern server_static_t svs; // persistant server info
 extern server_t sv; // local server
@@ -216,6 +234,7 @@ void SV_ClientPrintf(char *fmt, ...);
 void SV_BroadcastPrintf(char *fmt, ...);
 
 void SV_Physics();
+void SV_ShutdownPhysWorkers();
 
 qboolean SV_CheckBottom(edict_t *ent);
 qboolean SV_movestep(edict_t *ent, vec3_t move, qboolean relink);
@@ -37,6 +37,8 @@ server_static_t svs;
 
 char localmodels[MAX_MODELS][5]; // inline model names for precache
 
+cvar_t sv_delta = {"sv_delta", "1"}; // offer delta compressed entity frames
+
 //============================================================================
 
 /*
@@ -57,6 +59,9 @@ void SV_Init()
 	extern cvar_t sv_accelerate;
 	extern cvar_t sv_idealpitchscale;
 	extern cvar_t sv_aim;
+	extern cvar_t sv_tracecache;
+	extern cvar_t sv_areagrid;
+	extern cvar_t sv_physthreads;
 
 	Cvar_RegisterVariable(&sv_maxvelocity);
 	Cvar_RegisterVariable(&sv_gravity);
@@ -68,6 +73,19 @@ void SV_Init()
 	Cvar_RegisterVariable(&sv_idealpitchscale);
 	Cvar_RegisterVariable(&sv_aim);
 	Cvar_RegisterVariable(&sv_nostep);
+	Cvar_RegisterVariable(&sv_tracecache);
+	Cvar_RegisterVariable(&sv_areagrid);
+	Cvar_RegisterVariable(&sv_physthreads);
+	#ifdef DEDICATED_ONLY
+	extern cvar_t cl_rollspeed;
+	extern cvar_t cl_rollangle;
+	Cvar_RegisterVariable(&cl_rollspeed);
+	Cvar_RegisterVariable(&cl_rollangle);
+	#endif
+	Cvar_RegisterVariable(&sv_delta);
+
+	Cmd_AddCommand("tracecache", SV_TraceCache_f);
+	Cmd_AddCommand("areastats", SV_AreaStats_f);
 
 	for (i = 0; i < MAX_MODELS; i++)
 		sprintf(localmodels[i], "*%i", i);
@@ -238,6 +256,16 @@ void SV_SendServerinfo(client_t *client)
 	MSG_WriteByte(&client->message, svc_setview);
 	MSG_WriteShort(&client->message, NUM_FOR_EDICT(client->edict));
 
+	// offer protocol extensions, old clients just print an unknown command
+	client->pext = 0;
+	client->entframe_acked = -1;
+	client->entframe_valid = client->entframe;
+	if (sv_delta.value)
+	{
+		MSG_WriteByte(&client->message, svc_stufftext);
+		MSG_WriteString(&client->message, "pext\n");
+	}
+
 	MSG_WriteByte(&client->message, svc_signonnum);
 	MSG_WriteByte(&client->message, 1);
 
@@ -373,26 +401,40 @@ void SV_ClearDatagram()
  */
 
 int fatbytes;
-byte fatpvs[MAX_MAP_LEAFS / 8];
+
+// the leafs within 8 units of a client's eye, and the pvs they add up to.
+// The pvs is only made again when the client moves to other leafs.
+#define MAX_FATPVS_LEAFS 32
+
+typedef struct
+{
+	int numleafs; // -1 when too many leafs were touched to keep them
+	mleaf_t *leafs[MAX_FATPVS_LEAFS];
+	byte pvs[MAX_MAP_LEAFS / 8];
+	unsigned leafgroups; // the edict_t leafgroups bits with a visible leaf
+} fatpvs_t;
+
+static fatpvs_t sv_fatpvs[MAX_SCOREBOARD];
+static mleaf_t *fatleafs[MAX_MAP_LEAFS];
+static int numfatleafs;
+
+// edicts with a model and the client edicts, built once a frame
+// so SV_WriteEntitiesToClient doesn't look at every edict for every client
+static int sv_visedicts[MAX_EDICTS];
+static int sv_numvisedicts;
 
 void SV_AddToFatPVS(vec3_t org, mnode_t *node)
 {
-	int i;
-	byte *pvs;
 	mplane_t *plane;
 	float d;
 
 	while (1)
 	{
-		// if this is a leaf, accumulate the pvs bits
+		// if this is a leaf, remember it for SV_FatPVS
 		if (node->contents < 0)
 		{
 			if (node->contents != CONTENTS_SOLID)
-			{
-				pvs = Mod_LeafPVS((mleaf_t *)node, sv.worldmodel);
-				for (i = 0; i < fatbytes; i++)
-					fatpvs[i] |= pvs[i];
-			}
+				fatleafs[numfatleafs++] = (mleaf_t *)node;
 			return;
 		}
 
@@ -419,12 +461,78 @@ void SV_AddToFatPVS(vec3_t org, mnode_t *node)
    given point.
    =============
  */
-byte* SV_FatPVS(vec3_t org)
+fatpvs_t* SV_FatPVS(vec3_t org, fatpvs_t *fat)
 {
-	fatbytes = (sv.worldmodel->numleafs + 31) >> 3;
-	Q_memset(fatpvs, 0, fatbytes);
+	int i, j, last;
+	byte *pvs;
+
+	numfatleafs = 0;
 	SV_AddToFatPVS(org, sv.worldmodel->nodes);
-	return fatpvs;
+
+	if (numfatleafs == fat->numleafs && !memcmp(fatleafs, fat->leafs, numfatleafs * sizeof(mleaf_t *)))
+		return fat; // same leafs as last time
+
+	fatbytes = (sv.worldmodel->numleafs + 31) >> 3;
+	Q_memset(fat->pvs, 0, fatbytes);
+	for (i = 0; i < numfatleafs; i++)
+	{
+		pvs = Mod_LeafPVS(fatleafs[i], sv.worldmodel);
+		for (j = 0; j < fatbytes; j++)
+			fat->pvs[j] |= pvs[j];
+	}
+
+	fat->leafgroups = 0;
+	last = (sv.worldmodel->numleafs - 1) >> 3;
+	for (j = 0; j <= last; j++)
+		if (fat->pvs[j])
+			fat->leafgroups |= 1u << ((j << 3) >> sv.leafgroupshift);
+
+	if (numfatleafs <= MAX_FATPVS_LEAFS)
+	{
+		fat->numleafs = numfatleafs;
+		memcpy(fat->leafs, fatleafs, numfatleafs * sizeof(mleaf_t *));
+	}
+	else
+		fat->numleafs = -1;
+
+	return fat;
+}
+
+/*
+   =============
+   SV_ClearFatPVS
+
+   Forgets the client pvs made on the last map
+   =============
+ */
+void SV_ClearFatPVS()
+{
+	int i;
+
+	for (i = 0; i < MAX_SCOREBOARD; i++)
+		sv_fatpvs[i].numleafs = -1;
+}
+
+/*
+   =============
+   SV_BuildVisibleEdicts
+
+   =============
+ */
+void SV_BuildVisibleEdicts()
+{
+	int e;
+	edict_t *ent;
+
+	sv_numvisedicts = 0;
+	ent = NEXT_EDICT(sv.edicts);
+	for (e = 1; e < sv.num_edicts; e++, ent = NEXT_EDICT(ent))
+	{
+		// a client edict is always sent to its own client
+		if (e > svs.maxclients && (!ent->v.modelindex || !pr_strings[ent->v.model]))
+			continue;
+		sv_visedicts[sv_numvisedicts++] = e;
+	}
 }
 
 //=============================================================================
@@ -435,29 +543,72 @@ byte* SV_FatPVS(vec3_t org)
 
    =============
  */
-void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg)
+void SV_WriteEntitiesToClient(client_t *client, sizebuf_t *msg)
 {
-	int e, i;
+	int e, i, v;
 	int bits;
+	fatpvs_t *fat;
 	byte *pvs;
 	vec3_t org;
 	float miss;
-	edict_t *ent;
+	edict_t *clent, *ent;
+	entframe_t *frame, *oldframe;
+	packet_entity_t *packet;
+	entity_state_t *base;
+	int oldindex;
+	int start;
+	qboolean overflow;
+
+	clent = client->edict;
+	start = msg->cursize;
+	overflow = false;
+
+	// delta compress from the last frame the client acknowledged
+	frame = NULL;
+	oldframe = NULL;
+	oldindex = 0;
+	if (client->pext & PEXT_DELTA)
+	{
+		if (client->entframe_acked >= client->entframe_valid && client->entframe - client->entframe_acked < UPDATE_BACKUP)
+		{
+			oldframe = &client->entframes[client->entframe_acked & UPDATE_MASK];
+			if (oldframe->sequence != client->entframe_acked || client->next_entstate - oldframe->first > MAX_FRAME_STATES - MAX_PACKET_ENTITIES)
+				oldframe = NULL; // its states have been overwritten
+		}
+
+		frame = &client->entframes[client->entframe & UPDATE_MASK];
+		frame->sequence = client->entframe++;
+		frame->first = client->next_entstate;
+		frame->num = 0;
+
+		MSG_WriteByte(msg, svc_entityframe);
+		MSG_WriteLong(msg, frame->sequence);
+		MSG_WriteLong(msg, oldframe ? oldframe->sequence : -1);
+
+		if (oldframe)
+			client->stat_deltaframes++;
+	}
 
 	// find the client's PVS
 	VectorAdd(clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS(org);
+	fat = SV_FatPVS(org, &sv_fatpvs[NUM_FOR_EDICT(clent) - 1]);
+	pvs = fat->pvs;
 
 	// send over all entities (excpet the client) that touch the pvs
-	ent = NEXT_EDICT(sv.edicts);
-	for (e = 1; e < sv.num_edicts; e++, ent = NEXT_EDICT(ent))
+	for (v = 0; v < sv_numvisedicts; v++)
 	{
+		e = sv_visedicts[v];
+		ent = EDICT_NUM(e);
+
 		// ignore if not touching a PV leaf
 		if (ent != clent) // clent is ALLWAYS sent
 		{       // ignore ents without visible models
 			if (!ent->v.modelindex || !pr_strings[ent->v.model])
 				continue;
 
+			if (!(ent->leafgroups & fat->leafgroups))
+				continue;                   // nothing visible near any of its leafs
+
 			for (i = 0; i < ent->num_leafs; i++)
 				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i] & 7)))
 					break;
@@ -467,10 +618,24 @@ void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg)
 				continue;                   // not visible
 		}
 
-		if (msg->maxsize - msg->cursize < 16)
+		if (overflow || msg->maxsize - msg->cursize < 16 || (frame && frame->num == MAX_PACKET_ENTITIES))
 		{
-			Con_Printf("packet overflow\n");
-			return;
+			if (!overflow)
+				Con_Printf("packet overflow\n");
+			overflow = true;
+			client->stat_dropped++;
+			continue;
+		}
+
+		// the client fills in unsent fields from the acknowledged frame or the baseline
+		base = &ent->baseline;
+		if (oldframe)
+		{
+			while (oldindex < oldframe->num && client->entstates[(oldframe->first + oldindex) % MAX_FRAME_STATES].number < e)
+				oldindex++;
+			packet = &client->entstates[(oldframe->first + oldindex) % MAX_FRAME_STATES];
+			if (oldindex < oldframe->num && packet->number == e)
+				base = &packet->state;
 		}
 
 		// send an update
@@ -478,36 +643,36 @@ void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg)
 
 		for (i = 0; i < 3; i++)
 		{
-			miss = ent->v.origin[i] - ent->baseline.origin[i];
+			miss = ent->v.origin[i] - base->origin[i];
 			if (miss < -0.1f || miss > 0.1f)
 				bits |= U_ORIGIN1 << i;
 		}
 
-		if (ent->v.angles[0] != ent->baseline.angles[0])
+		if (ent->v.angles[0] != base->angles[0])
 			bits |= U_ANGLE1;
 
-		if (ent->v.angles[1] != ent->baseline.angles[1])
+		if (ent->v.angles[1] != base->angles[1])
 			bits |= U_ANGLE2;
 
-		if (ent->v.angles[2] != ent->baseline.angles[2])
+		if (ent->v.angles[2] != base->angles[2])
 			bits |= U_ANGLE3;
 
 		if (ent->v.movetype == MOVETYPE_STEP)
 			bits |= U_NOLERP;                                // don't mess up the step animation
 
-		if (ent->baseline.colormap != ent->v.colormap)
+		if (base->colormap != ent->v.colormap)
 			bits |= U_COLORMAP;
 
-		if (ent->baseline.skin != ent->v.skin)
+		if (base->skin != ent->v.skin)
 			bits |= U_SKIN;
 
-		if (ent->baseline.frame != ent->v.frame)
+		if (base->frame != ent->v.frame)
 			bits |= U_FRAME;
 
-		if (ent->baseline.effects != ent->v.effects)
+		if (base->effects != ent->v.effects)
 			bits |= U_EFFECTS;
 
-		if (ent->baseline.modelindex != ent->v.modelindex)
+		if (base->modelindex != ent->v.modelindex)
 			bits |= U_MODEL;
 
 		if (e >= 256)
@@ -550,7 +715,41 @@ void SV_WriteEntitiesToClient(edict_t *clent, sizebuf_t *msg)
 			MSG_WriteCoord(msg, ent->v.origin[2]);
 		if (bits & U_ANGLE3)
 			MSG_WriteAngle(msg, ent->v.angles[2]);
+
+		// remember what the client will have
+		if (frame)
+		{
+			packet = &client->entstates[client->next_entstate % MAX_FRAME_STATES];
+			client->next_entstate++;
+			frame->num++;
+
+			packet->number = e;
+			packet->state = *base;
+			if (bits & U_MODEL)
+				packet->state.modelindex = ent->v.modelindex;
+			if (bits & U_FRAME)
+				packet->state.frame = ent->v.frame;
+			if (bits & U_COLORMAP)
+				packet->state.colormap = ent->v.colormap;
+			if (bits & U_SKIN)
+				packet->state.skin = ent->v.skin;
+			if (bits & U_EFFECTS)
+				packet->state.effects = ent->v.effects;
+			for (i = 0; i < 3; i++)
+			{
+				if (bits & (U_ORIGIN1 << i))
+					packet->state.origin[i] = ent->v.origin[i];
+			}
+			if (bits & U_ANGLE1)
+				packet->state.angles[0] = ent->v.angles[0];
+			if (bits & U_ANGLE2)
+				packet->state.angles[1] = ent->v.angles[1];
+			if (bits & U_ANGLE3)
+				packet->state.angles[2] = ent->v.angles[2];
+		}
 	}
+
+	client->stat_entitybytes += msg->cursize - start;
 }
 
 /*
@@ -730,12 +929,15 @@ qboolean SV_SendClientDatagram(client_t *client)
 	// add the client specific data to the datagram
 	SV_WriteClientdataToMessage(client->edict, &msg);
 
-	SV_WriteEntitiesToClient(client->edict, &msg);
+	SV_WriteEntitiesToClient(client, &msg);
 
 	// copy the server datagram if there is space
 	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
 		SZ_Write(&msg, sv.datagram.data, sv.datagram.cursize);
 
+	client->stat_frames++;
+	client->stat_bytes += msg.cursize;
+
 	// send the datagram
 	if (NET_SendUnreliableMessage(client->netconnection, &msg) == -1)
 	{
@@ -820,6 +1022,8 @@ void SV_SendClientMessages()
 	// update frags, names, etc
 	SV_UpdateToReliableMessages();
 
+	SV_BuildVisibleEdicts();
+
 	// build individual updates
 	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
 	{
@@ -1026,7 +1230,9 @@ void SV_SaveSpawnparms()
 /*
    This is called at the start of each level
  */
+#ifndef DEDICATED_ONLY
 extern float scr_centertime_off;
+#endif
 
 void SV_SpawnServer(char * server)
 {
@@ -1036,7 +1242,9 @@ void SV_SpawnServer(char * server)
 	// let's not have any servers with no name
 	if (hostname.string[0] == 0)
 		Cvar_Set("hostname", "UNNAMED");
+	#ifndef DEDICATED_ONLY
 	scr_centertime_off = 0;
+	#endif
 
 	Con_DPrintf("SpawnServer: %s\n", server);
 	svs.changelevel_issued = false; // now safe to issue another
@@ -1118,6 +1326,7 @@ void SV_SpawnServer(char * server)
 	// clear world interaction links
 	//
 	SV_ClearWorld();
+	SV_ClearFatPVS();
 
 	sv.sound_precache[0] = pr_strings;
 
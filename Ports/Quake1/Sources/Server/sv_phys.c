@@ -380,6 +380,24 @@ void SV_AddGravity(edict_t *ent)
    Does not change the entities velocity at all
    ============
  */
+int SV_PushEntityType(edict_t *ent)
+{
+	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
+		return MOVE_MISSILE;
+	if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+		return MOVE_NOMONSTERS; // only clip against bmodels
+	return MOVE_NORMAL;
+}
+
+void SV_FinishPush(edict_t *ent, trace_t *trace)
+{
+	VectorCopy(trace->endpos, ent->v.origin);
+	SV_LinkEdict(ent, true);
+
+	if (trace->ent)
+		SV_Impact(ent, trace->ent);
+}
+
 trace_t SV_PushEntity(edict_t *ent, vec3_t push)
 {
 	trace_t trace;
@@ -387,20 +405,8 @@ trace_t SV_PushEntity(edict_t *ent, vec3_t push)
 
 	VectorAdd(ent->v.origin, push, end);
 
-	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
-		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
-	else
-	if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
-		// only clip against bmodels
-		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
-	else
-		trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
-
-	VectorCopy(trace.endpos, ent->v.origin);
-	SV_LinkEdict(ent, true);
-
-	if (trace.ent)
-		SV_Impact(ent, trace.ent);
+	trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, end, SV_PushEntityType(ent), ent);
+	SV_FinishPush(ent, &trace);
 
 	return trace;
 }
@@ -1000,18 +1006,15 @@ void SV_CheckWaterTransition(edict_t *ent)
    Toss, bounce, and fly movement.  When onground, do nothing.
    =============
  */
-void SV_Physics_Toss(edict_t *ent)
+qboolean SV_Physics_TossBegin(edict_t *ent, vec3_t move)
 {
-	trace_t trace;
-	vec3_t move;
-	float backoff;
 	// regular thinking
 	if (!SV_RunThink(ent))
-		return;
+		return false;
 
 	// if onground, return without moving
 	if (((int)ent->v.flags & FL_ONGROUND))
-		return;
+		return false;
 
 	SV_CheckVelocity(ent);
 
@@ -1025,8 +1028,14 @@ void SV_Physics_Toss(edict_t *ent)
 
 	// move origin
 	VectorScale(ent->v.velocity, host_frametime, move);
-	trace = SV_PushEntity(ent, move);
-	if (trace.fraction == 1)
+	return true;
+}
+
+void SV_Physics_TossEnd(edict_t *ent, trace_t *trace)
+{
+	float backoff;
+
+	if (trace->fraction == 1)
 		return;
 
 	if (ent->free)
@@ -1037,15 +1046,15 @@ void SV_Physics_Toss(edict_t *ent)
 	else
 		backoff = 1;
 
-	ClipVelocity(ent->v.velocity, trace.plane.normal, ent->v.velocity, backoff);
+	ClipVelocity(ent->v.velocity, trace->plane.normal, ent->v.velocity, backoff);
 
 	// stop if on ground
-	if (trace.plane.normal[2] > 0.7f)
+	if (trace->plane.normal[2] > 0.7f)
 	{
 		if (ent->v.velocity[2] < 60 || ent->v.movetype != MOVETYPE_BOUNCE)
 		{
 			ent->v.flags = (int)ent->v.flags | FL_ONGROUND;
-			ent->v.groundentity = EDICT_TO_PROG(trace.ent);
+			ent->v.groundentity = EDICT_TO_PROG(trace->ent);
 			VectorCopy(vec3_origin, ent->v.velocity);
 			VectorCopy(vec3_origin, ent->v.avelocity);
 		}
@@ -1055,6 +1064,294 @@ void SV_Physics_Toss(edict_t *ent)
 	SV_CheckWaterTransition(ent);
 }
 
+void SV_Physics_Toss(edict_t *ent)
+{
+	trace_t trace;
+	vec3_t move;
+
+	if (!SV_Physics_TossBegin(ent, move))
+		return;
+
+	trace = SV_PushEntity(ent, move);
+	SV_Physics_TossEnd(ent, &trace);
+}
+
+/*
+   =============
+   Parallel toss moves
+
+   With sv_physthreads set, toss, bounce and fly entities only think and
+   integrate their velocity in SV_Physics.  Once every edict had its turn,
+   the traces of all their moves run on sv_physthreads worker threads plus
+   the main thread against the world as it is then, with nothing linking.
+   The results are applied in edict order afterwards, which is where
+   triggers are touched and impacts call into QuakeC.  A move traces again
+   from where its entity ended up when that moved, when what it hit was
+   freed, relinked or changed solidity, or when anything linked or unlinked
+   in its path while the earlier moves were applied.
+   =============
+ */
+#define MAX_PHYS_WORKERS 16
+
+cvar_t sv_physthreads = {"sv_physthreads", "0"};
+
+typedef struct
+{
+	edict_t *ent;
+	vec3_t move;
+	vec3_t start, end;
+	int type;
+	trace_t trace;
+	float hitsolid; // solid of trace.ent when it was traced
+} tossmove_t;
+
+static tossmove_t sv_tossmoves[MAX_EDICTS];
+static int sv_numtossmoves;
+
+typedef struct
+{
+	void *thread;
+	void *start;
+} physworker_t;
+
+static physworker_t sv_physworkers[MAX_PHYS_WORKERS + 1]; // 0 is the main thread
+static int sv_numphysworkers;
+static void *sv_physworkersdone;
+static qboolean sv_physworkersquit;
+
+void SV_Physics_TossQueue(edict_t *ent)
+{
+	tossmove_t *move;
+
+	move = &sv_tossmoves[sv_numtossmoves];
+	if (!SV_Physics_TossBegin(ent, move->move))
+		return;
+
+	move->ent = ent;
+	sv_numtossmoves++;
+}
+
+static void SV_TraceTossMoves(int first, int stride)
+{
+	tossmove_t *move;
+	int i;
+
+	for (i = first; i < sv_numtossmoves; i += stride)
+	{
+		move = &sv_tossmoves[i];
+		move->trace = SV_MoveFrozen(move->start, move->ent->v.mins, move->ent->v.maxs, move->end, move->type, move->ent);
+		if (move->trace.ent)
+			move->hitsolid = move->trace.ent->v.solid;
+	}
+}
+
+static qboolean SV_TossMoveChanged(tossmove_t *move, int linkcount)
+{
+	edict_t *ent, *hit;
+	vec3_t mins, maxs, size[2];
+	int i;
+
+	ent = move->ent;
+	if (!VectorCompare(ent->v.origin, move->start))
+		return true;
+
+	hit = move->trace.ent;
+	if (hit && hit != sv.edicts)
+	{
+		if (hit->free || hit->v.solid != move->hitsolid || hit->linkcount > linkcount)
+			return true;
+	}
+
+	// anything that came or went across the swept box?  Missiles clip
+	// monsters with a larger box, see SV_ClipMove
+	VectorCopy(ent->v.mins, size[0]);
+	VectorCopy(ent->v.maxs, size[1]);
+	if (move->type == MOVE_MISSILE)
+	{
+		for (i = 0; i < 3; i++)
+		{
+			if (size[0][i] > -15)
+				size[0][i] = -15;
+			if (size[1][i] < 15)
+				size[1][i] = 15;
+		}
+	}
+
+	for (i = 0; i < 3; i++)
+	{
+		if (move->end[i] > move->start[i])
+		{
+			mins[i] = move->start[i] + size[0][i] - 1;
+			maxs[i] = move->end[i] + size[1][i] + 1;
+		}
+		else
+		{
+			mins[i] = move->end[i] + size[0][i] - 1;
+			maxs[i] = move->start[i] + size[1][i] + 1;
+		}
+	}
+
+	return SV_LinkLogTouches(mins, maxs);
+}
+
+static int SV_PhysWorkerThread(void *data)
+{
+	int first;
+
+	first = (int)(size_t)data;
+
+	while (1)
+	{
+		Sys_SemaphoreWait(sv_physworkers[first].start);
+		if (sv_physworkersquit)
+			break;
+
+		SV_TraceTossMoves(first, sv_numphysworkers + 1);
+		Sys_SemaphorePost(sv_physworkersdone);
+	}
+
+	return 0;
+}
+
+void SV_ShutdownPhysWorkers()
+{
+	int i;
+
+	if (!sv_numphysworkers)
+		return;
+
+	sv_physworkersquit = true;
+	for (i = 1; i <= sv_numphysworkers; i++)
+	{
+		Sys_SemaphorePost(sv_physworkers[i].start);
+		Sys_WaitThread(sv_physworkers[i].thread);
+		Sys_DestroySemaphore(sv_physworkers[i].start);
+		sv_physworkers[i].thread = NULL;
+		sv_physworkers[i].start = NULL;
+	}
+
+	Sys_DestroySemaphore(sv_physworkersdone);
+	sv_physworkersdone = NULL;
+	sv_physworkersquit = false;
+	sv_numphysworkers = 0;
+}
+
+static void SV_StartPhysWorkers(int count)
+{
+	physworker_t *worker;
+	int i;
+
+	sv_physworkersdone = Sys_CreateSemaphore(0);
+	if (!sv_physworkersdone)
+		count = 0;
+
+	for (i = 1; i <= count; i++)
+	{
+		worker = &sv_physworkers[i];
+		worker->start = Sys_CreateSemaphore(0);
+		if (!worker->start)
+			break;
+
+		worker->thread = Sys_CreateThread(SV_PhysWorkerThread, (void *)(size_t)i);
+		if (!worker->thread)
+		{
+			Sys_DestroySemaphore(worker->start);
+			worker->start = NULL;
+			break;
+		}
+
+		sv_numphysworkers++;
+	}
+
+	if (sv_numphysworkers != count)
+	{
+		Con_Printf("Couldn't start %i physics threads, using %i.\n", count, sv_numphysworkers);
+		Cvar_SetValue("sv_physthreads", sv_numphysworkers);
+	}
+
+	if (!sv_numphysworkers && sv_physworkersdone)
+	{
+		Sys_DestroySemaphore(sv_physworkersdone);
+		sv_physworkersdone = NULL;
+	}
+}
+
+void SV_RunTossMoves()
+{
+	tossmove_t *move;
+	edict_t *ent;
+	int count, linkcount;
+	int i, j;
+
+	count = (int)sv_physthreads.value;
+	if (count < 0)
+		count = 0;
+	else
+	if (count > MAX_PHYS_WORKERS)
+		count = MAX_PHYS_WORKERS;
+
+	if (count != sv_numphysworkers)
+	{
+		SV_ShutdownPhysWorkers();
+		SV_StartPhysWorkers(count);
+	}
+
+	// QuakeC of the entities after them may have freed some
+	for (i = 0, j = 0; i < sv_numtossmoves; i++)
+	{
+		move = &sv_tossmoves[i];
+		ent = move->ent;
+		if (ent->free)
+			continue;
+
+		VectorCopy(ent->v.origin, move->start);
+		VectorAdd(ent->v.origin, move->move, move->end);
+		move->type = SV_PushEntityType(ent);
+		sv_tossmoves[j++] = *move;
+	}
+	sv_numtossmoves = j;
+
+	// trace them all against the frozen world
+	sv_frozen = true;
+	if (!sv_numphysworkers || sv_numtossmoves < 2)
+		SV_TraceTossMoves(0, 1);
+	else
+	{
+		for (i = 1; i <= sv_numphysworkers; i++)
+			Sys_SemaphorePost(sv_physworkers[i].start);
+
+		SV_TraceTossMoves(0, sv_numphysworkers + 1);
+
+		for (i = 1; i <= sv_numphysworkers; i++)
+			Sys_SemaphoreWait(sv_physworkersdone);
+	}
+	sv_frozen = false;
+
+	// link, touch and impact in edict order
+	linkcount = sv_linkcount;
+	SV_StartLinkLog();
+	for (i = 0; i < sv_numtossmoves; i++)
+	{
+		move = &sv_tossmoves[i];
+		ent = move->ent;
+		if (ent->free)
+			continue;
+
+		// the frozen trace only holds while nothing it saw has changed
+		if (SV_TossMoveChanged(move, linkcount))
+		{
+			VectorAdd(ent->v.origin, move->move, move->end);
+			move->trace = SV_Move(ent->v.origin, ent->v.mins, ent->v.maxs, move->end, SV_PushEntityType(ent), ent);
+		}
+
+		SV_FinishPush(ent, &move->trace);
+		SV_Physics_TossEnd(ent, &move->trace);
+	}
+	SV_StopLinkLog();
+
+	sv_numtossmoves = 0;
+}
+
 /*
    ===============================================================================
 
@@ -1107,6 +1404,8 @@ void SV_Physics()
 	int i;
 	edict_t *ent;
 
+	SV_ClearTraceCache();
+
 	// let the progs know that a new frame has started
 	pr_global_struct->self = EDICT_TO_PROG(sv.edicts);
 	pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
@@ -1148,11 +1447,22 @@ void SV_Physics()
 		    || ent->v.movetype == MOVETYPE_BOUNCE
 		    || ent->v.movetype == MOVETYPE_FLY
 		    || ent->v.movetype == MOVETYPE_FLYMISSILE)
-			SV_Physics_Toss(ent);
+		{
+			if (sv_physthreads.value)
+				SV_Physics_TossQueue(ent);
+			else
+				SV_Physics_Toss(ent);
+		}
 		else
 			Sys_Error("SV_Physics: bad movetype %i", (int)ent->v.movetype);
 	}
 
+	if (sv_numtossmoves)
+		SV_RunTossMoves();
+	else
+	if (sv_numphysworkers && !sv_physthreads.value)
+		SV_ShutdownPhysWorkers();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
 
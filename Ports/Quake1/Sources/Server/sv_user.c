@@ -56,6 +56,33 @@ usercmd_t cmd;
 
 cvar_t sv_idealpitchscale = { "sv_idealpitchscale", "0.8" };
 
+#ifdef DEDICATED_ONLY
+
+// the client normally owns these, but the server rolls the player model with them
+cvar_t cl_rollspeed = { "cl_rollspeed", "200" };
+cvar_t cl_rollangle = { "cl_rollangle", "2.0" };
+
+float V_CalcRoll(vec3_t angles, vec3_t velocity)
+{
+	vec3_t forward, right, up;
+	float sign;
+	float side;
+
+	AngleVectors(angles, forward, right, up);
+	side = DotProduct(velocity, right);
+	sign = side < 0 ? -1 : 1;
+	side = fabsf(side);
+
+	if (side < cl_rollspeed.value)
+		side = side * cl_rollangle.value / cl_rollspeed.value;
+	else
+		side = cl_rollangle.value;
+
+	return side * sign;
+}
+
+#endif
+
 /*
    ===============
    SV_SetIdealPitch
@@ -482,6 +509,7 @@ qboolean SV_ReadClientMessage()
 	int ret;
 	int cmd;
 	char *s;
+	int frame;
 
 	do
 	{
@@ -580,6 +608,9 @@ nextmsg:
 				if (Q_strncasecmp(s, "ping", 4) == 0)
 					ret = 1;
 				else
+				if (Q_strncasecmp(s, "pext", 4) == 0)
+					ret = 1;
+				else
 				if (Q_strncasecmp(s, "give", 4) == 0)
 					ret = 1;
 				else
@@ -601,6 +632,12 @@ nextmsg:
 			case clc_move:
 				SV_ReadClientMove(&host_client->cmd);
 				break;
+
+			case clc_ackframe:
+				frame = MSG_ReadLong();
+				if (frame >= host_client->entframe_valid && frame < host_client->entframe && frame > host_client->entframe_acked)
+					host_client->entframe_acked = frame;
+				break;
 			}
 		}
 	}
@@ -20,6 +20,8 @@
 // World query functions
 
 #include "Client/console.h"
+#include "Common/cmd.h"
+#include "Common/cvar.h"
 #include "Common/sys.h"
 #include "Server/server.h"
 #include "Server/world.h"
@@ -31,6 +33,12 @@
    line of sight checks trace->crosscontent, but bullets don't
  */
 
+typedef struct
+{
+	hull_t hull;
+	mplane_t planes[6];
+} boxhull_t;
+
 typedef struct
 {
 	vec3_t boxmins, boxmaxs; // enclose the test object along entire move
@@ -40,6 +48,8 @@ typedef struct
 	trace_t trace;
 	int type;
 	edict_t *passedict;
+	boxhull_t *box; // box_hull, or a copy off the main thread
+	int tested, found; // for the area statistics
 } moveclip_t;
 
 int SV_HullPointContents(hull_t *hull, int num, vec3_t p);
@@ -50,9 +60,8 @@ int SV_HullPointContents(hull_t *hull, int num, vec3_t p);
    ===============================================================================
  */
 
-static hull_t box_hull;
+static boxhull_t box_hull;
 static dclipnode_t box_clipnodes[6];
-static mplane_t box_planes[6];
 
 /*
    Set up the planes and clipnodes so that the six floats of a bounding box
@@ -63,10 +72,10 @@ void SV_InitBoxHull()
 	int i;
 	int side;
 
-	box_hull.clipnodes = box_clipnodes;
-	box_hull.planes = box_planes;
-	box_hull.firstclipnode = 0;
-	box_hull.lastclipnode = 5;
+	box_hull.hull.clipnodes = box_clipnodes;
+	box_hull.hull.planes = box_hull.planes;
+	box_hull.hull.firstclipnode = 0;
+	box_hull.hull.lastclipnode = 5;
 
 	for (i = 0; i < 6; i++)
 	{
@@ -80,25 +89,32 @@ void SV_InitBoxHull()
 		else
 			box_clipnodes[i].children[side ^ 1] = CONTENTS_SOLID;
 
-		box_planes[i].type = i >> 1;
-		box_planes[i].normal[i >> 1] = 1;
+		box_hull.planes[i].type = i >> 1;
+		box_hull.planes[i].normal[i >> 1] = 1;
 	}
 }
 
+// a private copy of the box hull for moves that run on worker threads
+static void SV_CopyBoxHull(boxhull_t *box)
+{
+	*box = box_hull;
+	box->hull.planes = box->planes;
+}
+
 /*
    To keep everything totally uniform, bounding boxes are turned into small
    BSP trees instead of being compared directly.
  */
-hull_t* SV_HullForBox(vec3_t mins, vec3_t maxs)
+hull_t* SV_HullForBox(boxhull_t *box, vec3_t mins, vec3_t maxs)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
-
-	return &box_hull;
+	box->planes[0].dist = maxs[0];
+	box->planes[1].dist = mins[0];
+	box->planes[2].dist = maxs[1];
+	box->planes[3].dist = mins[1];
+	box->planes[4].dist = maxs[2];
+	box->planes[5].dist = mins[2];
+
+	return &box->hull;
 }
 
 /*
@@ -107,7 +123,7 @@ hull_t* SV_HullForBox(vec3_t mins, vec3_t maxs)
    Offset is filled in to contain the adjustment that must be added to the
    testing object's origin to get a point to use with the returned hull.
  */
-hull_t* SV_HullForEntity(edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
+hull_t* SV_HullForEntity(edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, boxhull_t *box)
 {
 	model_t *model;
 	vec3_t size;
@@ -142,7 +158,7 @@ hull_t* SV_HullForEntity(edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 	{
 		VectorSubtract(ent->v.mins, maxs, hullmins);
 		VectorSubtract(ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox(hullmins, hullmaxs);
+		hull = SV_HullForBox(box, hullmins, hullmaxs);
 
 		VectorCopy(ent->v.origin, offset);
 	}
@@ -150,6 +166,126 @@ hull_t* SV_HullForEntity(edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 	return hull;
 }
 
+/*
+   ===============================================================================
+
+   TRACE CACHE
+
+   ===============================================================================
+ */
+
+// with sv_tracecache set, a trace repeated within a frame is answered from
+// memory, until an entity is relinked inside the box the move swept
+cvar_t sv_tracecache = {"sv_tracecache", "0"};
+
+#define TRACE_CACHE_SIZE 512 // must be a power of two
+
+typedef struct
+{
+	int generation;
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	int type;
+	edict_t *passedict;
+	vec3_t boxmins, boxmaxs; // every entity that could change the trace is in here
+	trace_t trace;
+} tracecache_t;
+
+static tracecache_t trace_cache[TRACE_CACHE_SIZE];
+static int trace_cached[TRACE_CACHE_SIZE]; // slots filled this generation
+static int trace_numcached;
+static int trace_generation = 1;
+static int trace_frames, trace_hits, trace_misses, trace_invalidated;
+
+void SV_ClearTraceCache()
+{
+	trace_generation++;
+	trace_numcached = 0;
+	trace_frames++;
+}
+
+static void SV_InvalidateTraces(vec3_t mins, vec3_t maxs)
+{
+	tracecache_t *entry;
+	int i;
+
+	for (i = 0; i < trace_numcached; i++)
+	{
+		entry = &trace_cache[trace_cached[i]];
+		if (entry->generation != trace_generation)
+			continue;
+
+		if (mins[0] > entry->boxmaxs[0] || mins[1] > entry->boxmaxs[1] || mins[2] > entry->boxmaxs[2]
+		    || maxs[0] < entry->boxmins[0] || maxs[1] < entry->boxmins[1] || maxs[2] < entry->boxmins[2])
+			continue;
+
+		entry->generation = 0;
+		trace_invalidated++;
+	}
+}
+
+static int SV_TraceCacheSlot(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	unsigned hash;
+	int i;
+
+	// the key is compared exactly, only the slot comes from the rounded positions
+	hash = (unsigned)type * 31 + (unsigned)(size_t)passedict;
+	for (i = 0; i < 3; i++)
+	{
+		hash = hash * 31 + (int)start[i];
+		hash = hash * 31 + (int)end[i];
+		hash = hash * 7 + (int)(maxs[i] - mins[i]);
+	}
+
+	hash ^= hash >> 15;
+	hash *= 0x2c1b3c6d;
+	hash ^= hash >> 12;
+
+	return hash & (TRACE_CACHE_SIZE - 1);
+}
+
+static void SV_TraceCacheStore(int slot, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, vec3_t boxmins, vec3_t boxmaxs, trace_t *trace)
+{
+	tracecache_t *entry;
+
+	entry = &trace_cache[slot];
+	if (entry->generation != trace_generation)
+	{
+		if (trace_numcached == TRACE_CACHE_SIZE)
+			return;             // slots were refilled too often, wait for the next frame
+		trace_cached[trace_numcached++] = slot;
+	}
+
+	entry->generation = trace_generation;
+	VectorCopy(start, entry->start);
+	VectorCopy(end, entry->end);
+	VectorCopy(mins, entry->mins);
+	VectorCopy(maxs, entry->maxs);
+	entry->type = type;
+	entry->passedict = passedict;
+	VectorCopy(boxmins, entry->boxmins);
+	VectorCopy(boxmaxs, entry->boxmaxs);
+	entry->trace = *trace;
+}
+
+void SV_TraceCache_f()
+{
+	int lookups;
+
+	lookups = trace_hits + trace_misses;
+	Con_Printf("%i traces in %i frames, %i hits (%.1f%%), %i invalidated\n",
+		lookups, trace_frames, trace_hits, lookups ? 100.0f * trace_hits / lookups : 0.0f, trace_invalidated);
+
+	if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		trace_frames = 0;
+		trace_hits = 0;
+		trace_misses = 0;
+		trace_invalidated = 0;
+	}
+}
+
 /*
    ===============================================================================
 
@@ -173,6 +309,96 @@ typedef struct areanode_s
 static areanode_t sv_areanodes[AREA_NODES];
 static int sv_numareanodes;
 
+// with sv_areagrid set when a map starts, entities are kept in a loose grid
+// instead of the area nodes. Each level has cells twice as large as the one
+// below and the last one is a single cell. An entity goes into the first level
+// its size fits in, in the cell holding its center, so it sticks out by half
+// a cell at most. Unlike the nodes, nothing big or straddling a split piles up
+// in the few lists every query visits.
+cvar_t sv_areagrid = {"sv_areagrid", "0"};
+
+#define AREA_CELL_SIZE 128 // finest grid cells
+#define AREA_GRID_SIZE 64 // most cells along an axis, halved on each level
+#define AREA_GRID_LEVELS 7
+#define AREA_GRID_CELLS (AREA_GRID_SIZE * AREA_GRID_SIZE * 4 / 3 + 1)
+
+typedef struct
+{
+	link_t trigger_edicts;
+	link_t solid_edicts;
+} areacell_t;
+
+typedef struct
+{
+	float cellsize;
+	int size[2];
+	areacell_t *cells;
+} arealevel_t;
+
+static qboolean sv_areagrid_active;
+static areacell_t sv_areacells[AREA_GRID_CELLS];
+static arealevel_t sv_arealevels[AREA_GRID_LEVELS];
+static int sv_numarealevels;
+static vec3_t sv_areaorigin;
+
+static int area_queries, area_tested, area_found;
+
+qboolean sv_frozen; // SV_MoveFrozen may be running on other threads
+
+int sv_linkcount;
+
+#define MAX_LINK_LOG 1024
+
+typedef struct
+{
+	vec3_t mins, maxs;
+} linkbox_t;
+
+static linkbox_t link_log[MAX_LINK_LOG];
+static int link_lognum;
+static qboolean link_logging;
+
+void SV_StartLinkLog()
+{
+	link_lognum = 0;
+	link_logging = true;
+}
+
+void SV_StopLinkLog()
+{
+	link_logging = false;
+}
+
+static void SV_LogLink(vec3_t mins, vec3_t maxs)
+{
+	if (link_lognum < MAX_LINK_LOG)
+	{
+		VectorCopy(mins, link_log[link_lognum].mins);
+		VectorCopy(maxs, link_log[link_lognum].maxs);
+	}
+	link_lognum++;
+}
+
+qboolean SV_LinkLogTouches(vec3_t mins, vec3_t maxs)
+{
+	linkbox_t *box;
+	int i;
+
+	if (link_lognum > MAX_LINK_LOG)
+		return true;
+
+	for (i = 0, box = link_log; i < link_lognum; i++, box++)
+	{
+		if (mins[0] > box->maxs[0] || mins[1] > box->maxs[1] || mins[2] > box->maxs[2]
+		    || maxs[0] < box->mins[0] || maxs[1] < box->mins[1] || maxs[2] < box->mins[2])
+			continue;
+
+		return true;
+	}
+
+	return false;
+}
+
 areanode_t* SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 {
 	areanode_t *anode;
@@ -212,13 +438,129 @@ areanode_t* SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+void SV_CreateAreaGrid(vec3_t mins, vec3_t maxs)
+{
+	arealevel_t *level;
+	float cellsize;
+	int i, j, size;
+	int numcells;
+
+	memset(sv_areacells, 0, sizeof(sv_areacells));
+	VectorCopy(mins, sv_areaorigin);
+
+	sv_numarealevels = 0;
+	numcells = 0;
+	cellsize = AREA_CELL_SIZE;
+	size = AREA_GRID_SIZE;
+
+	while (1)
+	{
+		level = &sv_arealevels[sv_numarealevels];
+		sv_numarealevels++;
+
+		level->cellsize = cellsize;
+		level->cells = &sv_areacells[numcells];
+
+		for (j = 0; j < 2; j++)
+		{
+			level->size[j] = (int)ceilf((maxs[j] - mins[j]) / cellsize);
+			if (level->size[j] < 1)
+				level->size[j] = 1;
+			if (level->size[j] > size)
+				level->size[j] = size;
+		}
+
+		for (i = 0; i < level->size[0] * level->size[1]; i++)
+		{
+			ClearLink(&level->cells[i].trigger_edicts);
+			ClearLink(&level->cells[i].solid_edicts);
+		}
+		numcells += level->size[0] * level->size[1];
+
+		if (level->size[0] == 1 && level->size[1] == 1)
+			break;
+
+		cellsize *= 2;
+		size /= 2;
+	}
+}
+
+// cell along one axis, everything outside the world goes into the cells along its edges
+static int SV_AreaCell(arealevel_t *level, int axis, float v)
+{
+	int cell;
+
+	cell = (int)floorf((v - sv_areaorigin[axis]) / level->cellsize);
+	if (cell < 0)
+		return 0;
+	if (cell >= level->size[axis])
+		return level->size[axis] - 1;
+	return cell;
+}
+
+static areacell_t* SV_AreaCellForBox(vec3_t mins, vec3_t maxs)
+{
+	arealevel_t *level;
+	float extent;
+	int i;
+
+	extent = maxs[0] - mins[0];
+	if (maxs[1] - mins[1] > extent)
+		extent = maxs[1] - mins[1];
+
+	for (i = 0; i < sv_numarealevels - 1; i++)
+		if (sv_arealevels[i].cellsize >= extent)
+			break;
+	level = &sv_arealevels[i];
+
+	return &level->cells[SV_AreaCell(level, 1, 0.5f * (mins[1] + maxs[1])) * level->size[0]
+		+ SV_AreaCell(level, 0, 0.5f * (mins[0] + maxs[0]))];
+}
+
+// range of cells on a level an entity touching the box can be in
+static void SV_AreaCellRange(arealevel_t *level, vec3_t mins, vec3_t maxs, int *cellmins, int *cellmaxs)
+{
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		cellmins[i] = SV_AreaCell(level, i, mins[i] - 0.5f * level->cellsize);
+		cellmaxs[i] = SV_AreaCell(level, i, maxs[i] + 0.5f * level->cellsize);
+	}
+}
+
+void SV_AreaStats_f()
+{
+	Con_Printf("%s: %i queries, %.1f edicts tested and %.1f clipped per query\n",
+		sv_areagrid_active ? "grid" : "nodes", area_queries,
+		area_queries ? (float)area_tested / area_queries : 0.0f,
+		area_queries ? (float)area_found / area_queries : 0.0f);
+
+	if (Cmd_Argc() > 1 && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		area_queries = 0;
+		area_tested = 0;
+		area_found = 0;
+	}
+}
+
 void SV_ClearWorld()
 {
 	SV_InitBoxHull();
+	SV_ClearTraceCache();
+
+	// at least a byte of pvs per group, so SV_WriteEntitiesToClient can find them
+	sv.leafgroupshift = 3;
+	while ((sv.worldmodel->numleafs >> sv.leafgroupshift) >= 32)
+		sv.leafgroupshift++;
 
 	memset(sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode(0, sv.worldmodel->mins, sv.worldmodel->maxs);
+
+	sv_areagrid_active = sv_areagrid.value != 0;
+	if (sv_areagrid_active)
+		SV_CreateAreaGrid(sv.worldmodel->mins, sv.worldmodel->maxs);
 }
 
 void SV_UnlinkEdict(edict_t *ent)
@@ -226,18 +568,23 @@ void SV_UnlinkEdict(edict_t *ent)
 	if (!ent->area.prev)
 		return;               // not linked in anywhere
 
+	if (trace_numcached)
+		SV_InvalidateTraces(ent->v.absmin, ent->v.absmax);
+	if (link_logging)
+		SV_LogLink(ent->v.absmin, ent->v.absmax);
+	ent->linkcount = ++sv_linkcount;
+
 	RemoveLink(&ent->area);
 	ent->area.prev = ent->area.next = NULL;
 }
 
-void SV_TouchLinks(edict_t *ent, areanode_t *node)
+static void SV_TouchLinksInList(edict_t *ent, link_t *list)
 {
 	link_t *l, *next;
 	edict_t *touch;
 	int old_self, old_other;
 
-	// touch linked edicts
-	for (l = node->trigger_edicts.next; l != &node->trigger_edicts; l = next)
+	for (l = list->next; l != list; l = next)
 	{
 		next = l->next;
 		touch = EDICT_FROM_AREA(l);
@@ -263,6 +610,29 @@ void SV_TouchLinks(edict_t *ent, areanode_t *node)
 		pr_global_struct->self = old_self;
 		pr_global_struct->other = old_other;
 	}
+}
+
+void SV_TouchLinks(edict_t *ent, areanode_t *node)
+{
+	arealevel_t *level;
+	int i, x, y;
+	int cellmins[2], cellmaxs[2];
+
+	if (sv_areagrid_active)
+	{
+		for (i = 0; i < sv_numarealevels; i++)
+		{
+			level = &sv_arealevels[i];
+			SV_AreaCellRange(level, ent->v.absmin, ent->v.absmax, cellmins, cellmaxs);
+			for (y = cellmins[1]; y <= cellmaxs[1]; y++)
+				for (x = cellmins[0]; x <= cellmaxs[0]; x++)
+					SV_TouchLinksInList(ent, &level->cells[y * level->size[0] + x].trigger_edicts);
+		}
+		return;
+	}
+
+	// touch linked edicts
+	SV_TouchLinksInList(ent, &node->trigger_edicts);
 
 	// recurse down both sides
 	if (node->axis == -1)
@@ -274,6 +644,87 @@ void SV_TouchLinks(edict_t *ent, areanode_t *node)
 		SV_TouchLinks(ent, node->children[1]);
 }
 
+static float *area_mins, *area_maxs;
+static edict_t **area_list;
+static int area_count, area_maxcount;
+
+static void SV_AreaEdictsInList(link_t *list)
+{
+	link_t *l;
+	edict_t *check;
+
+	for (l = list->next; l != list; l = l->next)
+	{
+		check = EDICT_FROM_AREA(l);
+		if (check->v.solid == SOLID_NOT)
+			continue;
+		if (check->v.absmin[0] > area_maxs[0]
+		    || check->v.absmin[1] > area_maxs[1]
+		    || check->v.absmin[2] > area_maxs[2]
+		    || check->v.absmax[0] < area_mins[0]
+		    || check->v.absmax[1] < area_mins[1]
+		    || check->v.absmax[2] < area_mins[2])
+			continue;
+
+		if (area_count == area_maxcount)
+		{
+			Con_Printf("SV_AreaEdicts: MAXCOUNT\n");
+			return;
+		}
+
+		area_list[area_count] = check;
+		area_count++;
+	}
+}
+
+static void SV_AreaEdicts_r(areanode_t *node)
+{
+	SV_AreaEdictsInList(&node->solid_edicts);
+	SV_AreaEdictsInList(&node->trigger_edicts);
+
+	if (node->axis == -1)
+		return;
+
+	if (area_maxs[node->axis] > node->dist)
+		SV_AreaEdicts_r(node->children[0]);
+	if (area_mins[node->axis] < node->dist)
+		SV_AreaEdicts_r(node->children[1]);
+}
+
+int SV_AreaEdicts(vec3_t mins, vec3_t maxs, edict_t **list, int maxcount)
+{
+	arealevel_t *level;
+	areacell_t *cell;
+	int i, x, y;
+	int cellmins[2], cellmaxs[2];
+
+	area_mins = mins;
+	area_maxs = maxs;
+	area_list = list;
+	area_count = 0;
+	area_maxcount = maxcount;
+
+	if (sv_areagrid_active)
+	{
+		for (i = 0; i < sv_numarealevels; i++)
+		{
+			level = &sv_arealevels[i];
+			SV_AreaCellRange(level, mins, maxs, cellmins, cellmaxs);
+			for (y = cellmins[1]; y <= cellmaxs[1]; y++)
+				for (x = cellmins[0]; x <= cellmaxs[0]; x++)
+				{
+					cell = &level->cells[y * level->size[0] + x];
+					SV_AreaEdictsInList(&cell->solid_edicts);
+					SV_AreaEdictsInList(&cell->trigger_edicts);
+				}
+		}
+	}
+	else
+		SV_AreaEdicts_r(sv_areanodes);
+
+	return area_count;
+}
+
 void SV_FindTouchedLeafs(edict_t *ent, mnode_t *node)
 {
 	mplane_t *splitplane;
@@ -296,6 +747,7 @@ void SV_FindTouchedLeafs(edict_t *ent, mnode_t *node)
 
 		ent->leafnums[ent->num_leafs] = leafnum;
 		ent->num_leafs++;
+		ent->leafgroups |= 1u << (leafnum >> sv.leafgroupshift);
 		return;
 	}
 
@@ -315,6 +767,7 @@ void SV_FindTouchedLeafs(edict_t *ent, mnode_t *node)
 void SV_LinkEdict(edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t *node;
+	areacell_t *cell;
 
 	if (ent->area.prev)
 		SV_UnlinkEdict(ent);              // unlink from old position
@@ -354,12 +807,23 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers)
 
 	// link to PVS leafs
 	ent->num_leafs = 0;
+	ent->leafgroups = 0;
 	if (ent->v.modelindex)
 		SV_FindTouchedLeafs(ent, sv.worldmodel->nodes);
 
 	if (ent->v.solid == SOLID_NOT)
 		return;
 
+	if (sv_areagrid_active)
+	{
+		cell = SV_AreaCellForBox(ent->v.absmin, ent->v.absmax);
+		if (ent->v.solid == SOLID_TRIGGER)
+			InsertLinkBefore(&ent->area, &cell->trigger_edicts);
+		else
+			InsertLinkBefore(&ent->area, &cell->solid_edicts);
+		goto linked;
+	}
+
 	// find the first node that the ent's box crosses
 	node = sv_areanodes;
 	while (1)
@@ -382,6 +846,13 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers)
 	else
 		InsertLinkBefore(&ent->area, &node->solid_edicts);
 
+linked:
+	if (trace_numcached)
+		SV_InvalidateTraces(ent->v.absmin, ent->v.absmax);
+	if (link_logging)
+		SV_LogLink(ent->v.absmin, ent->v.absmax);
+	ent->linkcount = ++sv_linkcount;
+
 	// if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
 		SV_TouchLinks(ent, sv_areanodes);
@@ -587,7 +1058,8 @@ qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3
 		{
 			trace->fraction = midf;
 			VectorCopy(mid, trace->endpos);
-			Con_DPrintf("backup past 0\n");
+			if (!sv_frozen)
+				Con_DPrintf("backup past 0\n");
 			return false;
 		}
 		midf = p1f + (p2f - p1f) * frac;
@@ -605,7 +1077,7 @@ qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3
    Handles selection or creation of a clipping hull, and offseting (and
    eventually rotation) of the end points
  */
-trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, boxhull_t *box)
 {
 	trace_t trace;
 	vec3_t offset;
@@ -619,7 +1091,7 @@ trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs
 	VectorCopy(end, trace.endpos);
 
 	// get the clipping hull
-	hull = SV_HullForEntity(ent, mins, maxs, offset);
+	hull = SV_HullForEntity(ent, mins, maxs, offset, box);
 
 	VectorSubtract(start, offset, start_l);
 	VectorSubtract(end, offset, end_l);
@@ -643,17 +1115,17 @@ trace_t SV_ClipMoveToEntity(edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs
 /*
    Mins and maxs enclose the entire area swept by the move
  */
-void SV_ClipToLinks(areanode_t *node, moveclip_t *clip)
+static void SV_ClipToLinksInList(link_t *list, moveclip_t *clip)
 {
 	link_t *l, *next;
 	edict_t *touch;
 	trace_t trace;
 
-	// touch linked edicts
-	for (l = node->solid_edicts.next; l != &node->solid_edicts; l = next)
+	for (l = list->next; l != list; l = next)
 	{
 		next = l->next;
 		touch = EDICT_FROM_AREA(l);
+		clip->tested++;
 		if (touch->v.solid == SOLID_NOT)
 			continue;
 		if (touch == clip->passedict)
@@ -687,10 +1159,11 @@ void SV_ClipToLinks(areanode_t *node, moveclip_t *clip)
 				continue;                                                // don't clip against owner
 		}
 
+		clip->found++;
 		if ((int)touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+			trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip->box);
 		else
-			trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins, clip->maxs, clip->end);
+			trace = SV_ClipMoveToEntity(touch, clip->start, clip->mins, clip->maxs, clip->end, clip->box);
 		if (trace.allsolid || trace.startsolid ||
 		    trace.fraction < clip->trace.fraction)
 		{
@@ -707,6 +1180,29 @@ void SV_ClipToLinks(areanode_t *node, moveclip_t *clip)
 		if (trace.startsolid)
 			clip->trace.startsolid = true;
 	}
+}
+
+void SV_ClipToLinks(areanode_t *node, moveclip_t *clip)
+{
+	arealevel_t *level;
+	int i, x, y;
+	int cellmins[2], cellmaxs[2];
+
+	if (sv_areagrid_active)
+	{
+		for (i = 0; i < sv_numarealevels; i++)
+		{
+			level = &sv_arealevels[i];
+			SV_AreaCellRange(level, clip->boxmins, clip->boxmaxs, cellmins, cellmaxs);
+			for (y = cellmins[1]; y <= cellmaxs[1]; y++)
+				for (x = cellmins[0]; x <= cellmaxs[0]; x++)
+					SV_ClipToLinksInList(&level->cells[y * level->size[0] + x].solid_edicts, clip);
+		}
+		return;
+	}
+
+	// touch linked edicts
+	SV_ClipToLinksInList(&node->solid_edicts, clip);
 
 	// recurse down both sides
 	if (node->axis == -1)
@@ -743,42 +1239,85 @@ void SV_MoveBounds(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t bo
 	#endif
 }
 
-trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+static void SV_ClipMove(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, moveclip_t *clip)
 {
-	moveclip_t clip;
 	int i;
 
-	memset(&clip, 0, sizeof(moveclip_t));
-
 	// clip to world
-	clip.trace = SV_ClipMoveToEntity(sv.edicts, start, mins, maxs, end);
+	clip->trace = SV_ClipMoveToEntity(sv.edicts, start, mins, maxs, end, clip->box);
 
-	clip.start = start;
-	clip.end = end;
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.type = type;
-	clip.passedict = passedict;
+	clip->start = start;
+	clip->end = end;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->type = type;
+	clip->passedict = passedict;
 
 	if (type == MOVE_MISSILE)
 	{
 		for (i = 0; i < 3; i++)
 		{
-			clip.mins2[i] = -15;
-			clip.maxs2[i] = 15;
+			clip->mins2[i] = -15;
+			clip->maxs2[i] = 15;
 		}
 	}
 	else
 	{
-		VectorCopy(mins, clip.mins2);
-		VectorCopy(maxs, clip.maxs2);
+		VectorCopy(mins, clip->mins2);
+		VectorCopy(maxs, clip->maxs2);
 	}
 
 	// create the bounding box of the entire move
-	SV_MoveBounds(start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs);
+	SV_MoveBounds(start, clip->mins2, clip->maxs2, end, clip->boxmins, clip->boxmaxs);
 
 	// clip to entities
-	SV_ClipToLinks(sv_areanodes, &clip);
+	SV_ClipToLinks(sv_areanodes, clip);
+}
+
+trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	moveclip_t clip;
+	tracecache_t *entry;
+	int slot;
+
+	slot = -1;
+	if (sv_tracecache.value)
+	{
+		slot = SV_TraceCacheSlot(start, mins, maxs, end, type, passedict);
+		entry = &trace_cache[slot];
+		if (entry->generation == trace_generation && entry->type == type && entry->passedict == passedict
+		    && VectorCompare(entry->start, start) && VectorCompare(entry->end, end)
+		    && VectorCompare(entry->mins, mins) && VectorCompare(entry->maxs, maxs))
+		{
+			trace_hits++;
+			return entry->trace;
+		}
+		trace_misses++;
+	}
+
+	memset(&clip, 0, sizeof(moveclip_t));
+	clip.box = &box_hull;
+	SV_ClipMove(start, mins, maxs, end, type, passedict, &clip);
+
+	area_queries++;
+	area_tested += clip.tested;
+	area_found += clip.found;
+
+	if (slot != -1)
+		SV_TraceCacheStore(slot, start, mins, maxs, end, type, passedict, clip.boxmins, clip.boxmaxs, &clip.trace);
+
+	return clip.trace;
+}
+
+trace_t SV_MoveFrozen(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	moveclip_t clip;
+	boxhull_t box;
+
+	memset(&clip, 0, sizeof(moveclip_t));
+	SV_CopyBoxHull(&box);
+	clip.box = &box;
+	SV_ClipMove(start, mins, maxs, end, type, passedict, &clip);
 
 	return clip.trace;
 }
@@ -48,6 +48,14 @@ typedef struct
 void SV_ClearWorld();
 // called after the world model has been loaded, before linking any entities
 
+void SV_ClearTraceCache();
+// forgets the traces remembered with sv_tracecache, called every frame
+
+void SV_TraceCache_f();
+
+void SV_AreaStats_f();
+// prints how many entities SV_Move looked at with the area nodes or sv_areagrid
+
 void SV_UnlinkEdict(edict_t *ent);
 // call before removing an entity, and before trying to move one,
 // so it doesn't clip against itself
@@ -59,6 +67,10 @@ void SV_LinkEdict(edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+int SV_AreaEdicts(vec3_t mins, vec3_t maxs, edict_t **list, int maxcount);
+// fills in a list of all solid and trigger edicts whose linked boxes touch
+// the given box, returns the number of pointers filled in
+
 int SV_PointContents(vec3_t p);
 int SV_TruePointContents(vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
@@ -80,6 +92,23 @@ trace_t SV_Move(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, ed
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+trace_t SV_MoveFrozen(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict);
+// the same as SV_Move, but safe to call from several threads at once while
+// sv_frozen is set and nothing links, unlinks or prints.  Skips the trace
+// cache and the area statistics
+
+extern qboolean sv_frozen;
+
+extern int sv_linkcount;
+// bumped and stamped into edict_t linkcount by every link, unlink and free
+
+void SV_StartLinkLog();
+void SV_StopLinkLog();
+qboolean SV_LinkLogTouches(vec3_t mins, vec3_t maxs);
+// while the log runs, the boxes of every edict linked or unlinked are kept
+// and SV_LinkLogTouches tells whether any of them overlaps mins/maxs.  It
+// also answers true once more boxes came by than the log has room for
+
 qboolean SV_RecursiveHullCheck(hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
 
 #endif
@@ -289,7 +289,7 @@ static sfxcache_t* S_LoadSound(sfx_t *s)
 	//	Con_Printf ("loading %s\n",namebuffer);
 
 	byte stackbuf[1 * 1024]; // avoid dirtying the cache heap
-	byte *data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf));
+	byte *data = COM_LoadMappedFile(namebuffer, stackbuf, sizeof(stackbuf));
 	if (!data)
 	{
 		Con_Printf("Couldn't load %s\n", namebuffer);
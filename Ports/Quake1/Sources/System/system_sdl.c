@@ -1,8 +1,12 @@
 #include "Client/client.h"
+#include "Client/console.h"
+#include "Common/cmd.h"
 #include "Common/quakedef.h"
 #include "Common/sys.h"
 
+#ifndef DEDICATED_ONLY
 #include <SDL2/SDL.h>
+#endif
 
 #include <ctype.h>
 #include <errno.h>
@@ -23,6 +27,12 @@
 #include <sys/shm.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/select.h>
+#include <time.h>
+#endif
+#ifdef DEDICATED_ONLY
+#include <pthread.h>
+#include <semaphore.h>
 #endif
 
 bool logFileEnabled = false;
@@ -72,6 +82,38 @@ void Sys_Warn(char *warning, ...)
 	fprintf(stderr, "Warning: %s", string);
 }
 
+char* Sys_ConsoleInput()
+{
+	#ifndef __WIN32__
+	static char text[256];
+	static qboolean stdin_closed;
+	fd_set fdset;
+	struct timeval timeout;
+	int len;
+
+	if (stdin_closed)
+		return NULL;
+
+	FD_ZERO(&fdset);
+	FD_SET(0, &fdset); // stdin
+	timeout.tv_sec = 0;
+	timeout.tv_usec = 0;
+	if (select(1, &fdset, NULL, NULL, &timeout) == -1 || !FD_ISSET(0, &fdset))
+		return NULL;
+
+	len = read(0, text, sizeof(text) - 1);
+	if (len <= 0)
+	{
+		stdin_closed = true; // eof, or started without a terminal
+		return NULL;
+	}
+	text[len] = 0;
+	return text;
+	#else
+	return NULL;
+	#endif
+}
+
 void Sys_RedirectStdout()
 {
 	if (!logFileEnabled)
@@ -249,6 +291,23 @@ int Sys_FileTime(char *path)
 	return -1;
 }
 
+void* Sys_FileMap(int handle, int size)
+{
+	#ifndef __WIN32__
+	if (handle >= 0 && handle < MAX_HANDLES && size > 0)
+	{
+        FILE *sysHandle = sys_handles[handle];
+        if (sysHandle)
+        {
+            void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(sysHandle), 0);
+            if (base != MAP_FAILED)
+                return base;
+        }
+	}
+	#endif
+	return NULL;
+}
+
 bool Sys_mkdir(char *path)
 {
 	#ifdef __WIN32__
@@ -304,6 +363,32 @@ double Sys_FloatTime()
 	#endif
 }
 
+#ifndef __WIN32__
+
+// CLOCK_MONOTONIC is what clock_nanosleep sleeps against, so the
+// frame scheduler can sleep to a deadline taken from this clock
+double Sys_ProfileTime()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#else
+
+double Sys_ProfileTime()
+{
+	static double scale;
+
+	if (!scale)
+		scale = 1.0 / SDL_GetPerformanceFrequency();
+
+	return SDL_GetPerformanceCounter() * scale;
+}
+
+#endif
+
 // =======================================================================
 // Sleeps for microseconds
 // =======================================================================
@@ -332,56 +417,269 @@ byte* Sys_ZoneBase(int *size)
 	return malloc(*size);
 }
 
+#ifdef DEDICATED_ONLY
+
+void Sys_Sleep()
+{
+	struct timespec ts = { 0, 1000000 };
+
+	nanosleep(&ts, NULL);
+}
+
+typedef struct
+{
+	pthread_t thread;
+	int (*function)(void *);
+	void *data;
+} systhread_t;
+
+static void* Sys_ThreadMain(void *arg)
+{
+	systhread_t *thread = arg;
+
+	thread->function(thread->data);
+	return NULL;
+}
+
+void* Sys_CreateThread(int (*function)(void *), void *data)
+{
+	systhread_t *thread = malloc(sizeof(systhread_t));
+
+	thread->function = function;
+	thread->data = data;
+	if (pthread_create(&thread->thread, NULL, Sys_ThreadMain, thread))
+	{
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void Sys_WaitThread(void *thread)
+{
+	pthread_join(((systhread_t *)thread)->thread, NULL);
+	free(thread);
+}
+
+void* Sys_CreateSemaphore(int value)
+{
+	sem_t *semaphore = malloc(sizeof(sem_t));
+
+	if (sem_init(semaphore, 0, value))
+	{
+		free(semaphore);
+		return NULL;
+	}
+	return semaphore;
+}
+
+void Sys_DestroySemaphore(void *semaphore)
+{
+	sem_destroy(semaphore);
+	free(semaphore);
+}
+
+void Sys_SemaphoreWait(void *semaphore)
+{
+	while (sem_wait(semaphore) && errno == EINTR)
+		;
+}
+
+void Sys_SemaphorePost(void *semaphore)
+{
+	sem_post(semaphore);
+}
+
+#else
+
 void Sys_Sleep()
 {
 	SDL_Delay(1);
 }
 
+void* Sys_CreateThread(int (*function)(void *), void *data)
+{
+	return SDL_CreateThread(function, "worker", data);
+}
+
+void Sys_WaitThread(void *thread)
+{
+	SDL_WaitThread(thread, NULL);
+}
+
+void* Sys_CreateSemaphore(int value)
+{
+	return SDL_CreateSemaphore(value);
+}
+
+void Sys_DestroySemaphore(void *semaphore)
+{
+	SDL_DestroySemaphore(semaphore);
+}
+
+void Sys_SemaphoreWait(void *semaphore)
+{
+	SDL_SemWait(semaphore);
+}
+
+void Sys_SemaphorePost(void *semaphore)
+{
+	SDL_SemPost(semaphore);
+}
+
+#endif
+
+// =======================================================================
+// Frame scheduler
+// =======================================================================
+
+/*
+   Paces the host loop.  Every frame has an absolute deadline one interval
+   after the previous one, so the time spent running a frame does not add
+   up to drift, and the process sleeps until then instead of polling.  A
+   frame that misses its deadline runs straight away, and one that falls
+   more than two intervals behind starts the schedule again from now rather
+   than trying to catch up.  How late each sleep wakes up is kept in a
+   histogram that sys_framestats prints.
+ */
+
+#define FRAMESTATS_BUCKETS 8
+
+static const int sys_framebuckets[FRAMESTATS_BUCKETS - 1] = { 50, 100, 250, 500, 1000, 2000, 5000 }; // microseconds
+static int sys_framehistogram[FRAMESTATS_BUCKETS];
+static int sys_framesmissed;
+static int sys_framesreset;
+static double sys_framelatesum;
+static double sys_framelatemax;
+static double sys_framedeadline;
+
+static void Sys_SleepUntil(double deadline)
+{
+	#ifdef __WIN32__
+	double delay = deadline - Sys_ProfileTime();
+
+	if (delay > 0)
+		SDL_Delay((Uint32)(delay * 1000));
+	#else
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)deadline;
+	ts.tv_nsec = (long)((deadline - ts.tv_sec) * 1e9);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+	#endif
+}
+
+static void Sys_WaitFrame(double interval)
+{
+	double now = Sys_ProfileTime();
+	double late;
+	int i;
+
+	if (interval <= 0) // run flat out
+	{
+		sys_framedeadline = now;
+		return;
+	}
+
+	sys_framedeadline += interval;
+	if (now >= sys_framedeadline)
+	{
+		sys_framesmissed++;
+		if (now - sys_framedeadline > interval * 2)
+		{
+			sys_framesreset++;
+			sys_framedeadline = now;
+		}
+		return;
+	}
+
+	Sys_SleepUntil(sys_framedeadline);
+
+	late = (Sys_ProfileTime() - sys_framedeadline) * 1000000;
+	if (late < 0)
+		late = 0;
+	for (i = 0; i < FRAMESTATS_BUCKETS - 1 && late >= sys_framebuckets[i]; i++)
+		;
+	sys_framehistogram[i]++;
+	sys_framelatesum += late;
+	if (late > sys_framelatemax)
+		sys_framelatemax = late;
+}
+
+void Sys_FrameStats_f()
+{
+	int i, slept;
+
+	if (Cmd_Argc() > 1 && !Q_strcmp(Cmd_Argv(1), "reset"))
+	{
+		memset(sys_framehistogram, 0, sizeof(sys_framehistogram));
+		sys_framesmissed = sys_framesreset = 0;
+		sys_framelatesum = sys_framelatemax = 0;
+		return;
+	}
+
+	for (i = 0, slept = 0; i < FRAMESTATS_BUCKETS; i++)
+		slept += sys_framehistogram[i];
+
+	Con_Printf("%i frames slept to their deadline, %i missed it, %i restarted the schedule\n", slept, sys_framesmissed, sys_framesreset);
+	if (!slept)
+		return;
+
+	Con_Printf("woke up %.0f us late on average, %.0f us at worst\n", sys_framelatesum / slept, sys_framelatemax);
+	for (i = 0; i < FRAMESTATS_BUCKETS; i++)
+	{
+		if (i < FRAMESTATS_BUCKETS - 1)
+			Con_Printf("  < %4i us: %7i %5.1f%%\n", sys_framebuckets[i], sys_framehistogram[i], 100.0f * sys_framehistogram[i] / slept);
+		else
+			Con_Printf(" >= %4i us: %7i %5.1f%%\n", sys_framebuckets[i - 1], sys_framehistogram[i], 100.0f * sys_framehistogram[i] / slept);
+	}
+}
 
 int main(int c, char **v)
 {
 	quakeparms_t parms;
 	extern int vcrFile;
 	extern int recording;
+	int i;
+
+	COM_InitArgv(c, v);
+	parms.argc = com_argc;
+	parms.argv = com_argv;
 
-    #if 0
-	parms.memsize = 8 * 1024 * 1024; // Original game memory. It does not work with the mission packs.
+    #ifdef DEDICATED_ONLY
+	parms.memsize = 8 * 1024 * 1024; // Without textures, surfaces and sounds the original game memory is plenty.
     #else
 	parms.memsize = 16 * 1024 * 1024; // Because of the numerous changes in the game engine, we probably need more memory than the original game.
     #endif
+	i = COM_CheckParm("-mem");
+	if (i && i < com_argc - 1)
+		parms.memsize = Q_atoi(com_argv[i + 1]) * 1024 * 1024;
 	parms.membase = malloc(parms.memsize);
 	parms.basedir = basedir;
 
-	COM_InitArgv(c, v);
-	parms.argc = com_argc;
-	parms.argv = com_argv;
-
     Sys_RedirectStdout();
 
 	Host_Init(&parms);
 
 	double oldtime = Sys_FloatTime() - 0.1f;
+	sys_framedeadline = Sys_ProfileTime();
 	while (1)
 	{
-		// find time spent rendering last frame
-		double newtime = Sys_FloatTime();
-		double time = newtime - oldtime;
-
-		if (cls.state == ca_dedicated) // play vcrfiles at max speed
+		if (cls.state == ca_dedicated)
 		{
-			if (time < sys_ticrate.value && (vcrFile == -1 || recording))
-			{
-				SDL_Delay(1);
-				continue; // not time to run a server only tic yet
-			}
-			time = sys_ticrate.value;
+			// server tics are all the same length, the scheduler keeps them in step with the clock
+			Host_Frame(sys_ticrate.value);
+			Sys_WaitFrame(vcrFile != -1 && !recording ? 0 : sys_ticrate.value); // play vcrfiles at max speed
+			continue;
 		}
 
-		if (time > sys_ticrate.value * 2)
-			oldtime = newtime;
-		else
-			oldtime += time;
+		// find time spent rendering last frame
+		double newtime = Sys_FloatTime();
+		double time = newtime - oldtime;
+		oldtime = newtime;
 
 		Host_Frame(time);
+		Sys_WaitFrame(cls.timedemo || host_maxfps.value <= 0 ? 0 : 1.0 / host_maxfps.value);
 	}
 }
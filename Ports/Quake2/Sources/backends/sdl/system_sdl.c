@@ -22,11 +22,20 @@
 #include "backends/input.h"
 #include "common/common.h"
 
+#ifdef DEDICATED_ONLY
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h>
+#else
 #include <SDL2/SDL.h>
+#endif
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 bool logFileEnabled = false;
 
@@ -34,22 +43,184 @@ unsigned int sys_frame_time;
 static void *game_library = NULL;
 int curtime;
 
+static int sys_msecbase;
+
+#ifdef __unix__
+
+/* CLOCK_MONOTONIC is what clock_nanosleep sleeps against,
+   so a frame deadline can be slept to exactly */
+static struct timespec sys_clockstart;
+
+static long long Sys_Microseconds()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	if (!sys_clockstart.tv_sec && !sys_clockstart.tv_nsec)
+	{
+		sys_clockstart = ts;
+	}
+
+	return (ts.tv_sec - sys_clockstart.tv_sec) * 1000000LL + (ts.tv_nsec - sys_clockstart.tv_nsec) / 1000;
+}
+
+static void Sys_SleepUntil(long long usec)
+{
+	struct timespec ts;
+
+	ts.tv_sec = sys_clockstart.tv_sec + usec / 1000000;
+	ts.tv_nsec = sys_clockstart.tv_nsec + (usec % 1000000) * 1000;
+
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+}
+
+#else
+
+static long long Sys_Microseconds()
+{
+	static Uint64 start;
+
+	if (!start)
+	{
+		start = SDL_GetPerformanceCounter();
+	}
+
+	return (long long)((double)(SDL_GetPerformanceCounter() - start) * 1000000 / SDL_GetPerformanceFrequency());
+}
+
+static void Sys_SleepUntil(long long usec)
+{
+	long long delay = usec - Sys_Microseconds();
+
+	if (delay > 0)
+	{
+		SDL_Delay((Uint32)(delay / 1000));
+	}
+}
+
+#endif
+
 int Sys_Milliseconds()
 {
-	static int base;
 	static qboolean initialized = false;
 
 	if (!initialized)
 	{ /* let base retain 16 bits of effectively random data */
-		base = SDL_GetTicks() & 0xffff0000;
+		sys_msecbase = (int)(Sys_Microseconds() / 1000) & 0xffff0000;
 		initialized = true;
 	}
 
-	curtime = SDL_GetTicks() - base;
+	curtime = (int)(Sys_Microseconds() / 1000) - sys_msecbase;
 
 	return curtime;
 }
 
+/*
+ * Frame scheduler.  Qcommon_Run sleeps until the next client or server
+ * frame is due.  The deadline is absolute, so the time spent running a
+ * frame does not add up to drift, and the sleep ends at the deadline
+ * instead of at whatever millisecond the timer rounds to.  A dedicated
+ * server also wakes up as soon as a packet or a console line arrives.
+ * How late each sleep ends is kept in a histogram, sys_framestats
+ * prints it.
+ */
+
+#define FRAMESTATS_BUCKETS 8
+
+static const int sys_framebuckets[FRAMESTATS_BUCKETS - 1] = { 50, 100, 250, 500, 1000, 2000, 5000 }; /* microseconds */
+static int sys_framehistogram[FRAMESTATS_BUCKETS];
+static int sys_framesdue;
+static int sys_framesinput;
+static long long sys_framelatesum;
+static int sys_framelatemax;
+
+void Sys_WaitFrame(int earliest, int deadline)
+{
+	long long target = (deadline + sys_msecbase) * 1000LL;
+	long long now = Sys_Microseconds();
+	int late, i;
+
+	if (now >= target)
+	{
+		sys_framesdue++;
+		return;
+	}
+
+	if (dedicated && dedicated->value && NET_Sleep((int)(target - now)))
+	{
+		/* there is input to read, but a frame needs at least a millisecond */
+		sys_framesinput++;
+		Sys_SleepUntil((earliest + sys_msecbase) * 1000LL);
+		return;
+	}
+
+	Sys_SleepUntil(target);
+
+	late = (int)(Sys_Microseconds() - target);
+	if (late < 0)
+	{
+		late = 0;
+	}
+
+	for (i = 0; i < FRAMESTATS_BUCKETS - 1 && late >= sys_framebuckets[i]; i++)
+		;
+
+	sys_framehistogram[i]++;
+	sys_framelatesum += late;
+	if (late > sys_framelatemax)
+	{
+		sys_framelatemax = late;
+	}
+}
+
+void Sys_FrameStats_f()
+{
+	int i, slept;
+
+	if ((Cmd_Argc() > 1) && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		memset(sys_framehistogram, 0, sizeof(sys_framehistogram));
+		sys_framesdue = sys_framesinput = sys_framelatemax = 0;
+		sys_framelatesum = 0;
+		return;
+	}
+
+	for (i = 0, slept = 0; i < FRAMESTATS_BUCKETS; i++)
+	{
+		slept += sys_framehistogram[i];
+	}
+
+	Com_Printf("%i frames slept to their deadline, %i woke up for input, %i were due already\n",
+		slept, sys_framesinput, sys_framesdue);
+
+	if (!slept)
+	{
+		return;
+	}
+
+	Com_Printf("woke up %i us late on average, %i us at worst\n", (int)(sys_framelatesum / slept), sys_framelatemax);
+
+	for (i = 0; i < FRAMESTATS_BUCKETS; i++)
+	{
+		if (i < FRAMESTATS_BUCKETS - 1)
+		{
+			Com_Printf("  < %4i us: %7i %5.1f%%\n", sys_framebuckets[i], sys_framehistogram[i], 100.0f * sys_framehistogram[i] / slept);
+		}
+		else
+		{
+			Com_Printf(" >= %4i us: %7i %5.1f%%\n", sys_framebuckets[i - 1], sys_framehistogram[i], 100.0f * sys_framehistogram[i] / slept);
+		}
+	}
+}
+
 void Sys_RedirectStdout()
 {
 	if (!logFileEnabled)
@@ -141,7 +312,11 @@ char* Sys_GetCurrentDirectory()
 	static char *workingDir = NULL;
 	if (workingDir == NULL)
 	{
+		#ifdef DEDICATED_ONLY
+		workingDir = (char *)Sys_GetBinaryDir(); // what SDL_GetBasePath returns
+		#else
 		workingDir = SDL_GetBasePath();
+		#endif
 
 		#ifdef _WIN32
 		while (1)
@@ -161,7 +336,18 @@ char* Sys_GetHomeDir()
 	static char *homeDir = NULL;
 	if (homeDir == NULL)
 	{
+		#ifdef DEDICATED_ONLY
+		/* the same place SDL_GetPrefPath picks on unix */
+		static char path[MAX_OSPATH];
+		char *base = getenv("XDG_DATA_HOME");
+		if (base && base[0])
+			snprintf(path, sizeof(path), "%s/%s/Quake2/", base, QUAKE2_TEAM_NAME);
+		else
+			snprintf(path, sizeof(path), "%s/.local/share/%s/Quake2/", getenv("HOME") ? getenv("HOME") : ".", QUAKE2_TEAM_NAME);
+		homeDir = path;
+		#else
 		homeDir = SDL_GetPrefPath(QUAKE2_TEAM_NAME, "Quake2");
+		#endif
 
 		#ifdef _WIN32
 		while (1)
@@ -181,14 +367,22 @@ void Sys_FreeLibrary(void *handle)
 	if (!handle)
 		return;
 
+	#ifdef DEDICATED_ONLY
+	dlclose(handle);
+	#else
 	SDL_UnloadObject(handle);
+	#endif
 }
 
 void* Sys_LoadLibrary(const char *path, const char *sym, void **handle)
 {
 	*handle = NULL;
 
+	#ifdef DEDICATED_ONLY
+	void *module = dlopen(path, RTLD_NOW);
+	#else
 	void *module = SDL_LoadObject(path);
+	#endif
 	if (!module)
 	{
 		//Com_Printf("%s failed: SDL_LoadObject returned NULL on %s\n", __func__, path);
@@ -198,11 +392,11 @@ void* Sys_LoadLibrary(const char *path, const char *sym, void **handle)
 	void *entry = NULL;
 	if (sym)
 	{
-		entry = SDL_LoadFunction(module, sym);
+		entry = Sys_GetProcAddress(module, sym);
 		if (!entry)
 		{
 			Com_Printf("%s failed: GetProcAddress returned NULL on %s\n", __func__, path);
-			SDL_UnloadObject(module);
+			Sys_FreeLibrary(module);
 			return NULL;
 		}
 	}
@@ -216,9 +410,113 @@ void* Sys_LoadLibrary(const char *path, const char *sym, void **handle)
 
 void* Sys_GetProcAddress(void *handle, const char *sym)
 {
+	#ifdef DEDICATED_ONLY
+	return dlsym(handle, sym);
+	#else
 	return SDL_LoadFunction(handle, sym);
+	#endif
 }
 
+#ifdef DEDICATED_ONLY
+
+typedef struct
+{
+	pthread_t thread;
+	int (*function)(void *);
+	void *data;
+} systhread_t;
+
+static void* Sys_ThreadMain(void *arg)
+{
+	systhread_t *thread = arg;
+
+	thread->function(thread->data);
+	return NULL;
+}
+
+void* Sys_CreateThread(int (*function)(void *), void *data)
+{
+	systhread_t *thread = malloc(sizeof(systhread_t));
+
+	thread->function = function;
+	thread->data = data;
+	if (pthread_create(&thread->thread, NULL, Sys_ThreadMain, thread))
+	{
+		free(thread);
+		return NULL;
+	}
+	return thread;
+}
+
+void Sys_WaitThread(void *thread)
+{
+	pthread_join(((systhread_t *)thread)->thread, NULL);
+	free(thread);
+}
+
+void* Sys_CreateSemaphore(int value)
+{
+	sem_t *semaphore = malloc(sizeof(sem_t));
+
+	if (sem_init(semaphore, 0, value))
+	{
+		free(semaphore);
+		return NULL;
+	}
+	return semaphore;
+}
+
+void Sys_DestroySemaphore(void *semaphore)
+{
+	sem_destroy(semaphore);
+	free(semaphore);
+}
+
+void Sys_SemaphoreWait(void *semaphore)
+{
+	while (sem_wait(semaphore) && errno == EINTR)
+		;
+}
+
+void Sys_SemaphorePost(void *semaphore)
+{
+	sem_post(semaphore);
+}
+
+#else
+
+void* Sys_CreateThread(int (*function)(void *), void *data)
+{
+	return SDL_CreateThread(function, "worker", data);
+}
+
+void Sys_WaitThread(void *thread)
+{
+	SDL_WaitThread(thread, NULL);
+}
+
+void* Sys_CreateSemaphore(int value)
+{
+	return SDL_CreateSemaphore(value);
+}
+
+void Sys_DestroySemaphore(void *semaphore)
+{
+	SDL_DestroySemaphore(semaphore);
+}
+
+void Sys_SemaphoreWait(void *semaphore)
+{
+	SDL_SemWait(semaphore);
+}
+
+void Sys_SemaphorePost(void *semaphore)
+{
+	SDL_SemPost(semaphore);
+}
+
+#endif
+
 void Sys_UnloadGame()
 {
 	Sys_FreeLibrary(game_library);
@@ -31,6 +31,7 @@
 
 #include <sys/mman.h>
 #include <errno.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #include <unistd.h>
 
@@ -46,18 +47,218 @@
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
+
+#define HUNK_POOL_ALIGN 0x200000 /* Huge page size. */
+#define HUNK_POOL_RANGES 256
+#define HUNK_PAGE_SIZE 4096
+
+typedef struct
+{
+	byte *base;
+	int size;
+} hunkRange_t;
+
 byte *membase;
 int maxhunksize;
 int curhunksize;
 
+/* With hunk_pool set, hunks are taken from one reservation backed by huge
+   pages, faulted in ahead of Hunk_Alloc and recycled by Hunk_Free. Free pool
+   memory is always zero, like fresh anonymous mappings. */
+static cvar_t *hunk_pool;
+static byte *poolbase;
+static int poolsize;
+static hunkRange_t poolfree[HUNK_POOL_RANGES]; /* Sorted by address. */
+static int poolnumfree;
+static qboolean pooled; /* The current hunk comes from the pool. */
+static int prefaulted; /* Bytes of the current hunk faulted in. */
+
+static long faultsatbegin;
+static int lastfaults;
+
+static long Hunk_PageFaults()
+{
+	struct rusage usage;
+
+	#if defined(RUSAGE_THREAD)
+	getrusage(RUSAGE_THREAD, &usage);
+	#else
+	getrusage(RUSAGE_SELF, &usage);
+	#endif
+
+	return usage.ru_minflt + usage.ru_majflt;
+}
+
+static void Hunk_InitPool()
+{
+	byte *reserve;
+
+	poolsize = (int)hunk_pool->value * 0x100000;
+	poolsize = (poolsize + HUNK_POOL_ALIGN - 1) & ~(HUNK_POOL_ALIGN - 1);
+
+	/* Over reserve so the pool can start on a huge page boundary. */
+	reserve = mmap(0, poolsize + HUNK_POOL_ALIGN, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (reserve == MAP_FAILED)
+	{
+		Com_Printf("Hunk_InitPool: unable to reserve %d bytes\n", poolsize);
+		Cvar_Set("hunk_pool", "0");
+		return;
+	}
+
+	poolbase = (byte *)(((size_t)reserve + HUNK_POOL_ALIGN - 1) & ~(size_t)(HUNK_POOL_ALIGN - 1));
+
+	#if defined(MADV_HUGEPAGE)
+	madvise(poolbase, poolsize, MADV_HUGEPAGE);
+	#endif
+
+	poolfree[0].base = poolbase;
+	poolfree[0].size = poolsize;
+	poolnumfree = 1;
+}
+
+static byte* Hunk_PoolTake(int size)
+{
+	byte *base;
+	int i;
+
+	for (i = 0; i < poolnumfree; i++)
+	{
+		if (poolfree[i].size >= size)
+		{
+			base = poolfree[i].base;
+			poolfree[i].base += size;
+			poolfree[i].size -= size;
+
+			if (poolfree[i].size == 0)
+			{
+				poolnumfree--;
+				memmove(&poolfree[i], &poolfree[i + 1], (poolnumfree - i) * sizeof(hunkRange_t));
+			}
+
+			return base;
+		}
+	}
+
+	return NULL;
+}
+
+static void Hunk_PoolGive(byte *base, int size)
+{
+	int i;
+
+	if (size <= 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < poolnumfree && poolfree[i].base < base; i++)
+	{
+	}
+
+	/* Merge with the neighbours. */
+	if ((i > 0) && (poolfree[i - 1].base + poolfree[i - 1].size == base))
+	{
+		poolfree[i - 1].size += size;
+
+		if ((i < poolnumfree) && (base + size == poolfree[i].base))
+		{
+			poolfree[i - 1].size += poolfree[i].size;
+			poolnumfree--;
+			memmove(&poolfree[i], &poolfree[i + 1], (poolnumfree - i) * sizeof(hunkRange_t));
+		}
+
+		return;
+	}
+
+	if ((i < poolnumfree) && (base + size == poolfree[i].base))
+	{
+		poolfree[i].base = base;
+		poolfree[i].size += size;
+		return;
+	}
+
+	if (poolnumfree == HUNK_POOL_RANGES)
+	{
+		Com_DPrintf("Hunk_PoolGive: too many free ranges, %d bytes lost\n", size);
+		return;
+	}
+
+	memmove(&poolfree[i + 1], &poolfree[i], (poolnumfree - i) * sizeof(hunkRange_t));
+	poolfree[i].base = base;
+	poolfree[i].size = size;
+	poolnumfree++;
+}
+
+/*
+ * Faults in the current pool hunk up to the given size, one huge page at
+ * a time, so parsing the model does not stop at every page.
+ */
+static void Hunk_Prefault(int size)
+{
+	int end;
+	int i;
+
+	end = (size + HUNK_POOL_ALIGN - 1) & ~(HUNK_POOL_ALIGN - 1);
+
+	if (end > maxhunksize)
+	{
+		end = maxhunksize;
+	}
+
+	#if defined(MADV_POPULATE_WRITE)
+	if (madvise(membase + prefaulted, end - prefaulted, MADV_POPULATE_WRITE) == 0)
+	{
+		prefaulted = end;
+		return;
+	}
+	#endif
+
+	for (i = prefaulted; i < end; i += HUNK_PAGE_SIZE)
+	{
+		((volatile byte *)membase)[i] = 0;
+	}
+
+	prefaulted = end;
+}
+
 void* Hunk_Begin(int maxsize)
 {
 	/* reserve a huge chunk of memory, but don't commit any yet */
 	maxhunksize = maxsize + sizeof(int);
 	curhunksize = 0;
+	faultsatbegin = Hunk_PageFaults();
 
-	membase = mmap(0, maxhunksize, PROT_READ | PROT_WRITE,
-			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (hunk_pool == NULL)
+	{
+		hunk_pool = Cvar_Get("hunk_pool", "0", CVAR_ARCHIVE);
+	}
+
+	pooled = false;
+	prefaulted = 0;
+
+	if (hunk_pool->value && (poolbase == NULL))
+	{
+		Hunk_InitPool();
+	}
+
+	if (hunk_pool->value && poolbase)
+	{
+		/* The tail is given back by Hunk_End. */
+		maxhunksize = (maxhunksize + HUNK_PAGE_SIZE - 1) & ~(HUNK_PAGE_SIZE - 1);
+		membase = Hunk_PoolTake(maxhunksize);
+		pooled = (membase != NULL);
+	}
+
+	if (!pooled)
+	{
+		membase = mmap(0, maxhunksize, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
 
 	if ((membase == NULL) || (membase == (byte *)-1))
 	{
@@ -77,12 +278,38 @@ void* Hunk_Alloc(int size)
 		Sys_Error("Hunk_Alloc overflow");
 	byte *buf = membase + sizeof(int) + curhunksize;
 	curhunksize += size;
+
+	if (pooled && (curhunksize + (int)sizeof(int) > prefaulted))
+	{
+		Hunk_Prefault(curhunksize + sizeof(int));
+	}
+
 	return buf;
 }
 
+/*
+ * Returns the number of page faults taken while the last hunk was built.
+ */
+int Hunk_Faults()
+{
+	return lastfaults;
+}
+
 int Hunk_End()
 {
 	byte *n = NULL;
+	int used;
+
+	lastfaults = Hunk_PageFaults() - faultsatbegin;
+
+	if (pooled)
+	{
+		used = (curhunksize + sizeof(int) + HUNK_PAGE_SIZE - 1) & ~(HUNK_PAGE_SIZE - 1);
+		Hunk_PoolGive(membase + used, maxhunksize - used);
+		*((int *)membase) = used;
+
+		return curhunksize;
+	}
 
 	#if defined(__linux__)
 	n = (byte *)mremap(membase, maxhunksize, curhunksize + sizeof(int), 0);
@@ -154,14 +381,51 @@ int Hunk_End()
 void Hunk_Free(void *base)
 {
 	byte *m;
+	int size;
 
 	if (base)
 	{
 		m = ((byte *)base) - sizeof(int);
 
+		/* Pool hunks are cleared and kept for the next model. */
+		if (poolbase && (m >= poolbase) && (m < poolbase + poolsize))
+		{
+			size = *((int *)m);
+			memset(m, 0, size);
+			Hunk_PoolGive(m, size);
+			return;
+		}
+
 		if (munmap(m, *((int *)m)))
 		{
 			Sys_Error("Hunk_Free: munmap failed (%d)", errno);
 		}
 	}
 }
+
+void* Sys_MapFile(FILE *f, int size)
+{
+	void *base;
+
+	if (size <= 0)
+	{
+		return NULL;
+	}
+
+	base = mmap(0, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+
+	if (base == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	return base;
+}
+
+void Sys_UnmapFile(void *base, int size)
+{
+	if (munmap(base, size))
+	{
+		Sys_Error("Sys_UnmapFile: munmap failed (%d)", errno);
+	}
+}
@@ -24,6 +24,11 @@
  * =======================================================================
  */
 
+/* For recvmmsg() and sendmmsg() - must be before any include! */
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "common/common.h"
 
 #ifndef __USE_POSIX
@@ -67,6 +72,37 @@ int ip6_sockets[2];
 int ipx_sockets[2];
 char *multicast_interface = NULL;
 
+/* Receives and sends many packets per system call. uClibc
+   claims to be glibc 2.2 and doesn't have them. */
+#if defined(__GLIBC__) && \
+	((__GLIBC__ > 2) || ((__GLIBC__ == 2) && (__GLIBC_MINOR__ >= 14)))
+#define NET_MMSG
+#endif
+
+#ifdef NET_MMSG
+#define MAX_PACKET_BATCH 32
+
+typedef struct
+{
+	struct mmsghdr msgs[MAX_PACKET_BATCH];
+	struct iovec iovecs[MAX_PACKET_BATCH];
+	struct sockaddr_storage addrs[MAX_PACKET_BATCH];
+	netadr_t to[MAX_PACKET_BATCH]; /* for error messages */
+	byte data[MAX_PACKET_BATCH][MAX_MSGLEN];
+	int socket;
+	int count, next;
+	qboolean queueing;
+} packetqueue_t;
+
+packetqueue_t net_recvqueues[2][3]; /* per source and protocol */
+packetqueue_t net_sendqueues[2];
+#endif
+
+/* system calls and packets since the last netstats */
+int net_recvcalls, net_recvpackets;
+int net_sendcalls, net_sendpackets;
+int net_frames;
+
 int NET_Socket(char *net_interface, int port, netsrc_t type, int family);
 char* NET_ErrorString(void);
 
@@ -186,8 +222,29 @@ void SockadrToNetadr(struct sockaddr_storage *s, netadr_t *a)
 	}
 }
 
+static void NET_Stats_f(void)
+{
+	int frames;
+
+	frames = net_frames ? net_frames : 1;
+
+	Com_Printf("%i packets received in %i calls, %i sent in %i calls\n",
+			net_recvpackets, net_recvcalls, net_sendpackets, net_sendcalls);
+	Com_Printf("%i frames, %.1f receive and %.1f send calls per frame\n",
+			net_frames, (float)net_recvcalls / frames,
+			(float)net_sendcalls / frames);
+	#ifndef NET_MMSG
+	Com_Printf("recvmmsg and sendmmsg aren't used\n");
+	#endif
+
+	net_recvcalls = net_recvpackets = 0;
+	net_sendcalls = net_sendpackets = 0;
+	net_frames = 0;
+}
+
 void NET_Init()
 {
+	Cmd_AddCommand("netstats", NET_Stats_f);
 }
 
 qboolean NET_CompareAdr(netadr_t a, netadr_t b)
@@ -503,6 +560,164 @@ void NET_SendLoopPacket(netsrc_t sock, int length, void *data, netadr_t to)
 	loop->msgs[i].datalen = length;
 }
 
+#ifdef NET_MMSG
+/*
+ * Returns the next packet received on the socket, the
+ * queue is refilled with one recvmmsg() once it is empty.
+ */
+static qboolean NET_GetQueuedPacket(packetqueue_t *queue, int net_socket,
+		netadr_t *net_from, sizebuf_t *net_message)
+{
+	struct mmsghdr *msg;
+	int ret;
+	int i;
+
+	while (1)
+	{
+		if (queue->next == queue->count)
+		{
+			for (i = 0; i < MAX_PACKET_BATCH; i++)
+			{
+				msg = &queue->msgs[i];
+				queue->iovecs[i].iov_base = queue->data[i];
+				queue->iovecs[i].iov_len = MAX_MSGLEN;
+				memset(&msg->msg_hdr, 0, sizeof(msg->msg_hdr));
+				msg->msg_hdr.msg_name = &queue->addrs[i];
+				msg->msg_hdr.msg_namelen = sizeof(queue->addrs[i]);
+				msg->msg_hdr.msg_iov = &queue->iovecs[i];
+				msg->msg_hdr.msg_iovlen = 1;
+			}
+
+			queue->count = 0;
+			queue->next = 0;
+
+			ret = recvmmsg(net_socket, queue->msgs, MAX_PACKET_BATCH,
+					MSG_DONTWAIT, NULL);
+			net_recvcalls++;
+
+			if (ret == -1)
+			{
+				if ((errno != EWOULDBLOCK) && (errno != ECONNREFUSED))
+				{
+					Com_Printf("NET_GetPacket: %s\n", NET_ErrorString());
+				}
+
+				return false;
+			}
+
+			if (ret == 0)
+			{
+				return false;
+			}
+
+			queue->count = ret;
+			net_recvpackets += ret;
+		}
+
+		i = queue->next++;
+		msg = &queue->msgs[i];
+
+		SockadrToNetadr(&queue->addrs[i], net_from);
+
+		if ((msg->msg_hdr.msg_flags & MSG_TRUNC) ||
+			((int)msg->msg_len >= net_message->maxsize))
+		{
+			Com_Printf("Oversize packet from %s\n", NET_AdrToString(*net_from));
+			continue;
+		}
+
+		memcpy(net_message->data, queue->data[i], msg->msg_len);
+		net_message->cursize = msg->msg_len;
+		return true;
+	}
+}
+
+/*
+ * Sends the queued packets with as few sendmmsg() as possible.
+ */
+static void NET_SendQueuedPackets(packetqueue_t *queue)
+{
+	int ret;
+	int i;
+
+	i = 0;
+
+	while (i < queue->count)
+	{
+		ret = sendmmsg(queue->socket, queue->msgs + i, queue->count - i, 0);
+		net_sendcalls++;
+
+		if (ret == -1)
+		{
+			/* the first one failed, skip it */
+			Com_Printf("NET_SendPacket ERROR: %s to %s\n", NET_ErrorString(),
+				NET_AdrToString(queue->to[i]));
+			i++;
+			continue;
+		}
+
+		net_sendpackets += ret;
+		i += ret;
+	}
+
+	queue->count = 0;
+}
+
+static void NET_QueuePacket(packetqueue_t *queue, int net_socket, int length,
+		void *data, struct sockaddr_storage *addr, int addr_size, netadr_t to)
+{
+	struct mmsghdr *msg;
+	int i;
+
+	/* one sendmmsg() goes to one socket */
+	if ((queue->count == MAX_PACKET_BATCH) ||
+		(queue->count && (queue->socket != net_socket)))
+	{
+		NET_SendQueuedPackets(queue);
+	}
+
+	i = queue->count++;
+	msg = &queue->msgs[i];
+
+	queue->socket = net_socket;
+	queue->to[i] = to;
+	memcpy(&queue->addrs[i], addr, sizeof(*addr));
+	memcpy(queue->data[i], data, length);
+	queue->iovecs[i].iov_base = queue->data[i];
+	queue->iovecs[i].iov_len = length;
+
+	memset(&msg->msg_hdr, 0, sizeof(msg->msg_hdr));
+	msg->msg_hdr.msg_name = &queue->addrs[i];
+	msg->msg_hdr.msg_namelen = addr_size;
+	msg->msg_hdr.msg_iov = &queue->iovecs[i];
+	msg->msg_hdr.msg_iovlen = 1;
+}
+#endif
+
+/*
+ * Holds back the packets sent on the socket until NET_FlushPackets(),
+ * so they go out together.
+ */
+void NET_QueuePackets(netsrc_t sock)
+{
+	#ifdef NET_MMSG
+	net_sendqueues[sock].queueing = true;
+	#endif
+}
+
+void NET_FlushPackets(netsrc_t sock)
+{
+	#ifdef NET_MMSG
+	NET_SendQueuedPackets(&net_sendqueues[sock]);
+	net_sendqueues[sock].queueing = false;
+	#endif
+
+	if (sock == NS_SERVER)
+	{
+		net_frames++;
+	}
+}
+
 qboolean NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message)
 {
 	int ret;
@@ -538,9 +753,20 @@ qboolean NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message
 			continue;
 		}
 
+		#ifdef NET_MMSG
+		if (NET_GetQueuedPacket(&net_recvqueues[sock][protocol], net_socket,
+				net_from, net_message))
+		{
+			return true;
+		}
+
+		continue;
+		#endif
+
 		fromlen = sizeof(from);
 		ret = recvfrom(net_socket, net_message->data, net_message->maxsize,
 				0, (struct sockaddr *)&from, &fromlen);
+		net_recvcalls++;
 
 		SockadrToNetadr(&from, net_from);
 
@@ -564,6 +790,7 @@ qboolean NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message
 			continue;
 		}
 
+		net_recvpackets++;
 		net_message->cursize = ret;
 		return true;
 	}
@@ -710,12 +937,27 @@ void NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 		}
 	}
 
+	#ifdef NET_MMSG
+	if (net_sendqueues[sock].queueing && (length <= MAX_MSGLEN))
+	{
+		NET_QueuePacket(&net_sendqueues[sock], net_socket, length, data,
+				&addr, addr_size, to);
+		return;
+	}
+	#endif
+
 	ret = sendto(net_socket,
 			data,
 			length,
 			0,
 			(struct sockaddr *)&addr,
 			addr_size);
+	net_sendcalls++;
+
+	if (ret != -1)
+	{
+		net_sendpackets++;
+	}
 
 	if (ret == -1)
 	{
@@ -768,6 +1010,11 @@ void NET_Config(qboolean multiplayer)
 		/* shut down any existing sockets */
 		for (i = 0; i < 2; i++)
 		{
+			#ifdef NET_MMSG
+			NET_FlushPackets(i);
+			memset(net_recvqueues[i], 0, sizeof(net_recvqueues[i]));
+			#endif
+
 			if (ip_sockets[i])
 			{
 				close(ip_sockets[i]);
@@ -968,9 +1215,10 @@ char* NET_ErrorString(void)
 }
 
 /*
- * sleeps msec or until net socket is ready
+ * sleeps usec or until net socket is ready,
+ * returns true when there is something to read
  */
-void NET_Sleep(int msec)
+qboolean NET_Sleep(int usec)
 {
 	struct timeval timeout;
 	fd_set fdset;
@@ -980,7 +1228,7 @@ void NET_Sleep(int msec)
 	if ((!ip_sockets[NS_SERVER] &&
 	     !ip6_sockets[NS_SERVER]) || (dedicated && !dedicated->value))
 	{
-		return; /* we're not a server, just run full speed */
+		return false; /* we're not a server, just run full speed */
 	}
 
 	FD_ZERO(&fdset);
@@ -990,10 +1238,18 @@ void NET_Sleep(int msec)
 		FD_SET(0, &fdset); /* stdin is processed too */
 	}
 
-	FD_SET(ip_sockets[NS_SERVER], &fdset); /* IPv4 network socket */
-	FD_SET(ip6_sockets[NS_SERVER], &fdset); /* IPv6 network socket */
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
-	select(MAX(ip_sockets[NS_SERVER],
-			ip6_sockets[NS_SERVER]) + 1, &fdset, NULL, NULL, &timeout);
+	if (ip_sockets[NS_SERVER])
+	{
+		FD_SET(ip_sockets[NS_SERVER], &fdset); /* IPv4 network socket */
+	}
+
+	if (ip6_sockets[NS_SERVER])
+	{
+		FD_SET(ip6_sockets[NS_SERVER], &fdset); /* IPv6 network socket */
+	}
+
+	timeout.tv_sec = usec / 1000000;
+	timeout.tv_usec = usec % 1000000;
+	return select(MAX(ip_sockets[NS_SERVER],
+			ip6_sockets[NS_SERVER]) + 1, &fdset, NULL, NULL, &timeout) > 0;
 }
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <dlfcn.h>
 #include <dirent.h>
@@ -48,7 +49,9 @@
 #include <termios.h>
 #include <unistd.h>
 
+#ifndef DEDICATED_ONLY
 #include "SDL/SDLWrapper.h"
+#endif
 
 #include "common/common.h"
 #include "common/glob.h"
@@ -291,13 +294,21 @@ void Sys_Error(char *error, ...)
 
 	fprintf(stderr, "Fatal error: %s\n", string);
 	
+	#ifndef DEDICATED_ONLY
 	SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal error", string, NULL);
+	#endif
 
 	exit(1);
 }
 
 void Sys_Sleep(int ms)
 {
+	struct timespec ts;
+
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000;
+	while (nanosleep(&ts, &ts) == -1 && errno == EINTR)
+		;
 }
 
 int main(int argc, char **argv)
@@ -27,6 +27,8 @@
 #include "backends/windows/winquake.h"
 #include "common/common.h"
 
+#include <io.h>
+
 byte *membase;
 int hunkcount;
 int hunkmaxsize;
@@ -83,6 +85,14 @@ int Hunk_End()
 	return cursize;
 }
 
+/*
+ * Page faults are not tracked here.
+ */
+int Hunk_Faults()
+{
+	return 0;
+}
+
 void Hunk_Free(void *base)
 {
 	if (base)
@@ -92,3 +102,33 @@ void Hunk_Free(void *base)
 
 	hunkcount--;
 }
+
+void* Sys_MapFile(FILE *f, int size)
+{
+	HANDLE mapping;
+	void *base;
+
+	if (size <= 0)
+	{
+		return NULL;
+	}
+
+	mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(f)),
+			NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (mapping == NULL)
+	{
+		return NULL;
+	}
+
+	/* The view keeps the mapping object alive. */
+	base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+	CloseHandle(mapping);
+
+	return base;
+}
+
+void Sys_UnmapFile(void *base, int size)
+{
+	UnmapViewOfFile(base);
+}
@@ -786,6 +786,17 @@ void NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to)
 	}
 }
 
+/*
+ * Winsock has no batched sends, packets go out right away.
+ */
+void NET_QueuePackets(netsrc_t sock)
+{
+}
+
+void NET_FlushPackets(netsrc_t sock)
+{
+}
+
 /* ============================================================================= */
 
 int NET_IPSocket(char *net_interface, int port, netsrc_t type, int family)
@@ -1194,10 +1205,10 @@ void NET_Config(qboolean multiplayer)
 }
 
 /*
- * sleeps msec or until
- * net socket is ready
+ * sleeps usec or until net socket is ready,
+ * returns true when there is something to read
  */
-void NET_Sleep(int msec)
+qboolean NET_Sleep(int usec)
 {
 	struct timeval timeout;
 	fd_set fdset;
@@ -1206,7 +1217,7 @@ void NET_Sleep(int msec)
 
 	if (!dedicated || !dedicated->value)
 	{
-		return; /* we're not a server, just run full speed */
+		return false; /* we're not a server, just run full speed */
 	}
 
 	FD_ZERO(&fdset);
@@ -1234,11 +1245,11 @@ void NET_Sleep(int msec)
 		}
 	}
 
-	timeout.tv_sec = msec / 1000;
-	timeout.tv_usec = (msec % 1000) * 1000;
+	timeout.tv_sec = usec / 1000000;
+	timeout.tv_usec = usec % 1000000;
 	i = max(ip_sockets[NS_SERVER], ip6_sockets[NS_SERVER]);
 	i = max(i, ipx_sockets[NS_SERVER]);
-	select(i + 1, &fdset, NULL, NULL, &timeout);
+	return select(i + 1, &fdset, NULL, NULL, &timeout) > 0;
 }
 
 /* =================================================================== */
@@ -410,6 +410,7 @@ void CL_RequestNextDownload(void)
 		precache_check = TEXTURE_CNT + 999;
 	}
 
+	CL_PrefetchLevel();
 	CL_RegisterSounds();
 
 	CL_PrepRefresh();
@@ -619,6 +620,8 @@ void CL_ParseDownload(void)
 			Com_Printf("failed to rename.\n");
 		}
 
+		FS_FlushFileCache();
+
 		cls.download = NULL;
 		cls.downloadpercent = 0;
 
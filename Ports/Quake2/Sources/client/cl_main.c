@@ -180,6 +180,8 @@ void CL_Record_f()
 		return;
 	}
 
+	FS_FlushFileCache();
+
 	cls.demorecording = true;
 
 	/* don't start saving messages until a non-delta compressed message is received */
@@ -449,6 +451,7 @@ static void CL_Precache_f()
 		unsigned map_checksum; /* for detecting cheater maps */
 
 		CM_LoadMap(cl.configstrings[CS_MODELS + 1], true, &map_checksum);
+		CL_PrefetchLevel();
 		CL_RegisterSounds();
 		CL_PrepRefresh();
 		return;
@@ -705,9 +708,39 @@ void CL_SendCommand()
 	CL_CheckForResend();
 }
 
+static int extratime;
+
+/*
+ * Milliseconds until CL_Frame will run
+ * a frame, to let Qcommon_Run sleep
+ */
+int CL_FrameDelay()
+{
+	if (dedicated->value)
+	{
+		return 100;
+	}
+
+	if (cl_timedemo->value)
+	{
+		return 0;
+	}
+
+	if (cls.state == ca_connected)
+	{
+		return 100 - extratime;
+	}
+
+	if (cl_maxfps->value <= 0)
+	{
+		return 0;
+	}
+
+	return (int)ceilf(1000 / cl_maxfps->value) - extratime;
+}
+
 void CL_Frame(int msec)
 {
-	static int extratime;
 	static int lasttimecalled;
 
 	if (dedicated->value)
@@ -61,7 +61,9 @@ char *svc_strings[256] =
 void CL_RegisterSounds(void)
 {
 	int i;
+	int start;
 
+	start = Sys_Milliseconds();
 	S_BeginRegistration();
 	CL_RegisterTEntSounds();
 
@@ -77,6 +79,8 @@ void CL_RegisterSounds(void)
 	}
 
 	S_EndRegistration();
+
+	Com_DPrintf("Sounds registered in %ims\n", Sys_Milliseconds() - start);
 }
 
 /*
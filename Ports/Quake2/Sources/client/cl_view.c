@@ -222,6 +222,74 @@ void V_TestLights(void)
 	}
 }
 
+/*
+ * Queues the files of the next level for the prefetch thread, so they are
+ * read while CL_RegisterSounds and CL_PrepRefresh decode and upload the
+ * ones before them. The collision map must already be loaded.
+ */
+void CL_PrefetchLevel(void)
+{
+	extern int numtexinfo;
+	extern mapsurface_t map_surfaces[];
+	char name[MAX_QPATH];
+	char *s;
+	int i;
+
+	FS_BeginPrefetch();
+
+	/* Same order as they are registered. */
+	for (i = 1; i < MAX_SOUNDS && cl.configstrings[CS_SOUNDS + i][0]; i++)
+	{
+		s = cl.configstrings[CS_SOUNDS + i];
+
+		if (s[0] == '*')
+		{
+			continue; /* sexed sounds depend on the player model */
+		}
+
+		if (s[0] == '#')
+		{
+			FS_Prefetch(s + 1);
+		}
+		else
+		{
+			Com_sprintf(name, sizeof(name), "sound/%s", s);
+			FS_Prefetch(name);
+		}
+	}
+
+	for (i = 0; i < numtexinfo; i++)
+	{
+		Com_sprintf(name, sizeof(name), "textures/%s.wal", map_surfaces[i].rname);
+		FS_Prefetch(name);
+	}
+
+	for (i = 2; i < MAX_MODELS && cl.configstrings[CS_MODELS + i][0]; i++)
+	{
+		s = cl.configstrings[CS_MODELS + i];
+
+		if ((s[0] != '*') && (s[0] != '#'))
+		{
+			FS_Prefetch(s);
+		}
+	}
+
+	for (i = 1; i < MAX_IMAGES && cl.configstrings[CS_IMAGES + i][0]; i++)
+	{
+		s = cl.configstrings[CS_IMAGES + i];
+
+		if ((s[0] != '/') && (s[0] != '\\'))
+		{
+			Com_sprintf(name, sizeof(name), "pics/%s.pcx", s);
+			FS_Prefetch(name);
+		}
+		else
+		{
+			FS_Prefetch(s + 1);
+		}
+	}
+}
+
 /*
  * Call before entering a new level, or after changing dlls
  */
@@ -232,12 +300,15 @@ void CL_PrepRefresh(void)
 	char name[MAX_QPATH];
 	float rotate;
 	vec3_t axis;
+	int start, map, models, images, clients;
 
 	if (!cl.configstrings[CS_MODELS + 1][0])
 	{
 		return;
 	}
 
+	start = Sys_Milliseconds();
+
 	SCR_AddDirtyPoint(0, 0);
 	SCR_AddDirtyPoint(viddef.width - 1, viddef.height - 1);
 
@@ -250,6 +321,7 @@ void CL_PrepRefresh(void)
 	SCR_UpdateScreen();
 	R_BeginRegistration(mapname);
 	Com_Printf("                                     \r");
+	map = Sys_Milliseconds();
 
 	/* precache status bar pics */
 	Com_Printf("pics\r");
@@ -306,6 +378,8 @@ void CL_PrepRefresh(void)
 		}
 	}
 
+	models = Sys_Milliseconds();
+
 	Com_Printf("images\r");
 	SCR_UpdateScreen();
 
@@ -316,6 +390,7 @@ void CL_PrepRefresh(void)
 	}
 
 	Com_Printf("                                     \r");
+	images = Sys_Milliseconds();
 
 	for (i = 0; i < MAX_CLIENTS; i++)
 	{
@@ -332,6 +407,7 @@ void CL_PrepRefresh(void)
 	}
 
 	CL_LoadClientinfo(&cl.baseclientinfo, "unnamed\\male/grunt");
+	clients = Sys_Milliseconds();
 
 	/* set sky textures and speed */
 	Com_Printf("sky\r");
@@ -344,6 +420,13 @@ void CL_PrepRefresh(void)
 	/* the renderer can now free unneeded stuff */
 	R_EndRegistration();
 
+	/* everything left in the prefetch batch was not needed */
+	FS_EndPrefetch();
+
+	Com_DPrintf("Level prepared in %ims: map %ims, models %ims, images %ims, clients %ims, sky %ims\n",
+		Sys_Milliseconds() - start, map - start, models - map, images - models,
+		clients - images, Sys_Milliseconds() - clients);
+
 	/* clear any lines of console text */
 	Con_ClearNotify();
 
@@ -421,6 +421,7 @@ void CL_AddDLights();
 void CL_AddTEnts();
 void CL_AddLightStyles();
 
+void CL_PrefetchLevel();
 void CL_PrepRefresh();
 void CL_RegisterSounds();
 
@@ -32,6 +32,7 @@ LoadPCX(char *origname, byte **pic, byte **palette, int *width, int *height)
 	byte *raw;
 	pcx_t *pcx;
 	int x, y;
+	int xmax, ymax;
 	int len;
 	int dataByte, runLength;
 	byte *out, *pix;
@@ -51,7 +52,7 @@ LoadPCX(char *origname, byte **pic, byte **palette, int *width, int *height)
         *palette = NULL;
 
 	/* load the file */
-	len = FS_LoadFile(filename, (void **)&raw);
+	len = FS_LoadFileView(filename, (void **)&raw);
 
 	if (!raw)
 	{
@@ -59,29 +60,24 @@ LoadPCX(char *origname, byte **pic, byte **palette, int *width, int *height)
 		return;
 	}
 
-	/* parse the PCX file */
+	/* parse the PCX file, the buffer is read only */
 	pcx = (pcx_t *)raw;
 
-	pcx->xmin = LittleShort(pcx->xmin);
-	pcx->ymin = LittleShort(pcx->ymin);
-	pcx->xmax = LittleShort(pcx->xmax);
-	pcx->ymax = LittleShort(pcx->ymax);
-	pcx->hres = LittleShort(pcx->hres);
-	pcx->vres = LittleShort(pcx->vres);
-	pcx->bytes_per_line = LittleShort(pcx->bytes_per_line);
-	pcx->palette_type = LittleShort(pcx->palette_type);
+	xmax = LittleShort(pcx->xmax);
+	ymax = LittleShort(pcx->ymax);
 
 	raw = &pcx->data;
 
 	if ((pcx->manufacturer != 0x0a) || (pcx->version != 5) ||
 		(pcx->encoding != 1) || (pcx->bits_per_pixel != 8) ||
-		(pcx->xmax >= 640) || (pcx->ymax >= 480))
+		(xmax >= 640) || (ymax >= 480))
 	{
 		R_printf(PRINT_ALL, "Bad pcx file %s\n", filename);
+		FS_FreeFile(pcx);
 		return;
 	}
 
-	out = malloc((pcx->ymax + 1) * (pcx->xmax + 1));
+	out = malloc((ymax + 1) * (xmax + 1));
 
 	*pic = out;
 
@@ -95,17 +91,17 @@ LoadPCX(char *origname, byte **pic, byte **palette, int *width, int *height)
 
 	if (width)
 	{
-		*width = pcx->xmax + 1;
+		*width = xmax + 1;
 	}
 
 	if (height)
 	{
-		*height = pcx->ymax + 1;
+		*height = ymax + 1;
 	}
 
-	for (y = 0; y <= pcx->ymax; y++, pix += pcx->xmax + 1)
+	for (y = 0; y <= ymax; y++, pix += xmax + 1)
 	{
-		for (x = 0; x <= pcx->xmax; )
+		for (x = 0; x <= xmax; )
 		{
 			dataByte = *raw++;
 
@@ -142,7 +138,7 @@ GetPCXInfo(char *filename, int *width, int *height)
 	pcx_t *pcx;
 	byte *raw;
 
-	FS_LoadFile(filename, (void **)&raw);
+	FS_LoadFileView(filename, (void **)&raw);
 
 	if (!raw)
 	{
@@ -151,8 +147,8 @@ GetPCXInfo(char *filename, int *width, int *height)
 
 	pcx = (pcx_t *)raw;
 
-	*width = pcx->xmax + 1;
-	*height = pcx->ymax + 1;
+	*width = LittleShort(pcx->xmax) + 1;
+	*height = LittleShort(pcx->ymax) + 1;
 
 	FS_FreeFile(raw);
 
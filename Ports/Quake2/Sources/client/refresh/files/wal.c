@@ -42,7 +42,7 @@ LoadWal(char *origname)
 		Q_strlcat(name, ".wal", sizeof(name));
 	}
 
-	FS_LoadFile(name, (void **)&mt);
+	FS_LoadFileView(name, (void **)&mt);
 
 	if (!mt)
 	{
@@ -66,7 +66,7 @@ GetWalInfo(char *name, int *width, int *height)
 {
 	miptex_t *mt;
 
-	FS_LoadFile(name, (void **)&mt);
+	FS_LoadFileView(name, (void **)&mt);
 
 	if (!mt)
 	{
@@ -210,6 +210,7 @@ typedef struct model_s
 	image_t *skins[MAX_MD2SKINS];
 
 	int extradatasize;
+	int extradatafaults; /* page faults taken while loading */
 	void *extradata;
 } model_t;
 
@@ -131,7 +131,7 @@ void Mod_Modellist_f()
 	{
 		if (!mod->name[0])
 			continue;
-		R_printf(PRINT_ALL, "%8i : %s\n", mod->extradatasize, mod->name);
+		R_printf(PRINT_ALL, "%8i : %s (%i faults)\n", mod->extradatasize, mod->name, mod->extradatafaults);
 		total += mod->extradatasize;
 	}
 
@@ -192,7 +192,7 @@ model_t* Mod_ForName(char *name, qboolean crash)
 	strcpy(mod->name, name);
 
 	/* load the file */
-	int modfilelen = FS_LoadFile(mod->name, (void **)&buf);
+	int modfilelen = FS_LoadFileView(mod->name, (void **)&buf);
 	if (!buf)
 	{
 		if (crash)
@@ -229,6 +229,7 @@ model_t* Mod_ForName(char *name, qboolean crash)
 	}
 
 	loadmodel->extradatasize = Hunk_End();
+	loadmodel->extradatafaults = Hunk_Faults();
 
 	FS_FreeFile(buf);
 
@@ -794,7 +795,7 @@ void Mod_LoadPlanes(lump_t *l)
 void Mod_LoadBrushModel(model_t *mod, void *buffer)
 {
 	int i;
-	dheader_t *header;
+	dheader_t header;
 	mmodel_t *bm;
 
     model_t *model = loadmodel;
@@ -804,9 +805,10 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer)
 	if (model != mod_known)
 		R_error(ERR_DROP, "Loaded a brush model after the world");
 
-	header = (dheader_t *)buffer;
+	/* the file may be a read only view, swap a copy of the header */
+	header = *(dheader_t *)buffer;
 
-	i = LittleLong(header->version);
+	i = LittleLong(header.version);
 
 	if (i != BSPVERSION)
 	{
@@ -814,26 +816,26 @@ void Mod_LoadBrushModel(model_t *mod, void *buffer)
 	}
 
 	/* swap all the lumps */
-	mod_base = (byte *)header;
+	mod_base = (byte *)buffer;
 
 	for (i = 0; i < (int)sizeof(dheader_t) / 4; i++)
 	{
-		((int *)header)[i] = LittleLong(((int *)header)[i]);
+		((int *)&header)[i] = LittleLong(((int *)&header)[i]);
 	}
 
 	/* load into heap */
-	Mod_LoadVertexes(&header->lumps[LUMP_VERTEXES]);
-	Mod_LoadEdges(&header->lumps[LUMP_EDGES]);
-	Mod_LoadSurfedges(&header->lumps[LUMP_SURFEDGES]);
-	Mod_LoadLighting(&header->lumps[LUMP_LIGHTING]);
-	Mod_LoadPlanes(&header->lumps[LUMP_PLANES]);
-	Mod_LoadTexinfo(&header->lumps[LUMP_TEXINFO]);
-	Mod_LoadFaces(model, &header->lumps[LUMP_FACES]);
-	Mod_LoadMarksurfaces(&header->lumps[LUMP_LEAFFACES]);
-	Mod_LoadVisibility(&header->lumps[LUMP_VISIBILITY]);
-	Mod_LoadLeafs(&header->lumps[LUMP_LEAFS]);
-	Mod_LoadNodes(&header->lumps[LUMP_NODES]);
-	Mod_LoadSubmodels(&header->lumps[LUMP_MODELS]);
+	Mod_LoadVertexes(&header.lumps[LUMP_VERTEXES]);
+	Mod_LoadEdges(&header.lumps[LUMP_EDGES]);
+	Mod_LoadSurfedges(&header.lumps[LUMP_SURFEDGES]);
+	Mod_LoadLighting(&header.lumps[LUMP_LIGHTING]);
+	Mod_LoadPlanes(&header.lumps[LUMP_PLANES]);
+	Mod_LoadTexinfo(&header.lumps[LUMP_TEXINFO]);
+	Mod_LoadFaces(model, &header.lumps[LUMP_FACES]);
+	Mod_LoadMarksurfaces(&header.lumps[LUMP_LEAFFACES]);
+	Mod_LoadVisibility(&header.lumps[LUMP_VISIBILITY]);
+	Mod_LoadLeafs(&header.lumps[LUMP_LEAFS]);
+	Mod_LoadNodes(&header.lumps[LUMP_NODES]);
+	Mod_LoadSubmodels(&header.lumps[LUMP_MODELS]);
 	mod->numframes = 2; /* regular and alternate animation */
 
 	/* set up the submodels */
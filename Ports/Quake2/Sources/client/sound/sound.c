@@ -120,7 +120,7 @@ sfxcache_t* S_LoadSound(sfx_t *s)
 		Com_sprintf(namebuffer, sizeof(namebuffer), "sound/%s", name);
 	}
 
-	size = FS_LoadFile(namebuffer, (void **)&data);
+	size = FS_LoadFileView(namebuffer, (void **)&data);
 
 	if (!data)
 	{
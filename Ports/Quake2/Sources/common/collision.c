@@ -27,18 +27,28 @@
 
 #include "common/common.h"
 
+/* Planes are stored inline, so the trace loops never leave the node and
+   brush side arrays. Nodes are 32 bytes and sorted depth first. */
 typedef struct
 {
-	cplane_t *plane;
+	cplane_t plane;
 	int children[2]; /* negative numbers are leafs */
+	int pad;
 } cnode_t;
 
 typedef struct
 {
-	cplane_t *plane;
+	cplane_t plane;
 	mapsurface_t *surface;
 } cbrushside_t;
 
+typedef struct
+{
+	int num;
+	float p1f, p2f;
+	vec3_t p1, p2;
+} chullstack_t;
+
 typedef struct
 {
 	int contents;
@@ -54,8 +64,32 @@ typedef struct
 	int numsides;
 	int firstbrushside;
 	int checkcount; /* to avoid repeated testings */
+	int checkrays; /* rays of a batch that tested it, valid for checkcount */
 } cbrush_t;
 
+#define MAX_BATCH_RAYS 8
+
+/* one piece of a batched ray, as cut by the nodes above it */
+typedef struct
+{
+	int ray;
+	float p1f, p2f;
+	vec3_t p1, p2;
+} cbatchseg_t;
+
+/* The rays of a batch. Positions and sizes are kept one array per
+   axis, so a brush side is tested against all rays in one loop. */
+typedef struct
+{
+	int count;
+	float start[3][MAX_BATCH_RAYS];
+	float end[3][MAX_BATCH_RAYS];
+	float mins[3][MAX_BATCH_RAYS];
+	float maxs[3][MAX_BATCH_RAYS];
+	vec3_t extents[MAX_BATCH_RAYS];
+	trace_t *trace[MAX_BATCH_RAYS];
+} cbatch_t;
+
 typedef struct
 {
 	int numareaportals;
@@ -115,6 +149,8 @@ vec3_t trace_start, trace_end;
 vec3_t trace_mins, trace_maxs;
 vec3_t trace_extents;
 
+cbatch_t trace_batch;
+
 #ifndef DEDICATED_ONLY
 int c_pointcontents;
 int c_traces, c_brush_traces;
@@ -123,6 +159,8 @@ int c_traces, c_brush_traces;
 /* 1/32 epsilon to keep floating point happy */
 #define DIST_EPSILON (0.03125f)
 
+#define MAX_HULL_STACK 128
+
 void FloodArea_r(carea_t *area, int floodnum)
 {
 	int i;
@@ -342,12 +380,10 @@ void CM_InitBoxHull(void)
 
 		/* brush sides */
 		s = &map_brushsides[numbrushsides + i];
-		s->plane = map_planes + (numplanes + i * 2 + side);
 		s->surface = &nullsurface;
 
 		/* nodes */
 		c = &map_nodes[box_headnode + i];
-		c->plane = map_planes + (numplanes + i * 2);
 		c->children[side] = -1 - emptyleaf;
 
 		if (i != 5)
@@ -371,6 +407,9 @@ void CM_InitBoxHull(void)
 		p->signbits = 0;
 		VectorClear(p->normal);
 		p->normal[i >> 1] = -1;
+
+		c->plane = box_planes[i * 2];
+		s->plane = box_planes[i * 2 + side];
 	}
 }
 
@@ -380,6 +419,8 @@ void CM_InitBoxHull(void)
  */
 int CM_HeadnodeForBox(vec3_t mins, vec3_t maxs)
 {
+	int i;
+
 	box_planes[0].dist = maxs[0];
 	box_planes[1].dist = -maxs[0];
 	box_planes[2].dist = mins[0];
@@ -393,6 +434,13 @@ int CM_HeadnodeForBox(vec3_t mins, vec3_t maxs)
 	box_planes[10].dist = mins[2];
 	box_planes[11].dist = -mins[2];
 
+	/* the nodes and sides keep their own copies */
+	for (i = 0; i < 6; i++)
+	{
+		map_nodes[box_headnode + i].plane.dist = box_planes[i * 2].dist;
+		map_brushsides[box_brush->firstbrushside + i].plane.dist = box_planes[i * 2 + (i & 1)].dist;
+	}
+
 	return box_headnode;
 }
 
@@ -405,7 +453,7 @@ int CM_PointLeafnum_r(vec3_t p, int num)
 	while (num >= 0)
 	{
 		node = map_nodes + num;
-		plane = node->plane;
+		plane = &node->plane;
 
 		if (plane->type < 3)
 		{
@@ -467,7 +515,7 @@ void CM_BoxLeafnums_r(int nodenum)
 		}
 
 		node = &map_nodes[nodenum];
-		plane = node->plane;
+		plane = &node->plane;
 		s = BOX_ON_PLANE_SIDE(leaf_mins, leaf_maxs, plane);
 
 		if (s == 1)
@@ -533,6 +581,473 @@ int CM_PointContents(vec3_t p, int headnode)
 	return map_leafs[l].contents;
 }
 
+/*
+ * CM_ClipBoxToBrush for several rays. The side distances are computed
+ * for all rays first, the loop is free of branches so the compiler can
+ * vectorize it, then each ray updates its own enter and leave fractions.
+ */
+static void CM_ClipBoxToBrushBatch(cbrush_t *brush, int *rays, int count)
+{
+	float p1[3][MAX_BATCH_RAYS], p2[3][MAX_BATCH_RAYS];
+	float mins[3][MAX_BATCH_RAYS], maxs[3][MAX_BATCH_RAYS];
+	float d1[MAX_BATCH_RAYS], d2[MAX_BATCH_RAYS];
+	float enterfrac[MAX_BATCH_RAYS], leavefrac[MAX_BATCH_RAYS];
+	int leadside[MAX_BATCH_RAYS];
+	qboolean getout[MAX_BATCH_RAYS], startout[MAX_BATCH_RAYS];
+	qboolean infront[MAX_BATCH_RAYS];
+	float *ofs[3];
+	float dist, f;
+	int i, j, k, left;
+	cplane_t *plane;
+	cbrushside_t *side;
+	trace_t *trace;
+
+	if (!brush->numsides)
+	{
+		return;
+	}
+
+	#ifndef DEDICATED_ONLY
+	c_brush_traces += count;
+	#endif
+
+	for (k = 0; k < count; k++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			p1[j][k] = trace_batch.start[j][rays[k]];
+			p2[j][k] = trace_batch.end[j][rays[k]];
+			mins[j][k] = trace_batch.mins[j][rays[k]];
+			maxs[j][k] = trace_batch.maxs[j][rays[k]];
+		}
+
+		enterfrac[k] = -1;
+		leavefrac[k] = 1;
+		leadside[k] = -1;
+		getout[k] = false;
+		startout[k] = false;
+		infront[k] = false;
+	}
+
+	left = count;
+
+	for (i = 0; i < brush->numsides && left; i++)
+	{
+		side = &map_brushsides[brush->firstbrushside + i];
+		plane = &side->plane;
+
+		/* push the plane out apropriately for mins/maxs,
+		   for points both are zero and this is the plane */
+		for (j = 0; j < 3; j++)
+		{
+			ofs[j] = plane->normal[j] < 0 ? maxs[j] : mins[j];
+		}
+
+		for (k = 0; k < count; k++)
+		{
+			dist = plane->dist - (ofs[0][k] * plane->normal[0] +
+					ofs[1][k] * plane->normal[1] + ofs[2][k] * plane->normal[2]);
+
+			d1[k] = (p1[0][k] * plane->normal[0] + p1[1][k] * plane->normal[1] +
+					p1[2][k] * plane->normal[2]) - dist;
+			d2[k] = (p2[0][k] * plane->normal[0] + p2[1][k] * plane->normal[1] +
+					p2[2][k] * plane->normal[2]) - dist;
+		}
+
+		for (k = 0; k < count; k++)
+		{
+			if (infront[k])
+			{
+				continue;
+			}
+
+			if (d2[k] > 0)
+			{
+				getout[k] = true; /* endpoint is not in solid */
+			}
+
+			if (d1[k] > 0)
+			{
+				startout[k] = true;
+			}
+
+			/* if completely in front of face, no intersection */
+			if ((d1[k] > 0) && (d2[k] >= d1[k]))
+			{
+				infront[k] = true;
+				left--;
+				continue;
+			}
+
+			if ((d1[k] <= 0) && (d2[k] <= 0))
+			{
+				continue;
+			}
+
+			/* crosses face */
+			if (d1[k] > d2[k])
+			{
+				/* enter */
+				f = (d1[k] - DIST_EPSILON) / (d1[k] - d2[k]);
+
+				if (f > enterfrac[k])
+				{
+					enterfrac[k] = f;
+					leadside[k] = i;
+				}
+			}
+			else
+			{
+				/* leave */
+				f = (d1[k] + DIST_EPSILON) / (d1[k] - d2[k]);
+
+				if (f < leavefrac[k])
+				{
+					leavefrac[k] = f;
+				}
+			}
+		}
+	}
+
+	for (k = 0; k < count; k++)
+	{
+		if (infront[k])
+		{
+			continue;
+		}
+
+		trace = trace_batch.trace[rays[k]];
+
+		if (!startout[k])
+		{
+			/* original point was inside brush */
+			trace->startsolid = true;
+
+			if (!getout[k])
+			{
+				trace->allsolid = true;
+			}
+
+			continue;
+		}
+
+		if ((enterfrac[k] < leavefrac[k]) &&
+		    (enterfrac[k] > -1) && (enterfrac[k] < trace->fraction))
+		{
+			if (leadside[k] == -1)
+			{
+				Com_Error(ERR_FATAL, "clipplane was NULL!\n");
+			}
+
+			side = &map_brushsides[brush->firstbrushside + leadside[k]];
+
+			trace->fraction = enterfrac[k] < 0 ? 0 : enterfrac[k];
+			trace->plane = side->plane;
+			trace->surface = &(side->surface->c);
+			trace->contents = brush->contents;
+		}
+	}
+}
+
+static void CM_TraceToLeafBatch(int leafnum, cbatchseg_t *segs, int count)
+{
+	int rays[MAX_BATCH_RAYS];
+	int i, k, n;
+	int brushnum;
+	cleaf_t *leaf;
+	cbrush_t *b;
+
+	leaf = &map_leafs[leafnum];
+
+	if (!(leaf->contents & trace_contents))
+	{
+		return;
+	}
+
+	/* trace the rays against all brushes in the leaf */
+	for (i = 0; i < leaf->numleafbrushes; i++)
+	{
+		brushnum = map_leafbrushes[leaf->firstleafbrush + i];
+		b = &map_brushes[brushnum];
+
+		if (b->checkcount != checkcount)
+		{
+			b->checkcount = checkcount;
+			b->checkrays = 0;
+		}
+
+		n = 0;
+
+		for (k = 0; k < count; k++)
+		{
+			if (b->checkrays & (1 << segs[k].ray))
+			{
+				continue; /* already checked this brush in another leaf */
+			}
+
+			if (!trace_batch.trace[segs[k].ray]->fraction)
+			{
+				continue;
+			}
+
+			b->checkrays |= 1 << segs[k].ray;
+			rays[n++] = segs[k].ray;
+		}
+
+		if (!n || !(b->contents & trace_contents))
+		{
+			continue;
+		}
+
+		CM_ClipBoxToBrushBatch(b, rays, n);
+	}
+}
+
+/*
+ * CM_RecursiveHullCheck for a batch. Every ray is cut at the same nodes
+ * as it would be alone and visits the leafs in the same order, near side
+ * first, so the traces come out exactly as from CM_BoxTrace. Rays that
+ * do not cross a node travel down together.
+ */
+static void CM_RecursiveHullCheckBatch(int num, cbatchseg_t *segs, int count)
+{
+	cbatchseg_t lists[3][MAX_BATCH_RAYS];
+	int counts[3];
+	cbatchseg_t *seg, *near, *far;
+	cnode_t *node;
+	cplane_t *plane;
+	float t1, t2, offset;
+	float frac, frac2;
+	float idist;
+	float *extents;
+	int i, k, n;
+	int side;
+
+	/* drop the rays that already hit something nearer */
+	for (k = 0, n = 0; k < count; k++)
+	{
+		if (trace_batch.trace[segs[k].ray]->fraction > segs[k].p1f)
+		{
+			segs[n++] = segs[k];
+		}
+	}
+
+	if (!n)
+	{
+		return;
+	}
+
+	if (num < 0)
+	{
+		CM_TraceToLeafBatch(-1 - num, segs, n);
+		return;
+	}
+
+	node = map_nodes + num;
+	plane = &node->plane;
+
+	/* 0: child 0 first, 1: then child 1, 2: child 0 again for
+	   the far side of the rays that started behind the plane */
+	counts[0] = counts[1] = counts[2] = 0;
+
+	for (k = 0; k < n; k++)
+	{
+		seg = &segs[k];
+		extents = trace_batch.extents[seg->ray];
+
+		if (plane->type < 3)
+		{
+			t1 = seg->p1[plane->type] - plane->dist;
+			t2 = seg->p2[plane->type] - plane->dist;
+			offset = extents[plane->type];
+		}
+		else
+		{
+			t1 = DotProduct(plane->normal, seg->p1) - plane->dist;
+			t2 = DotProduct(plane->normal, seg->p2) - plane->dist;
+			offset = (float)fabsf(extents[0] * plane->normal[0]) +
+			        (float)fabsf(extents[1] * plane->normal[1]) +
+			        (float)fabsf(extents[2] * plane->normal[2]);
+		}
+
+		if ((t1 >= offset) && (t2 >= offset))
+		{
+			lists[0][counts[0]++] = *seg;
+			continue;
+		}
+
+		if ((t1 < -offset) && (t2 < -offset))
+		{
+			lists[1][counts[1]++] = *seg;
+			continue;
+		}
+
+		/* put the crosspoint DIST_EPSILON pixels on the near side */
+		if (t1 < t2)
+		{
+			idist = 1.0f / (t1 - t2);
+			side = 1;
+			frac2 = (t1 + offset + DIST_EPSILON) * idist;
+			frac = (t1 - offset + DIST_EPSILON) * idist;
+		}
+		else
+		if (t1 > t2)
+		{
+			idist = 1.0f / (t1 - t2);
+			side = 0;
+			frac2 = (t1 - offset - DIST_EPSILON) * idist;
+			frac = (t1 + offset + DIST_EPSILON) * idist;
+		}
+		else
+		{
+			side = 0;
+			frac = 1;
+			frac2 = 0;
+		}
+
+		frac = frac < 0 ? 0 : (frac > 1 ? 1 : frac);
+		frac2 = frac2 < 0 ? 0 : (frac2 > 1 ? 1 : frac2);
+
+		if (side)
+		{
+			near = &lists[1][counts[1]++];
+			far = &lists[2][counts[2]++];
+		}
+		else
+		{
+			near = &lists[0][counts[0]++];
+			far = &lists[1][counts[1]++];
+		}
+
+		/* move up to the node */
+		near->ray = seg->ray;
+		near->p1f = seg->p1f;
+		near->p2f = seg->p1f + (seg->p2f - seg->p1f) * frac;
+		VectorCopy(seg->p1, near->p1);
+
+		for (i = 0; i < 3; i++)
+		{
+			near->p2[i] = seg->p1[i] + frac * (seg->p2[i] - seg->p1[i]);
+		}
+
+		/* go past the node */
+		far->ray = seg->ray;
+		far->p1f = seg->p1f + (seg->p2f - seg->p1f) * frac2;
+		far->p2f = seg->p2f;
+		VectorCopy(seg->p2, far->p2);
+
+		for (i = 0; i < 3; i++)
+		{
+			far->p1[i] = seg->p1[i] + frac2 * (seg->p2[i] - seg->p1[i]);
+		}
+	}
+
+	if (counts[0])
+	{
+		CM_RecursiveHullCheckBatch(node->children[0], lists[0], counts[0]);
+	}
+
+	if (counts[1])
+	{
+		CM_RecursiveHullCheckBatch(node->children[1], lists[1], counts[1]);
+	}
+
+	if (counts[2])
+	{
+		CM_RecursiveHullCheckBatch(node->children[0], lists[2], counts[2]);
+	}
+}
+
+/*
+ * Traces several boxes through the same head node at once. Gives the
+ * same results as calling CM_BoxTrace for each of them, but rays that
+ * stay close share the walk down the tree and brushes are clipped
+ * against all rays that reach them together.
+ */
+void CM_BoxTraceBatch(traceray_t *rays, trace_t *traces, int count, int headnode, int brushmask)
+{
+	cbatchseg_t segs[MAX_BATCH_RAYS];
+	traceray_t *ray;
+	int i, j, k, n;
+
+	while (count > 0)
+	{
+		n = 0;
+
+		for (i = 0; i < count && n < MAX_BATCH_RAYS; i++)
+		{
+			ray = &rays[i];
+
+			/* position tests take their own path */
+			if (!numnodes || VectorCompare(ray->start, ray->end))
+			{
+				traces[i] = CM_BoxTrace(ray->start, ray->end, ray->mins,
+						ray->maxs, headnode, brushmask);
+				continue;
+			}
+
+			memset(&traces[i], 0, sizeof(trace_t));
+			traces[i].fraction = 1;
+			traces[i].surface = &(nullsurface.c);
+
+			for (j = 0; j < 3; j++)
+			{
+				trace_batch.start[j][n] = ray->start[j];
+				trace_batch.end[j][n] = ray->end[j];
+				trace_batch.mins[j][n] = ray->mins[j];
+				trace_batch.maxs[j][n] = ray->maxs[j];
+				trace_batch.extents[n][j] = -ray->mins[j] > ray->maxs[j] ?
+					-ray->mins[j] : ray->maxs[j];
+			}
+
+			trace_batch.trace[n] = &traces[i];
+
+			segs[n].ray = n;
+			segs[n].p1f = 0;
+			segs[n].p2f = 1;
+			VectorCopy(ray->start, segs[n].p1);
+			VectorCopy(ray->end, segs[n].p2);
+			n++;
+		}
+
+		trace_batch.count = n;
+
+		if (n)
+		{
+			checkcount++; /* for multi-check avoidance */
+
+			#ifndef DEDICATED_ONLY
+			c_traces += n;
+			#endif
+
+			trace_contents = brushmask;
+			CM_RecursiveHullCheckBatch(headnode, segs, n);
+
+			for (j = 0; j < n; j++)
+			{
+				ray = &rays[trace_batch.trace[j] - traces];
+
+				if (trace_batch.trace[j]->fraction == 1)
+				{
+					VectorCopy(ray->end, trace_batch.trace[j]->endpos);
+				}
+				else
+				{
+					for (k = 0; k < 3; k++)
+					{
+						trace_batch.trace[j]->endpos[k] = ray->start[k] +
+							trace_batch.trace[j]->fraction * (ray->end[k] - ray->start[k]);
+					}
+				}
+			}
+		}
+
+		rays += i;
+		traces += i;
+		count -= i;
+	}
+}
+
 /*
  * Handles offseting and rotation of the end points for moving and
  * rotating entities
@@ -596,7 +1111,7 @@ void CM_ClipBoxToBrush(vec3_t mins, vec3_t maxs, vec3_t p1, vec3_t p2, trace_t *
 	for (i = 0; i < brush->numsides; i++)
 	{
 		side = &map_brushsides[brush->firstbrushside + i];
-		plane = side->plane;
+		plane = &side->plane;
 
 		if (!trace_ispoint)
 		{
@@ -725,7 +1240,7 @@ void CM_TestBoxInBrush(vec3_t mins, vec3_t maxs, vec3_t p1, trace_t *trace, cbru
 	for (i = 0; i < brush->numsides; i++)
 	{
 		side = &map_brushsides[brush->firstbrushside + i];
-		plane = side->plane;
+		plane = &side->plane;
 
 		/* general box case
 		   push the plane out
@@ -843,133 +1358,180 @@ void CM_TestInLeaf(int leafnum)
 	}
 }
 
+/*
+ * Walks the nodes crossed by the trace, near side first. The far sides
+ * wait on a small stack instead of the call stack, deep trees that would
+ * overflow it fall back to recursion.
+ */
 void CM_RecursiveHullCheck(int num, float p1f, float p2f, vec3_t p1, vec3_t p2)
 {
+	chullstack_t stack[MAX_HULL_STACK];
+	chullstack_t *top;
 	cnode_t *node;
 	cplane_t *plane;
 	float t1, t2, offset;
 	float frac, frac2;
 	float idist;
 	int i;
-	vec3_t mid;
+	vec3_t start, end;
+	vec3_t mid, mid2;
 	int side;
-	float midf;
+	float midf, midf2;
 
-	if (trace_trace.fraction <= p1f)
-	{
-		return; /* already hit something nearer */
-	}
+	top = stack;
+	VectorCopy(p1, start);
+	VectorCopy(p2, end);
 
-	/* if < 0, we are in a leaf node */
-	if (num < 0)
+	while (1)
 	{
-		CM_TraceToLeaf(-1 - num);
-		return;
-	}
+		if (trace_trace.fraction <= p1f)
+		{
+			goto pop; /* already hit something nearer */
+		}
 
-	/* find the point distances to the seperating plane
-	   and the offset for the size of the box */
-	node = map_nodes + num;
-	plane = node->plane;
+		/* if < 0, we are in a leaf node */
+		if (num < 0)
+		{
+			CM_TraceToLeaf(-1 - num);
+			goto pop;
+		}
 
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-		offset = trace_extents[plane->type];
-	}
-	else
-	{
-		t1 = DotProduct(plane->normal, p1) - plane->dist;
-		t2 = DotProduct(plane->normal, p2) - plane->dist;
+		/* find the point distances to the seperating plane
+		   and the offset for the size of the box */
+		node = map_nodes + num;
+		plane = &node->plane;
 
-		if (trace_ispoint)
+		if (plane->type < 3)
 		{
-			offset = 0;
+			t1 = start[plane->type] - plane->dist;
+			t2 = end[plane->type] - plane->dist;
+			offset = trace_extents[plane->type];
 		}
 		else
 		{
-			offset = (float)fabsf(trace_extents[0] * plane->normal[0]) +
-			        (float)fabsf(trace_extents[1] * plane->normal[1]) +
-			        (float)fabsf(trace_extents[2] * plane->normal[2]);
+			t1 = DotProduct(plane->normal, start) - plane->dist;
+			t2 = DotProduct(plane->normal, end) - plane->dist;
+
+			if (trace_ispoint)
+			{
+				offset = 0;
+			}
+			else
+			{
+				offset = (float)fabsf(trace_extents[0] * plane->normal[0]) +
+				        (float)fabsf(trace_extents[1] * plane->normal[1]) +
+				        (float)fabsf(trace_extents[2] * plane->normal[2]);
+			}
 		}
-	}
 
-	/* see which sides we need to consider */
-	if ((t1 >= offset) && (t2 >= offset))
-	{
-		CM_RecursiveHullCheck(node->children[0], p1f, p2f, p1, p2);
-		return;
-	}
+		/* see which sides we need to consider */
+		if ((t1 >= offset) && (t2 >= offset))
+		{
+			num = node->children[0];
+			continue;
+		}
 
-	if ((t1 < -offset) && (t2 < -offset))
-	{
-		CM_RecursiveHullCheck(node->children[1], p1f, p2f, p1, p2);
-		return;
-	}
+		if ((t1 < -offset) && (t2 < -offset))
+		{
+			num = node->children[1];
+			continue;
+		}
 
-	/* put the crosspoint DIST_EPSILON pixels on the near side */
-	if (t1 < t2)
-	{
-		idist = 1.0f / (t1 - t2);
-		side = 1;
-		frac2 = (t1 + offset + DIST_EPSILON) * idist;
-		frac = (t1 - offset + DIST_EPSILON) * idist;
-	}
-	else
-	if (t1 > t2)
-	{
-		idist = 1.0f / (t1 - t2);
-		side = 0;
-		frac2 = (t1 - offset - DIST_EPSILON) * idist;
-		frac = (t1 + offset + DIST_EPSILON) * idist;
-	}
-	else
-	{
-		side = 0;
-		frac = 1;
-		frac2 = 0;
-	}
+		/* put the crosspoint DIST_EPSILON pixels on the near side */
+		if (t1 < t2)
+		{
+			idist = 1.0f / (t1 - t2);
+			side = 1;
+			frac2 = (t1 + offset + DIST_EPSILON) * idist;
+			frac = (t1 - offset + DIST_EPSILON) * idist;
+		}
+		else
+		if (t1 > t2)
+		{
+			idist = 1.0f / (t1 - t2);
+			side = 0;
+			frac2 = (t1 - offset - DIST_EPSILON) * idist;
+			frac = (t1 + offset + DIST_EPSILON) * idist;
+		}
+		else
+		{
+			side = 0;
+			frac = 1;
+			frac2 = 0;
+		}
 
-	/* move up to the node */
-	if (frac < 0)
-	{
-		frac = 0;
-	}
+		/* move up to the node */
+		if (frac < 0)
+		{
+			frac = 0;
+		}
 
-	if (frac > 1)
-	{
-		frac = 1;
-	}
+		if (frac > 1)
+		{
+			frac = 1;
+		}
 
-	midf = p1f + (p2f - p1f) * frac;
+		midf = p1f + (p2f - p1f) * frac;
 
-	for (i = 0; i < 3; i++)
-	{
-		mid[i] = p1[i] + frac * (p2[i] - p1[i]);
-	}
+		for (i = 0; i < 3; i++)
+		{
+			mid[i] = start[i] + frac * (end[i] - start[i]);
+		}
 
-	CM_RecursiveHullCheck(node->children[side], p1f, midf, p1, mid);
+		/* go past the node */
+		if (frac2 < 0)
+		{
+			frac2 = 0;
+		}
 
-	/* go past the node */
-	if (frac2 < 0)
-	{
-		frac2 = 0;
-	}
+		if (frac2 > 1)
+		{
+			frac2 = 1;
+		}
 
-	if (frac2 > 1)
-	{
-		frac2 = 1;
-	}
+		midf2 = p1f + (p2f - p1f) * frac2;
 
-	midf = p1f + (p2f - p1f) * frac2;
+		for (i = 0; i < 3; i++)
+		{
+			mid2[i] = start[i] + frac2 * (end[i] - start[i]);
+		}
 
-	for (i = 0; i < 3; i++)
-	{
-		mid[i] = p1[i] + frac2 * (p2[i] - p1[i]);
-	}
+		if (top == stack + MAX_HULL_STACK)
+		{
+			CM_RecursiveHullCheck(node->children[side], p1f, midf, start, mid);
 
-	CM_RecursiveHullCheck(node->children[side ^ 1], midf, p2f, mid, p2);
+			num = node->children[side ^ 1];
+			p1f = midf2;
+			VectorCopy(mid2, start);
+			continue;
+		}
+
+		/* the far side is traced once the near one is done */
+		top->num = node->children[side ^ 1];
+		top->p1f = midf2;
+		top->p2f = p2f;
+		VectorCopy(mid2, top->p1);
+		VectorCopy(end, top->p2);
+		top++;
+
+		num = node->children[side];
+		p2f = midf;
+		VectorCopy(mid, end);
+		continue;
+
+pop:
+		if (top == stack)
+		{
+			return;
+		}
+
+		top--;
+		num = top->num;
+		p1f = top->p1f;
+		p2f = top->p2f;
+		VectorCopy(top->p1, start);
+		VectorCopy(top->p2, end);
+	}
 }
 
 trace_t CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask)
@@ -1242,7 +1804,7 @@ void CMod_LoadNodes(lump_t *l)
 
 	for (i = 0; i < count; i++, out++, in++)
 	{
-		out->plane = map_planes + LittleLong(in->planenum);
+		out->plane = map_planes[LittleLong(in->planenum)];
 
 		for (j = 0; j < 2; j++)
 		{
@@ -1252,6 +1814,90 @@ void CMod_LoadNodes(lump_t *l)
 	}
 }
 
+/*
+ * Renumbers the nodes depth first from every model's head node, front
+ * child first, so a trace mostly walks forward through memory. Nodes no
+ * model reaches keep their order at the end.
+ */
+void CMod_SortNodes(void)
+{
+	cnode_t *sorted;
+	int *remap;
+	int *stack;
+	int i, j, num, count, depth;
+
+	sorted = Z_Malloc(numnodes * sizeof(cnode_t));
+	remap = Z_Malloc(numnodes * sizeof(int));
+	stack = Z_Malloc((numnodes + 1) * sizeof(int));
+
+	for (i = 0; i < numnodes; i++)
+	{
+		remap[i] = -1;
+	}
+
+	count = 0;
+
+	for (i = 0; i < numcmodels; i++)
+	{
+		stack[0] = map_cmodels[i].headnode;
+		depth = 1;
+
+		while (depth)
+		{
+			num = stack[--depth];
+
+			if ((num < 0) || (num >= numnodes) || (remap[num] != -1))
+			{
+				continue;
+			}
+
+			remap[num] = count;
+			sorted[count++] = map_nodes[num];
+
+			stack[depth++] = map_nodes[num].children[1];
+			stack[depth++] = map_nodes[num].children[0];
+		}
+	}
+
+	for (i = 0; i < numnodes; i++)
+	{
+		if (remap[i] == -1)
+		{
+			remap[i] = count;
+			sorted[count++] = map_nodes[i];
+		}
+	}
+
+	for (i = 0; i < numnodes; i++)
+	{
+		for (j = 0; j < 2; j++)
+		{
+			num = sorted[i].children[j];
+
+			if ((num >= 0) && (num < numnodes))
+			{
+				sorted[i].children[j] = remap[num];
+			}
+		}
+	}
+
+	for (i = 0; i < numcmodels; i++)
+	{
+		num = map_cmodels[i].headnode;
+
+		if ((num >= 0) && (num < numnodes))
+		{
+			map_cmodels[i].headnode = remap[num];
+		}
+	}
+
+	memcpy(map_nodes, sorted, numnodes * sizeof(cnode_t));
+
+	Z_Free(stack);
+	Z_Free(remap);
+	Z_Free(sorted);
+}
+
 void CMod_LoadBrushes(lump_t *l)
 {
 	dbrush_t *in;
@@ -1468,7 +2114,7 @@ void CMod_LoadBrushSides(lump_t *l)
 	for (i = 0; i < count; i++, in++, out++)
 	{
 		num = LittleShort(in->planenum);
-		out->plane = &map_planes[num];
+		out->plane = map_planes[num];
 		j = LittleShort(in->texinfo);
 
 		if (j >= numtexinfo)
@@ -1610,7 +2256,7 @@ cmodel_t* CM_LoadMap(char *name, qboolean clientload, unsigned *checksum)
 		return &map_cmodels[0]; /* cinematic servers won't have anything at all */
 	}
 
-	length = FS_LoadFile(name, (void **)&buf);
+	length = FS_LoadFileView(name, (void **)&buf);
 
 	if (!buf)
 	{
@@ -1645,6 +2291,7 @@ cmodel_t* CM_LoadMap(char *name, qboolean clientload, unsigned *checksum)
 	CMod_LoadBrushSides(&header.lumps[LUMP_BRUSHSIDES]);
 	CMod_LoadSubmodels(&header.lumps[LUMP_MODELS]);
 	CMod_LoadNodes(&header.lumps[LUMP_NODES]);
+	CMod_SortNodes();
 	CMod_LoadAreas(&header.lumps[LUMP_AREAS]);
 	CMod_LoadAreaPortals(&header.lumps[LUMP_AREAPORTALS]);
 	CMod_LoadVisibility(&header.lumps[LUMP_VISIBILITY]);
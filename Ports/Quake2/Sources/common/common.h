@@ -507,13 +507,15 @@ void NET_Config(qboolean multiplayer);
 
 qboolean NET_GetPacket(netsrc_t sock, netadr_t *net_from, sizebuf_t *net_message);
 void NET_SendPacket(netsrc_t sock, int length, void *data, netadr_t to);
+void NET_QueuePackets(netsrc_t sock);
+void NET_FlushPackets(netsrc_t sock);
 
 qboolean NET_CompareAdr(netadr_t a, netadr_t b);
 qboolean NET_CompareBaseAdr(netadr_t a, netadr_t b);
 qboolean NET_IsLocalAddress(netadr_t adr);
 char* NET_AdrToString(netadr_t a);
 qboolean NET_StringToAdr(char *s, netadr_t *a);
-void NET_Sleep(int msec);
+qboolean NET_Sleep(int usec);
 
 /*=================================================================== */
 
@@ -589,6 +591,7 @@ int CM_TransformedPointContents(vec3_t p, int headnode, vec3_t origin, vec3_t an
 
 trace_t CM_BoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask);
 trace_t CM_TransformedBoxTrace(vec3_t start, vec3_t end, vec3_t mins, vec3_t maxs, int headnode, int brushmask, vec3_t origin, vec3_t angles);
+void CM_BoxTraceBatch(traceray_t *rays, trace_t *traces, int count, int headnode, int brushmask);
 
 byte* CM_ClusterPVS(int cluster);
 byte* CM_ClusterPHS(int cluster);
@@ -661,15 +664,26 @@ char* FS_Gamedir();
 char* FS_WritableGamedir();
 char* FS_NextPath(char *prevpath);
 int FS_LoadFile(char *path, void **buffer);
+int FS_LoadFileView(char *path, void **buffer);
 
 /* a null buffer will just return the file length without loading */
 /* a -1 length is not present */
 
 /* properly handles partial reads */
 
+/* FS_LoadFileView buffers may point into a mapped pak and must not be */
+/* written to, both kinds of buffer are released with FS_FreeFile */
+
 void FS_FreeFile(void *buffer);
+void FS_FlushFileCache();
 qboolean FS_CreatePath(char *path);
 
+/* files queued between FS_BeginPrefetch and FS_EndPrefetch are read */
+/* by a background thread and picked up by FS_LoadFile */
+void FS_BeginPrefetch();
+void FS_Prefetch(const char *name);
+void FS_EndPrefetch();
+
 /* MISC */
 
 #define ERR_FATAL 0 /* exit the entire game with a popup window */
@@ -728,6 +742,8 @@ void Sys_Init();
 void Sys_Quit();
 void Sys_Error(char *error, ...);
 void Sys_Sleep(int ms);
+void Sys_WaitFrame(int earliest, int deadline);
+void Sys_FrameStats_f();
 
 char* Sys_ConsoleInput();
 void Sys_ConsoleOutput(char *string);
@@ -740,6 +756,16 @@ void Sys_GetExecutablePath(char * exePath, int maxLength);
 char* Sys_GetHomeDir();
 const char* Sys_GetBinaryDir();
 
+void* Sys_MapFile(FILE *f, int size);
+void Sys_UnmapFile(void *base, int size);
+
+void* Sys_CreateThread(int (*function)(void *), void *data);
+void Sys_WaitThread(void *thread);
+void* Sys_CreateSemaphore(int value);
+void Sys_DestroySemaphore(void *semaphore);
+void Sys_SemaphoreWait(void *semaphore);
+void Sys_SemaphorePost(void *semaphore);
+
 void Sys_FreeLibrary(void *handle);
 void* Sys_LoadLibrary(const char *path, const char *sym, void **handle);
 void* Sys_GetProcAddress(void *handle, const char *sym);
@@ -750,12 +776,14 @@ void CL_Init();
 void CL_Drop();
 void CL_Shutdown();
 void CL_Frame(int msec);
+int CL_FrameDelay();
 void Con_Print(char *text);
 void SCR_BeginLoadingPlaque();
 
 void SV_Init();
 void SV_Shutdown(char *finalmsg, qboolean reconnect);
 void SV_Frame(int msec);
+int SV_FrameDelay();
 
 void Qcommon_Run(int argc, char **argv);
 
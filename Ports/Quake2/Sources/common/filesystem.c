@@ -29,19 +29,48 @@
 #include "common/glob.h"
 
 #ifdef ZIP
-#include "unzip/unzip.h"
+#include "zlib.h"
 #endif
 
 #define MAX_HANDLES 512
 #define MAX_PAKS 100
+#define MAX_MISSCACHE 256 /* Must be a power of two. */
+#define MAX_PREFETCH 1024
+#define PREFETCH_PAGE 4096
+#define PREFETCH_WINDOW 16 /* Files opened ahead at once. */
+#define PREFETCH_BYTES (8 * 1024 * 1024) /* Bytes read ahead at once. */
+
+#ifdef ZIP
+#define ZIP_LOCAL_SIG 0x04034b50
+#define ZIP_CENTRAL_SIG 0x02014b50
+#define ZIP_END_SIG 0x06054b50
+#define ZIP_LOCAL_SIZE 30
+#define ZIP_CENTRAL_SIZE 46
+#define ZIP_END_SIZE 22
+#define ZIP_MAX_COMMENT 0xffff
+#define ZIP_BUFSIZE 16384
+
+/* Inflate state, kept in a pool and reused between PK3 reads. */
+typedef struct fsInflate_s
+{
+	z_stream stream;
+	byte buffer[ZIP_BUFSIZE];
+	struct fsInflate_s *next;
+} fsInflate_t;
+#endif
+
+struct fsPack_s;
 
 typedef struct
 {
 	char name[MAX_QPATH];
 	fsMode_t mode;
-	FILE *file; /* Only one will be used. */
+	FILE *file;
+	struct fsPack_s *pack; /* Set when file is the shared stream of a pack. */
+	long position; /* Read position in the shared stream. */
 	#ifdef ZIP
-	unzFile *zip; /* (file or zip) */
+	fsInflate_t *inflate; /* Set for compressed PK3 members. */
+	int remaining; /* Compressed bytes not yet given to inflate. */
 	#endif
 } fsHandle_t;
 
@@ -57,18 +86,29 @@ typedef struct
 {
 	char name[MAX_QPATH];
 	int size;
-	int offset; /* Ignored in PK3 files. */
+	int offset; /* -1 in PK3 files until the local header was read. */
+	int hashNext; /* Next file in the same hash chain, -1 terminates. */
+	#ifdef ZIP
+	int compressedSize;
+	int localOffset; /* Offset of the PK3 local file header. */
+	qboolean deflated;
+	#endif
 } fsPackFile_t;
 
-typedef struct
+typedef struct fsPack_s
 {
 	char name[MAX_OSPATH];
 	int numFiles;
-	FILE *pak;
+	FILE *pak; /* Shared stream, PAK or PK3. */
 	#ifdef ZIP
-	unzFile *pk3;
+	qboolean pk3;
 	#endif
 	fsPackFile_t *files;
+	FILE *prefetch; /* Stream of the prefetch thread. */
+	byte *map; /* Read only mapping of the whole PAK, or NULL. */
+	int mapSize;
+	int hashMask; /* Hash size - 1, the size is a power of two. */
+	int *hashHeads; /* First file of each hash chain, -1 if empty. */
 } fsPack_t;
 
 typedef struct fsSearchPath_s
@@ -114,6 +154,42 @@ static char fs_writableGamedir[MAX_OSPATH];
 static char fs_fileInPath[MAX_OSPATH];
 static qboolean fs_fileInPack;
 
+/* Names not found in any search path. Flushed by FS_FlushFileCache(). */
+static char fs_missCache[MAX_MISSCACHE][MAX_QPATH];
+
+#ifdef ZIP
+static fsInflate_t *fs_inflatePool;
+#endif
+
+/* Files read ahead by the prefetch thread, see FS_BeginPrefetch(). */
+typedef struct
+{
+	char name[MAX_QPATH];
+	fsHandle_t handle; /* Owned by the prefetch thread until done is posted. */
+	int size;
+	byte *buffer; /* NULL if the file is only paged in from a mapped pack. */
+	qboolean started; /* Opened and handed to the thread. */
+	qboolean waiting; /* Didn't fit the window, size is known. */
+	qboolean failed;
+	qboolean claimed;
+	void *done;
+} fsPrefetch_t;
+
+static fsPrefetch_t fs_prefetch[MAX_PREFETCH];
+static int fs_numPrefetch;
+static int fs_usedPrefetch;
+
+/* Entries handed to the thread in the order it reads them, -1 ends. */
+static int fs_prefetchOrder[MAX_PREFETCH + 1];
+static int fs_numPrefetchOrder;
+
+/* The window of started but unclaimed entries. */
+static int fs_nextPrefetch;
+static int fs_prefetchOpen;
+static int fs_prefetchBytes;
+static void *fs_prefetchThread;
+static void *fs_prefetchQueued;
+
 /* Set by FS_FOpenFile. */
 int file_from_pak = 0;
 #ifdef ZIP
@@ -126,6 +202,8 @@ cvar_t *fs_basedir;
 cvar_t *fs_cddir;
 cvar_t *fs_gamedirvar;
 cvar_t *fs_debug;
+cvar_t *fs_mmap;
+cvar_t *fs_prefetch_threaded;
 
 fsHandle_t* FS_GetFileByHandle(fileHandle_t f);
 char* Sys_GetCurrentDirectory();
@@ -270,11 +348,7 @@ fsHandle_t* FS_HandleForFile(const char *path, fileHandle_t *f)
 	fsHandle_t *handle = fs_handles;
 	for (int i = 0; i < MAX_HANDLES; i++, handle++)
 	{
-		if ((handle->file == NULL)
-		    #ifdef ZIP
-		    && (handle->zip == NULL)
-		    #endif
-		    )
+		if (handle->file == NULL)
 		{
 			Q_strlcpy(handle->name, path, sizeof(handle->name));
 			*f = i + 1;
@@ -317,6 +391,8 @@ int FS_FOpenFileAppend(fsHandle_t *handle)
 
 	if (handle->file)
 	{
+		FS_FlushFileCache();
+
 		if (fs_debug->value)
 			Com_Printf("FS_FOpenFileAppend: '%s'.\n", path);
 		return FS_FileLength(handle->file);
@@ -341,6 +417,8 @@ int FS_FOpenFileWrite(fsHandle_t *handle)
 
 	if ((handle->file = fopen(path, "wb")) != NULL)
 	{
+		FS_FlushFileCache();
+
 		if (fs_debug->value)
 			Com_Printf("FS_FOpenFileWrite: '%s'.\n", path);
 
@@ -360,20 +438,97 @@ void FS_FCloseFile(fileHandle_t f)
 {
 	fsHandle_t *handle = FS_GetFileByHandle(f);
 
-	if (handle->file)
+	#ifdef ZIP
+	if (handle->inflate)
+	{
+		handle->inflate->next = fs_inflatePool;
+		fs_inflatePool = handle->inflate;
+	}
+	#endif
+
+	/* The shared stream is owned by its pack. */
+	if (handle->file && (handle->pack == NULL))
 	{
 		fclose(handle->file);
 	}
-	#ifdef ZIP
+
+	memset(handle, 0, sizeof(*handle));
+}
+
+#ifdef ZIP
+static int FS_ZipShort(const byte *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static int FS_ZipLong(const byte *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned)p[3] << 24);
+}
+
+static fsInflate_t* FS_AllocInflate()
+{
+	fsInflate_t *z = fs_inflatePool;
+
+	if (z)
+	{
+		fs_inflatePool = z->next;
+		inflateReset(&z->stream);
+	}
 	else
-	if (handle->zip)
 	{
-		unzCloseCurrentFile(handle->zip);
-		unzClose(handle->zip);
+		z = Z_Malloc(sizeof(fsInflate_t));
+
+		/* Raw deflate data, zip entries have no zlib header. */
+		if (inflateInit2(&z->stream, -MAX_WBITS) != Z_OK)
+		{
+			Com_Error(ERR_FATAL, "FS_AllocInflate: inflateInit2 failed");
+		}
+	}
+
+	z->stream.avail_in = 0;
+	z->next = NULL;
+
+	return z;
+}
+#endif
+
+/*
+ * Sets up a handle to read a pack member from the shared stream.
+ */
+static qboolean FS_OpenPackFile(fsPack_t *pack, fsPackFile_t *file, fsHandle_t *handle)
+{
+	#ifdef ZIP
+	byte header[ZIP_LOCAL_SIZE];
+
+	/* First open of a PK3 member, skip its local header once. */
+	if (file->offset < 0)
+	{
+		if (fseek(pack->pak, file->localOffset, SEEK_SET) ||
+		    (fread(header, 1, ZIP_LOCAL_SIZE, pack->pak) != ZIP_LOCAL_SIZE) ||
+		    (FS_ZipLong(header) != ZIP_LOCAL_SIG))
+		{
+			return false;
+		}
+
+		file->offset = file->localOffset + ZIP_LOCAL_SIZE +
+			FS_ZipShort(header + 26) + FS_ZipShort(header + 28);
 	}
 	#endif
 
-	memset(handle, 0, sizeof(*handle));
+	handle->file = pack->pak;
+	handle->pack = pack;
+	handle->position = file->offset;
+
+	#ifdef ZIP
+	if (file->deflated)
+	{
+		handle->inflate = FS_AllocInflate();
+		handle->remaining = file->compressedSize;
+	}
+	#endif
+
+	return true;
 }
 
 int Developer_searchpath(int who)
@@ -399,6 +554,8 @@ int FS_FOpenFile(const char *name, fileHandle_t *f, qboolean gamedir_only)
 	fsHandle_t *handle;
 	fsPack_t *pack;
 	fsSearchPath_t *search;
+	unsigned hash;
+	char *miss;
 	int i;
 
 	file_from_pak = 0;
@@ -410,8 +567,21 @@ int FS_FOpenFile(const char *name, fileHandle_t *f, qboolean gamedir_only)
 	Q_strlcpy(handle->name, name, sizeof(handle->name));
 	handle->mode = FS_READ;
 
+	hash = Com_HashKey(handle->name);
+	miss = fs_missCache[hash & (MAX_MISSCACHE - 1)];
+
+	/* Saves are written behind our back, so only cache full searches. */
+	if (!gamedir_only && (strcmp(miss, handle->name) == 0))
+	{
+		search = NULL;
+	}
+	else
+	{
+		search = fs_searchPaths;
+	}
+
 	/* Search through the path, one element at a time. */
-	for (search = fs_searchPaths; search; search = search->next)
+	for ( ; search; search = search->next)
 	{
 		if (gamedir_only)
 		{
@@ -426,7 +596,7 @@ int FS_FOpenFile(const char *name, fileHandle_t *f, qboolean gamedir_only)
 		{
 			pack = search->pack;
 
-			for (i = 0; i < pack->numFiles; i++)
+			for (i = pack->hashHeads[hash & pack->hashMask]; i != -1; i = pack->files[i].hashNext)
 			{
 				if (Q_stricmp(pack->files[i].name, handle->name) == 0)
 				{
@@ -440,41 +610,23 @@ int FS_FOpenFile(const char *name, fileHandle_t *f, qboolean gamedir_only)
 							handle->name, pack->name);
 					}
 
-					if (pack->pak)
-					{
-						/* PAK */
-						file_from_pak = 1;
-						handle->file = fopen(pack->name, "rb");
-
-						if (handle->file)
-						{
-							fseek(handle->file, pack->files[i].offset, SEEK_SET);
-							return pack->files[i].size;
-						}
-					}
 					#ifdef ZIP
-					else
 					if (pack->pk3)
 					{
-						/* PK3 */
 						file_from_pk3 = 1;
 						Q_strlcpy(file_from_pk3_name, strrchr(pack->name, '/') + 1, sizeof(file_from_pk3_name));
-						handle->zip = unzOpen(pack->name);
-
-						if (handle->zip)
-						{
-							if (unzLocateFile(handle->zip, handle->name, 2) == UNZ_OK)
-							{
-								if (unzOpenCurrentFile(handle->zip) == UNZ_OK)
-								{
-									return pack->files[i].size;
-								}
-							}
-
-							unzClose(handle->zip);
-						}
 					}
+					else
 					#endif
+					{
+						file_from_pak = 1;
+					}
+
+					/* Read through the stream opened at load time. */
+					if (FS_OpenPackFile(pack, &pack->files[i], handle))
+					{
+						return pack->files[i].size;
+					}
 
 					Com_Error(ERR_FATAL, "Couldn't reopen '%s'", pack->name);
 				}
@@ -519,6 +671,11 @@ int FS_FOpenFile(const char *name, fileHandle_t *f, qboolean gamedir_only)
 	fs_fileInPath[0] = 0;
 	fs_fileInPack = false;
 
+	if (!gamedir_only)
+	{
+		Q_strlcpy(miss, handle->name, MAX_QPATH);
+	}
+
 	if (fs_debug->value)
 	{
 		Com_Printf("FS_FOpenFile: couldn't find '%s'.\n", handle->name);
@@ -530,6 +687,92 @@ int FS_FOpenFile(const char *name, fileHandle_t *f, qboolean gamedir_only)
 	return -1;
 }
 
+#ifdef ZIP
+/*
+ * Inflates a compressed PK3 member. Input comes straight from the mapping
+ * when the pack is mapped, else from the shared stream.
+ */
+static int FS_ReadInflate(fsHandle_t *handle, byte *buffer, int size)
+{
+	fsInflate_t *z = handle->inflate;
+	fsPack_t *pack = handle->pack;
+	int count;
+	int status;
+
+	z->stream.next_out = buffer;
+	z->stream.avail_out = size;
+
+	while (z->stream.avail_out > 0)
+	{
+		if ((z->stream.avail_in == 0) && (handle->remaining > 0))
+		{
+			if (pack->map && (handle->position + handle->remaining <= pack->mapSize))
+			{
+				count = handle->remaining;
+				z->stream.next_in = pack->map + handle->position;
+			}
+			else
+			{
+				count = (handle->remaining < ZIP_BUFSIZE) ? handle->remaining : ZIP_BUFSIZE;
+				fseek(handle->file, handle->position, SEEK_SET);
+				count = fread(z->buffer, 1, count, handle->file);
+
+				if (count <= 0)
+				{
+					return -1;
+				}
+
+				z->stream.next_in = z->buffer;
+			}
+
+			z->stream.avail_in = count;
+			handle->position += count;
+			handle->remaining -= count;
+		}
+
+		status = inflate(&z->stream, Z_SYNC_FLUSH);
+
+		if ((status == Z_STREAM_END) ||
+		    ((status == Z_BUF_ERROR) && (handle->remaining == 0)))
+		{
+			break;
+		}
+
+		if (status != Z_OK)
+		{
+			return -1;
+		}
+	}
+
+	return size - z->stream.avail_out;
+}
+#endif
+
+/*
+ * Reads at most size bytes from an open handle.
+ */
+static int FS_ReadHandle(fsHandle_t *handle, byte *buffer, int size)
+{
+	int r;
+
+	#ifdef ZIP
+	if (handle->inflate)
+	{
+		return FS_ReadInflate(handle, buffer, size);
+	}
+	#endif
+
+	if (handle->pack)
+	{
+		fseek(handle->file, handle->position, SEEK_SET);
+		r = fread(buffer, 1, size, handle->file);
+		handle->position += r;
+		return r;
+	}
+
+	return fread(buffer, 1, size, handle->file);
+}
+
 /*
  * Properly handles partial reads.
  */
@@ -551,15 +794,8 @@ int FS_Read(void *buffer, int size, fileHandle_t f)
 	{
 		if (handle->file)
 		{
-			r = fread(buf, 1, remaining, handle->file);
-		}
-		#ifdef ZIP
-		else
-		if (handle->zip)
-		{
-			r = unzReadCurrentFile(handle->zip, buf, remaining);
+			r = FS_ReadHandle(handle, buf, remaining);
 		}
-		#endif
 		else
 		{
 			return 0;
@@ -623,15 +859,8 @@ int FS_FRead(void *buffer, int size, int count, fileHandle_t f)
 		{
 			if (handle->file)
 			{
-				r = fread(buf, 1, remaining, handle->file);
-			}
-			#ifdef ZIP
-			else
-			if (handle->zip)
-			{
-				r = unzReadCurrentFile(handle->zip, buf, remaining);
+				r = FS_ReadHandle(handle, buf, remaining);
 			}
-			#endif
 			else
 			{
 				return 0;
@@ -669,16 +898,420 @@ int FS_FRead(void *buffer, int size, int count, fileHandle_t f)
 }
 
 /*
- * Filename are reletive to the quake search path. A null buffer will just
- * return the file length without loading.
+ * Returns the mapped contents of an opened PAK member, or NULL if the pack is
+ * not mapped.
  */
-int FS_LoadFile(char *path, void **buffer)
+static byte* FS_MappedData(fsHandle_t *handle, int size)
+{
+	fsPack_t *pack = handle->pack;
+
+	if ((pack == NULL) || (pack->map == NULL) ||
+	    (handle->position + size > pack->mapSize))
+	{
+		return NULL;
+	}
+
+	#ifdef ZIP
+	if (handle->inflate)
+	{
+		return NULL;
+	}
+	#endif
+
+	return pack->map + handle->position;
+}
+
+static void FS_ReleasePrefetch(fsPrefetch_t *entry)
+{
+	if (entry->done)
+	{
+		Sys_DestroySemaphore(entry->done);
+	}
+
+	#ifdef ZIP
+	if (entry->handle.inflate)
+	{
+		entry->handle.inflate->next = fs_inflatePool;
+		fs_inflatePool = entry->handle.inflate;
+	}
+	#endif
+
+	if (entry->buffer && !entry->claimed)
+	{
+		Z_Free(entry->buffer);
+	}
+
+	memset(entry, 0, sizeof(*entry));
+}
+
+/*
+ * Reads one queued file. Runs in the prefetch thread, which has its own
+ * stream for every pack and must not touch the zone or the search path.
+ */
+static void FS_PrefetchFile(fsPrefetch_t *entry)
+{
+	fsHandle_t *handle = &entry->handle;
+	fsPack_t *pack = handle->pack;
+	volatile byte touch;
+	byte *data;
+	int total;
+	int r;
+
+	/* Mapped members only need their pages faulted in. */
+	if (entry->buffer == NULL)
+	{
+		data = pack->map + handle->position;
+
+		for (total = 0; total < entry->size; total += PREFETCH_PAGE)
+		{
+			touch = data[total];
+		}
+
+		(void)touch;
+		return;
+	}
+
+	if (pack)
+	{
+		if (pack->prefetch == NULL)
+		{
+			pack->prefetch = fopen(pack->name, "rb");
+		}
+
+		handle->file = pack->prefetch;
+	}
+
+	if (handle->file == NULL)
+	{
+		entry->failed = true;
+		return;
+	}
+
+	for (total = 0; total < entry->size; total += r)
+	{
+		r = FS_ReadHandle(handle, entry->buffer + total, entry->size - total);
+
+		if (r <= 0)
+		{
+			entry->failed = true;
+			break;
+		}
+	}
+
+	if (pack == NULL)
+	{
+		fclose(handle->file);
+	}
+
+	handle->file = NULL;
+}
+
+static int FS_PrefetchThread(void *data)
+{
+	int i, n;
+
+	for (i = 0; ; i++)
+	{
+		Sys_SemaphoreWait(fs_prefetchQueued);
+
+		/* Every started file posts once, FS_EndPrefetch posts once more
+		   with -1 as the next entry. */
+		n = fs_prefetchOrder[i];
+
+		if (n < 0)
+		{
+			break;
+		}
+
+		FS_PrefetchFile(&fs_prefetch[n]);
+		Sys_SemaphorePost(fs_prefetch[n].done);
+	}
+
+	return 0;
+}
+
+/*
+ * Opens queued files and hands them to the thread, in queue order, as
+ * long as the window has room. Only a few handles and buffers are held
+ * at once, files left outside when they are asked for load normally.
+ */
+static void FS_FillPrefetch()
+{
+	fsPrefetch_t *entry;
+	fileHandle_t f;
+	qboolean mapped;
+	int size;
+
+	while (fs_nextPrefetch < fs_numPrefetch)
+	{
+		entry = &fs_prefetch[fs_nextPrefetch];
+
+		if (entry->claimed)
+		{
+			fs_nextPrefetch++;
+			continue;
+		}
+
+		if (fs_prefetchOpen >= PREFETCH_WINDOW)
+		{
+			return;
+		}
+
+		/* Still too big from the last try, don't reopen it. */
+		if (entry->waiting && (fs_prefetchOpen > 0) &&
+			(fs_prefetchBytes + entry->size > PREFETCH_BYTES))
+		{
+			return;
+		}
+
+		size = FS_FOpenFile(entry->name, &f, false);
+
+		if (size <= 0)
+		{
+			if (f)
+			{
+				FS_FCloseFile(f);
+			}
+
+			entry->claimed = true;
+			fs_nextPrefetch++;
+			continue;
+		}
+
+		mapped = FS_MappedData(FS_GetFileByHandle(f), size) != NULL;
+
+		/* A file bigger than the whole window still goes alone. */
+		if (!mapped && (fs_prefetchOpen > 0) &&
+			(fs_prefetchBytes + size > PREFETCH_BYTES))
+		{
+			FS_FCloseFile(f);
+			entry->size = size;
+			entry->waiting = true;
+			return;
+		}
+
+		entry->done = Sys_CreateSemaphore(0);
+
+		if (entry->done == NULL)
+		{
+			FS_FCloseFile(f);
+			entry->claimed = true;
+			fs_nextPrefetch++;
+			continue;
+		}
+
+		/* Move the handle out of the table, the thread owns it now. */
+		entry->handle = *FS_GetFileByHandle(f);
+		memset(FS_GetFileByHandle(f), 0, sizeof(fsHandle_t));
+		entry->size = size;
+		entry->waiting = false;
+
+		if (mapped)
+		{
+			entry->buffer = NULL;
+		}
+		else
+		{
+			entry->buffer = Z_Malloc(size);
+			fs_prefetchBytes += size;
+		}
+
+		entry->started = true;
+		fs_prefetchOpen++;
+		fs_nextPrefetch++;
+
+		fs_prefetchOrder[fs_numPrefetchOrder++] = entry - fs_prefetch;
+		Sys_SemaphorePost(fs_prefetchQueued);
+	}
+}
+
+/*
+ * Starts a new batch of prefetched files. Files queued with FS_Prefetch()
+ * are read by a background thread while the caller keeps loading, and
+ * are handed over by FS_LoadFile() once the caller gets to them.
+ */
+void FS_BeginPrefetch()
+{
+	FS_EndPrefetch();
+
+	if (!fs_prefetch_threaded->value)
+	{
+		return;
+	}
+
+	fs_numPrefetch = 0;
+	fs_usedPrefetch = 0;
+	fs_numPrefetchOrder = 0;
+	fs_nextPrefetch = 0;
+	fs_prefetchOpen = 0;
+	fs_prefetchBytes = 0;
+	fs_prefetchQueued = Sys_CreateSemaphore(0);
+
+	if (fs_prefetchQueued == NULL)
+	{
+		return;
+	}
+
+	fs_prefetchThread = Sys_CreateThread(FS_PrefetchThread, NULL);
+
+	if (fs_prefetchThread == NULL)
+	{
+		Sys_DestroySemaphore(fs_prefetchQueued);
+		fs_prefetchQueued = NULL;
+	}
+}
+
+/*
+ * Stops the prefetch thread and drops the files nobody asked for.
+ */
+void FS_EndPrefetch()
+{
+	fsSearchPath_t *search;
+	int i;
+
+	if (fs_prefetchThread == NULL)
+	{
+		return;
+	}
+
+	fs_prefetchOrder[fs_numPrefetchOrder] = -1;
+	Sys_SemaphorePost(fs_prefetchQueued);
+	Sys_WaitThread(fs_prefetchThread);
+	Sys_DestroySemaphore(fs_prefetchQueued);
+	fs_prefetchThread = NULL;
+	fs_prefetchQueued = NULL;
+
+	for (i = 0; i < fs_numPrefetch; i++)
+	{
+		FS_ReleasePrefetch(&fs_prefetch[i]);
+	}
+
+	for (search = fs_searchPaths; search; search = search->next)
+	{
+		if (search->pack && search->pack->prefetch)
+		{
+			fclose(search->pack->prefetch);
+			search->pack->prefetch = NULL;
+		}
+	}
+
+	FS_DPrintf("FS_EndPrefetch: %i of %i prefetched files used.\n",
+		fs_usedPrefetch, fs_numPrefetch);
+
+	fs_numPrefetch = 0;
+	fs_numPrefetchOrder = 0;
+	fs_nextPrefetch = 0;
+	fs_prefetchOpen = 0;
+	fs_prefetchBytes = 0;
+}
+
+/*
+ * Queues a file for the prefetch thread. Does nothing outside of a batch
+ * or for files already queued. Missing files are dropped once the window
+ * gets to them.
+ */
+void FS_Prefetch(const char *name)
+{
+	int i;
+
+	if ((fs_prefetchThread == NULL) || (fs_numPrefetch == MAX_PREFETCH))
+	{
+		return;
+	}
+
+	for (i = 0; i < fs_numPrefetch; i++)
+	{
+		if (Q_stricmp(fs_prefetch[i].name, (char *)name) == 0)
+		{
+			return;
+		}
+	}
+
+	Q_strlcpy(fs_prefetch[fs_numPrefetch].name, name, sizeof(fs_prefetch[0].name));
+	fs_numPrefetch++;
+
+	FS_FillPrefetch();
+}
+
+/*
+ * Hands over a prefetched file, waiting for the thread if it is still
+ * reading it. Returns -1 if the file has to be loaded the normal way.
+ */
+static int FS_ClaimPrefetch(const char *name, void **buffer)
+{
+	fsPrefetch_t *entry;
+	int i;
+
+	for (i = 0; i < fs_numPrefetch; i++)
+	{
+		entry = &fs_prefetch[i];
+
+		if (entry->claimed || (Q_stricmp(entry->name, (char *)name) != 0))
+		{
+			continue;
+		}
+
+		entry->claimed = true;
+
+		/* Not reached by the window yet. */
+		if (!entry->started)
+		{
+			return -1;
+		}
+
+		Sys_SemaphoreWait(entry->done);
+
+		fs_prefetchOpen--;
+
+		if (entry->buffer)
+		{
+			fs_prefetchBytes -= entry->size;
+		}
+
+		FS_FillPrefetch();
+
+		if (entry->failed)
+		{
+			Z_Free(entry->buffer);
+			entry->buffer = NULL;
+			return -1;
+		}
+
+		fs_usedPrefetch++;
+
+		/* Mapped data is resident now, load it the usual way. */
+		if (entry->buffer == NULL)
+		{
+			return -1;
+		}
+
+		*buffer = entry->buffer;
+
+		return entry->size;
+	}
+
+	return -1;
+}
+
+static int FS_LoadFileEx(char *path, void **buffer, qboolean view)
 {
 	byte *buf; /* Buffer. */
+	byte *data; /* Mapped data. */
 	int size; /* File size. */
 	fileHandle_t f; /* File handle. */
 
 	buf = NULL;
+
+	if (fs_prefetchThread && buffer)
+	{
+		size = FS_ClaimPrefetch(path, buffer);
+
+		if (size >= 0)
+		{
+			return size;
+		}
+	}
+
 	size = FS_FOpenFile(path, &f, false);
 
 	if (size <= 0)
@@ -697,26 +1330,122 @@ int FS_LoadFile(char *path, void **buffer)
 		return size;
 	}
 
+	data = FS_MappedData(FS_GetFileByHandle(f), size);
+
+	/* Views must stay aligned, some targets fault on unaligned loads. */
+	if (view && data && (((size_t)data & 3) == 0))
+	{
+		*buffer = data;
+		FS_FCloseFile(f);
+		return size;
+	}
+
 	buf = Z_Malloc(size);
 	*buffer = buf;
 
-	FS_Read(buf, size, f);
+	if (data)
+	{
+		memcpy(buf, data, size);
+	}
+	else
+	{
+		FS_Read(buf, size, f);
+	}
+
 	FS_FCloseFile(f);
 
 	return size;
 }
 
+/*
+ * Filename are reletive to the quake search path. A null buffer will just
+ * return the file length without loading.
+ */
+int FS_LoadFile(char *path, void **buffer)
+{
+	return FS_LoadFileEx(path, buffer, false);
+}
+
+/*
+ * Same as FS_LoadFile, but files from a mapped PAK are returned in place
+ * instead of being copied. The buffer is read only.
+ */
+int FS_LoadFileView(char *path, void **buffer)
+{
+	return FS_LoadFileEx(path, buffer, true);
+}
+
 void FS_FreeFile(void *buffer)
 {
+	fsSearchPath_t *search;
+	fsPack_t *pack;
+
 	if (buffer == NULL)
 	{
 		FS_DPrintf("FS_FreeFile: NULL buffer.\n");
 		return;
 	}
 
+	/* Views into a mapped PAK are owned by the pack. */
+	for (search = fs_searchPaths; search; search = search->next)
+	{
+		pack = search->pack;
+
+		if (pack && pack->map && ((byte *)buffer >= pack->map) &&
+		    ((byte *)buffer < pack->map + pack->mapSize))
+		{
+			return;
+		}
+	}
+
 	Z_Free(buffer);
 }
 
+/*
+ * Forgets every cached failed lookup. Must be called when the search path
+ * changes or when a file that might have been searched for is written.
+ */
+void FS_FlushFileCache()
+{
+	int i;
+
+	for (i = 0; i < MAX_MISSCACHE; i++)
+	{
+		fs_missCache[i][0] = '\0';
+	}
+}
+
+/*
+ * Builds the name hash of a pack. The chains are filled backwards so the
+ * first of duplicated names is found first, like a linear search would.
+ */
+static void FS_HashPack(fsPack_t *pack)
+{
+	int i;
+	int bucket;
+	int size = 1;
+
+	while (size < pack->numFiles)
+	{
+		size <<= 1;
+	}
+
+	pack->hashMask = size - 1;
+	pack->hashHeads = Z_Malloc(size * sizeof(int));
+
+	for (i = 0; i < size; i++)
+	{
+		pack->hashHeads[i] = -1;
+	}
+
+	for (i = pack->numFiles - 1; i >= 0; i--)
+	{
+		bucket = Com_HashKey(pack->files[i].name) & pack->hashMask;
+		pack->files[i].hashNext = pack->hashHeads[bucket];
+		pack->hashHeads[bucket] = i;
+	}
+}
+
 /*
  * Takes an explicit (not game tree related) path to a pak file.
  *
@@ -779,11 +1508,19 @@ fsPack_t* FS_LoadPAK(const char *packPath)
 	Q_strlcpy(pack->name, packPath, sizeof(pack->name));
 	pack->pak = handle;
 	#ifdef ZIP
-	pack->pk3 = NULL;
+	pack->pk3 = false;
 	#endif
 	pack->numFiles = numFiles;
 	pack->files = files;
 
+	/* Map the whole PAK once, members are then read without copies. */
+	if (fs_mmap->value)
+	{
+		pack->mapSize = FS_FileLength(handle);
+		pack->map = Sys_MapFile(handle, pack->mapSize);
+	}
+	FS_HashPack(pack);
+
 	Com_Printf("Added packfile '%s' (%i files).\n", pack, numFiles);
 
 	return pack;
@@ -795,64 +1532,141 @@ fsPack_t* FS_LoadPAK(const char *packPath)
  *
  * Loads the header and directory, adding the files at the beginning of the list
  * so they override previous pack files.
+ *
+ * The zip central directory is parsed here once, members are then read from
+ * the shared stream without going through it again.
  */
 fsPack_t* FS_LoadPK3(const char *packPath)
 {
-	char fileName[MAX_QPATH]; /* File name. */
-	int i = 0; /* Loop counter. */
+	byte *tail; /* End of the file, holds the end of central directory. */
+	byte *dir; /* Central directory. */
+	byte *entry; /* Current central directory entry. */
+	int length; /* File length. */
+	int tailSize; /* Size of tail. */
+	int dirOffset; /* Central directory offset. */
+	int dirSize; /* Central directory size. */
+	int i, j; /* Loop counters. */
 	int numFiles; /* Number of files in PK3. */
-	int status; /* Error indicator. */
+	int flags, method; /* Zip entry flags and compression method. */
+	int nameLength; /* Zip entry name length. */
 	fsPackFile_t *files; /* List of files in PK3. */
 	fsPack_t *pack; /* PK3 file. */
-	unzFile *handle; /* Zip file handle. */
-	unz_file_info info; /* Zip file info. */
-	unz_global_info global; /* Zip file global info. */
+	FILE *handle; /* File handle. */
 
-	handle = unzOpen(packPath);
+	handle = fopen(packPath, "rb");
 
 	if (handle == NULL)
 	{
 		return NULL;
 	}
 
-	if (unzGetGlobalInfo(handle, &global) != UNZ_OK)
+	/* The end record is the last thing in the file, only followed by a
+	   comment of up to 64k. */
+	length = FS_FileLength(handle);
+	tailSize = (length < ZIP_END_SIZE + ZIP_MAX_COMMENT) ? length : ZIP_END_SIZE + ZIP_MAX_COMMENT;
+	tail = Z_Malloc(tailSize);
+
+	fseek(handle, length - tailSize, SEEK_SET);
+	fread(tail, 1, tailSize, handle);
+
+	for (i = tailSize - ZIP_END_SIZE; i >= 0; i--)
+	{
+		if (FS_ZipLong(tail + i) == ZIP_END_SIG)
+		{
+			break;
+		}
+	}
+
+	if (i < 0)
 	{
-		unzClose(handle);
+		Z_Free(tail);
+		fclose(handle);
 		Com_Error(ERR_FATAL, "FS_LoadPK3: '%s' is not a pack file", packPath);
+		return NULL;
 	}
 
-	numFiles = global.number_entry;
+	numFiles = FS_ZipShort(tail + i + 10);
+	dirSize = FS_ZipLong(tail + i + 12);
+	dirOffset = FS_ZipLong(tail + i + 16);
+	Z_Free(tail);
 
 	if ((numFiles > MAX_FILES_IN_PACK) || (numFiles == 0))
 	{
-		unzClose(handle);
+		fclose(handle);
 		Com_Error(ERR_FATAL, "FS_LoadPK3: '%s' has %i files",
 			packPath, numFiles);
+		return NULL;
+	}
+
+	if ((dirOffset < 0) || (dirSize < 0) || (dirOffset + dirSize > length))
+	{
+		fclose(handle);
+		Com_Error(ERR_FATAL, "FS_LoadPK3: '%s' is not a pack file", packPath);
+		return NULL;
 	}
 
+	dir = Z_Malloc(dirSize);
+	fseek(handle, dirOffset, SEEK_SET);
+	fread(dir, 1, dirSize, handle);
+
 	files = Z_Malloc(numFiles * sizeof(fsPackFile_t));
 
 	/* Parse the directory. */
-	status = unzGoToFirstFile(handle);
-
-	while (status == UNZ_OK)
+	for (i = 0, entry = dir; i < numFiles; i++)
 	{
-		fileName[0] = '\0';
-		unzGetCurrentFileInfo(handle, &info, fileName, MAX_QPATH,
-			NULL, 0, NULL, 0);
-		Q_strlcpy(files[i].name, fileName, sizeof(files[i].name));
-		files[i].offset = -1; /* Not used in ZIP files */
-		files[i].size = info.uncompressed_size;
-		i++;
-		status = unzGoToNextFile(handle);
+		if ((entry + ZIP_CENTRAL_SIZE > dir + dirSize) ||
+		    (FS_ZipLong(entry) != ZIP_CENTRAL_SIG))
+		{
+			Z_Free(dir);
+			Z_Free(files);
+			fclose(handle);
+			Com_Error(ERR_FATAL, "FS_LoadPK3: '%s' has a bad directory", packPath);
+			return NULL;
+		}
+
+		flags = FS_ZipShort(entry + 8);
+		method = FS_ZipShort(entry + 10);
+		nameLength = FS_ZipShort(entry + 28);
+
+		for (j = 0; (j < nameLength) && (j < MAX_QPATH - 1); j++)
+		{
+			files[i].name[j] = entry[ZIP_CENTRAL_SIZE + j];
+		}
+
+		files[i].name[j] = '\0';
+		files[i].offset = -1;
+		files[i].compressedSize = FS_ZipLong(entry + 20);
+		files[i].size = FS_ZipLong(entry + 24);
+		files[i].localOffset = FS_ZipLong(entry + 42);
+		files[i].deflated = (method == Z_DEFLATED);
+
+		/* Only stored and deflated entries can be read, hide the rest. */
+		if ((flags & 1) || ((method != 0) && (method != Z_DEFLATED)))
+		{
+			Com_Printf("FS_LoadPK3: '%s' in '%s' is encrypted or uses an unsupported compression.\n",
+				files[i].name, packPath);
+			files[i].name[0] = '\0';
+		}
+
+		entry += ZIP_CENTRAL_SIZE + nameLength + FS_ZipShort(entry + 30) + FS_ZipShort(entry + 32);
 	}
 
+	Z_Free(dir);
+
 	pack = Z_Malloc(sizeof(fsPack_t));
 	Q_strlcpy(pack->name, packPath, sizeof(pack->name));
-	pack->pak = NULL;
-	pack->pk3 = handle;
+	pack->pak = handle;
+	pack->pk3 = true;
 	pack->numFiles = numFiles;
 	pack->files = files;
+	FS_HashPack(pack);
+
+	/* Stored members are used in place, deflated ones inflate from it. */
+	if (fs_mmap->value)
+	{
+		pack->mapSize = length;
+		pack->map = Sys_MapFile(handle, pack->mapSize);
+	}
 
 	Com_Printf("Added packfile '%s' (%i files).\n", pack, numFiles);
 
@@ -882,6 +1696,7 @@ static void FS_AddGameDirectory(const char *dir)
 	Q_strlcpy(search->path, dir, sizeof(search->path));
 	search->next = fs_searchPaths;
 	fs_searchPaths = search;
+	FS_FlushFileCache();
 
 	/* Add numbered pack files in sequence. */
 	for (i = 0; i < (int)(sizeof(fs_packtypes) / sizeof(fs_packtypes[0])); i++)
@@ -1055,7 +1870,8 @@ void FS_Path_f()
 	{
 		if (search->pack != NULL)
 		{
-			Com_Printf("%s (%i files)\n", search->pack->name, search->pack->numFiles);
+			Com_Printf("%s (%i files%s)\n", search->pack->name, search->pack->numFiles,
+				search->pack->map ? ", mapped" : "");
 			totalFiles += search->pack->numFiles;
 		}
 		else
@@ -1068,11 +1884,7 @@ void FS_Path_f()
 
 	for (i = 0, handle = fs_handles; i < MAX_HANDLES; i++, handle++)
 	{
-		if ((handle->file != NULL)
-		    #ifdef ZIP
-		    || (handle->zip != NULL)
-		    #endif
-		    )
+		if (handle->file != NULL)
 		{
 			Com_Printf("Handle %i: '%s'.\n", i + 1, handle->name);
 		}
@@ -1105,23 +1917,33 @@ void FS_SetGamedir(char *dir)
 		return;
 	}
 
+	FS_EndPrefetch();
+
 	/* Free up any current game dir info. */
 	while (fs_searchPaths != fs_baseSearchPaths)
 	{
 		if (fs_searchPaths->pack)
 		{
-			if (fs_searchPaths->pack->pak)
+			/* Close handles still reading the shared PAK stream. */
+			for (i = 0; i < MAX_HANDLES; i++)
 			{
-				fclose(fs_searchPaths->pack->pak);
+				if (fs_handles[i].pack == fs_searchPaths->pack)
+				{
+					FS_FCloseFile(i + 1);
+				}
 			}
 
-			#ifdef ZIP
-			if (fs_searchPaths->pack->pk3)
+			if (fs_searchPaths->pack->map)
 			{
-				unzClose(fs_searchPaths->pack->pk3);
+				Sys_UnmapFile(fs_searchPaths->pack->map, fs_searchPaths->pack->mapSize);
 			}
-			#endif
 
+			if (fs_searchPaths->pack->pak)
+			{
+				fclose(fs_searchPaths->pack->pak);
+			}
+
+			Z_Free(fs_searchPaths->pack->hashHeads);
 			Z_Free(fs_searchPaths->pack->files);
 			Z_Free(fs_searchPaths->pack);
 		}
@@ -1131,15 +1953,13 @@ void FS_SetGamedir(char *dir)
 		fs_searchPaths = next;
 	}
 
+	FS_FlushFileCache();
+
 	/* Close open files for game dir. */
 	for (i = 0; i < MAX_HANDLES; i++)
 	{
 		if (strstr(fs_handles[i].name, dir) &&
-		    ((fs_handles[i].file != NULL)
-		     #ifdef ZIP
-		     || (fs_handles[i].zip != NULL)
-		     #endif
-		    ))
+		    (fs_handles[i].file != NULL))
 		{
 			FS_FCloseFile(i);
 		}
@@ -1544,6 +2364,10 @@ void FS_InitFilesystem()
 	/* Debug flag. */
 	fs_debug = Cvar_Get("fs_debug", "0", 0);
 
+	/* Map PAK files into memory when they are added. */
+	fs_mmap = Cvar_Get("fs_mmap", "1", 0);
+	fs_prefetch_threaded = Cvar_Get("fs_prefetch", "1", 0);
+
 	/* Game directory. */
 	fs_gamedirvar = Cvar_Get("game", "", CVAR_LATCH | CVAR_SERVERINFO);
 
@@ -27,9 +27,12 @@
 #include "common/common.h"
 #include "common/zone.h"
 
+#ifndef DEDICATED_ONLY
 #include "SDL/SDLWrapper.h"
+#endif
 
 #include <setjmp.h>
+#include <stdbool.h>
 
 FILE *log_stats_file;
 cvar_t *host_speeds;
@@ -45,7 +48,6 @@ cvar_t *dedicated;
 
 extern cvar_t *consoleLogFile;
 extern jmp_buf abortframe; /* an ERR_DROP occured, exit the entire frame */
-extern zhead_t z_chain;
 
 static byte chktbl[1024] =
 {
@@ -189,11 +191,11 @@ static void Qcommon_Init(int argc, char **argv)
 		Sys_Error("Error during initialization");
 	}
 
-	z_chain.next = z_chain.prev = &z_chain;
-
+	#ifndef DEDICATED_ONLY
 	extern bool IN_processEvent(SDL_Event *event);
 	sdlwInitialize(IN_processEvent, 0);
 	sdlwEnableDefaultEventManagement(false);
+	#endif
 
 	/* prepare enough of the subsystems to handle
 	   cvar and command buffer management */
@@ -227,6 +229,7 @@ static void Qcommon_Init(int argc, char **argv)
 
 	/* init commands and vars */
 	Cmd_AddCommand("z_stats", Z_Stats_f);
+	Cmd_AddCommand("sys_framestats", Sys_FrameStats_f);
 	Cmd_AddCommand("error", Com_Error_f);
 
 	host_speeds = Cvar_Get("host_speeds", "0", 0);
@@ -464,17 +467,29 @@ void Qcommon_Run(int argc, char **argv)
 	/* The legendary Quake II mainloop */
 	while (1)
 	{
+		#ifndef DEDICATED_ONLY
 		if (sdlwIsExitRequested())
 			Com_Quit();
+		#endif
+
+		/* sleep until the next client or server frame is due,
+		   but run at least a millisecond of game time per frame */
+		int delay = SV_FrameDelay();
+		#ifndef DEDICATED_ONLY
+		if (CL_FrameDelay() < delay)
+			delay = CL_FrameDelay();
+		#endif
+		if (delay < 1)
+			delay = 1;
+		Sys_WaitFrame(oldtime + 1, oldtime + delay);
 
 		/* find time spent rendering last frame */
-		int newtime, time;
-		do
+		int newtime = Sys_Milliseconds();
+		int time = newtime - oldtime;
+		if (time < 1)
 		{
-			newtime = Sys_Milliseconds();
-			time = newtime - oldtime;
+			continue;
 		}
-		while (time < 1);
 
 		Qcommon_Frame(time);
 		oldtime = newtime;
@@ -1104,6 +1104,19 @@ int Q_strlcat(char *dst, const char *src, int size)
 	return (d - dst) + Q_strlcpy(d, src, size);
 }
 
+unsigned Com_HashKey(const char *s)
+{
+	unsigned hash = 0;
+
+	while (*s)
+	{
+		hash = hash * 33 + tolower((unsigned char)*s);
+		s++;
+	}
+
+	return hash ^ (hash >> 16);
+}
+
 /*
  * =====================================================================
  *
@@ -241,6 +241,9 @@ char* Q_strlwr(char *s);
 int Q_strlcpy(char *dst, const char *src, int size);
 int Q_strlcat(char *dst, const char *src, int size);
 
+/* case insensitive string hash, mask the result with a power of two - 1 */
+unsigned Com_HashKey(const char *s);
+
 /* ============================================= */
 
 short BigShort(short l);
@@ -291,6 +294,7 @@ void* Hunk_Begin(int maxsize);
 void* Hunk_Alloc(int size);
 void Hunk_Free(void *buf);
 int Hunk_End(void);
+int Hunk_Faults(void); /* page faults taken by the last Hunk_Begin/Hunk_End */
 
 /* directory searching */
 #define SFF_ARCH 0x01
@@ -469,6 +473,13 @@ typedef struct
 	struct edict_s *ent; /* not set by CM_*() functions */
 } trace_t;
 
+/* one box of a batched trace */
+typedef struct
+{
+	vec3_t start, end;
+	vec3_t mins, maxs;
+} traceray_t;
+
 /* pmove_state_t is the information necessary for client side movement */
 /* prediction */
 typedef enum
@@ -19,7 +19,9 @@
  *
  * =======================================================================
  *
- * Zone malloc. It's just a normal malloc with tags.
+ * Zone malloc. Every tag gets its own arena: small blocks are carved out
+ * of large chunks and recycled through per size class free lists, bigger
+ * ones come from malloc. Freeing a tag releases its chunks in one go.
  *
  * =======================================================================
  */
@@ -28,75 +30,288 @@
 #include "common/zone.h"
 
 #define Z_MAGIC 0x1d1d
+#define Z_MAGIC_SLAB 0x1d1e
+#define Z_MAGIC_FREE 0x1d1f
+
+#define Z_MAX_ARENAS 32
+#define Z_CHUNK_SIZE 0x10000
+#define Z_GRANULARITY 16
+#define Z_MAX_SMALL 2048 /* Including the header. */
+#define Z_NUM_CLASSES 23
+
+typedef union zchunk_u
+{
+	union zchunk_u *next;
+	double align[2]; /* Keeps the blocks 16 byte aligned. */
+} zchunk_t;
+
+typedef struct
+{
+	qboolean used;
+	int tag;
+
+	zchunk_t *chunks; /* Small blocks are bumped out of the first one. */
+	int chunkUsed;
+	zhead_t *freeBlocks[Z_NUM_CLASSES];
+	zhead_t large; /* List of malloced blocks. */
+
+	int count, bytes, peak;
+	int numChunks, numLarge;
+} zarena_t;
+
+static const int z_classSizes[Z_NUM_CLASSES] = {
+	32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320,
+	384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048
+};
+
+static byte z_classForSize[Z_MAX_SMALL / Z_GRANULARITY + 1];
+static zarena_t z_arenas[Z_MAX_ARENAS];
+static zarena_t *z_lastArena;
 
-zhead_t z_chain;
 int z_count, z_bytes;
 
+static void Z_InitClasses(void)
+{
+	int i, c;
+
+	for (i = 0, c = 0; i <= Z_MAX_SMALL / Z_GRANULARITY; i++)
+	{
+		while (z_classSizes[c] < i * Z_GRANULARITY)
+		{
+			c++;
+		}
+
+		z_classForSize[i] = c;
+	}
+}
+
+static zarena_t* Z_ArenaForTag(int tag, qboolean create)
+{
+	zarena_t *arena;
+	int i;
+
+	if (z_lastArena && (z_lastArena->tag == tag))
+	{
+		return z_lastArena;
+	}
+
+	for (i = 0, arena = z_arenas; i < Z_MAX_ARENAS; i++, arena++)
+	{
+		if (arena->used && (arena->tag == tag))
+		{
+			z_lastArena = arena;
+			return arena;
+		}
+	}
+
+	if (!create)
+	{
+		return NULL;
+	}
+
+	for (i = 0, arena = z_arenas; i < Z_MAX_ARENAS; i++, arena++)
+	{
+		if (!arena->used)
+		{
+			memset(arena, 0, sizeof(*arena));
+			arena->used = true;
+			arena->tag = tag;
+			arena->chunkUsed = Z_CHUNK_SIZE;
+			arena->large.next = arena->large.prev = &arena->large;
+
+			if (z_classForSize[Z_MAX_SMALL / Z_GRANULARITY] == 0)
+			{
+				Z_InitClasses();
+			}
+
+			z_lastArena = arena;
+			return arena;
+		}
+	}
+
+	Com_Error(ERR_FATAL, "Z_TagMalloc: too many tags");
+	return NULL;
+}
+
 void Z_Free(void *ptr)
 {
+	zarena_t *arena;
 	zhead_t *z;
+	int c;
 
 	z = ((zhead_t *)ptr) - 1;
 
-	if (z->magic != Z_MAGIC)
+	if ((z->magic != Z_MAGIC) && (z->magic != Z_MAGIC_SLAB))
 	{
 		printf("free: %p failed\n", ptr);
 		abort();
 		Com_Error(ERR_FATAL, "Z_Free: bad magic");
 	}
 
-	z->prev->next = z->next;
-	z->next->prev = z->prev;
+	arena = Z_ArenaForTag(z->tag, false);
+
+	if (arena == NULL)
+	{
+		Com_Error(ERR_FATAL, "Z_Free: no arena for tag %i", z->tag);
+	}
 
 	z_count--;
 	z_bytes -= z->size;
-	free(z);
+	arena->count--;
+	arena->bytes -= z->size;
+
+	if (z->magic == Z_MAGIC)
+	{
+		z->prev->next = z->next;
+		z->next->prev = z->prev;
+		arena->numLarge--;
+		free(z);
+		return;
+	}
+
+	/* Back onto the free list of its size class. */
+	c = z_classForSize[(z->size + Z_GRANULARITY - 1) / Z_GRANULARITY];
+	z->magic = Z_MAGIC_FREE;
+	z->next = arena->freeBlocks[c];
+	arena->freeBlocks[c] = z;
 }
 
 void Z_Stats_f(void)
 {
+	zarena_t *arena;
+	int i;
+
 	Com_Printf("%i bytes in %i blocks\n", z_bytes, z_count);
+
+	for (i = 0, arena = z_arenas; i < Z_MAX_ARENAS; i++, arena++)
+	{
+		if (!arena->used)
+		{
+			continue;
+		}
+
+		Com_Printf("tag %4i: %8i bytes in %6i blocks, peak %8i, %3i chunks, %4i large\n",
+			arena->tag, arena->bytes, arena->count, arena->peak,
+			arena->numChunks, arena->numLarge);
+	}
 }
 
+/*
+ * Releases every block of a tag. Small blocks go away with their chunks,
+ * only the big ones have to be freed one by one.
+ */
 void Z_FreeTags(int tag)
 {
+	zarena_t *arena;
+	zchunk_t *chunk, *nextChunk;
 	zhead_t *z, *next;
 
-	for (z = z_chain.next; z != &z_chain; z = next)
+	arena = Z_ArenaForTag(tag, false);
+
+	if (arena == NULL)
+	{
+		return;
+	}
+
+	for (z = arena->large.next; z != &arena->large; z = next)
 	{
 		next = z->next;
+		free(z);
+	}
 
-		if (z->tag == tag)
-		{
-			Z_Free((void *)(z + 1));
-		}
+	for (chunk = arena->chunks; chunk; chunk = nextChunk)
+	{
+		nextChunk = chunk->next;
+		free(chunk);
+	}
+
+	z_count -= arena->count;
+	z_bytes -= arena->bytes;
+
+	if (z_lastArena == arena)
+	{
+		z_lastArena = NULL;
 	}
+
+	memset(arena, 0, sizeof(*arena));
 }
 
 void* Z_TagMalloc(int size, int tag)
 {
+	zarena_t *arena;
+	zchunk_t *chunk;
 	zhead_t *z;
+	int c;
 
 	size = size + sizeof(zhead_t);
-	z = malloc(size);
+	arena = Z_ArenaForTag(tag, true);
 
-	if (!z)
+	if (size > Z_MAX_SMALL)
 	{
-		Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes", size);
+		z = calloc(1, size);
+
+		if (!z)
+		{
+			Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes", size);
+		}
+
+		z->magic = Z_MAGIC;
+		z->next = arena->large.next;
+		z->prev = &arena->large;
+		arena->large.next->prev = z;
+		arena->large.next = z;
+		arena->numLarge++;
+	}
+	else
+	{
+		c = z_classForSize[(size + Z_GRANULARITY - 1) / Z_GRANULARITY];
+		z = arena->freeBlocks[c];
+
+		if (z)
+		{
+			/* Recycled blocks are the only ones that need clearing. */
+			arena->freeBlocks[c] = z->next;
+			memset(z, 0, z_classSizes[c]);
+		}
+		else
+		{
+			if (arena->chunkUsed + z_classSizes[c] > Z_CHUNK_SIZE)
+			{
+				/* The tail of the old chunk is wasted, it is at most one block. */
+				chunk = calloc(1, sizeof(zchunk_t) + Z_CHUNK_SIZE);
+
+				if (!chunk)
+				{
+					Com_Error(ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes", size);
+				}
+
+				chunk->next = arena->chunks;
+				arena->chunks = chunk;
+				arena->chunkUsed = 0;
+				arena->numChunks++;
+			}
+
+			/* Fresh chunk memory is still zero. */
+			z = (zhead_t *)((byte *)(arena->chunks + 1) + arena->chunkUsed);
+			arena->chunkUsed += z_classSizes[c];
+		}
+
+		z->magic = Z_MAGIC_SLAB;
 	}
 
-	memset(z, 0, size);
 	z_count++;
 	z_bytes += size;
-	z->magic = Z_MAGIC;
+	arena->count++;
+	arena->bytes += size;
+
+	if (arena->bytes > arena->peak)
+	{
+		arena->peak = arena->bytes;
+	}
+
 	z->tag = tag;
 	z->size = size;
 
-	z->next = z_chain.next;
-	z->prev = &z_chain;
-	z_chain.next->prev = z;
-	z_chain.next = z;
-
 	return (void *)(z + 1);
 }
 
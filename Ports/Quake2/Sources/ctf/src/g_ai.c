@@ -1025,6 +1025,9 @@ void ai_run(edict_t *self, float dist)
 	vec3_t v_forward, v_right;
 	float left, center, right;
 	vec3_t left_target, right_target;
+	traceray_t rays[2];
+	trace_t sides[2];
+	int i;
 
 	/* if we're going to a combat point, just proceed */
 	if (self->monsterinfo.aiflags & AI_COMBAT_POINT)
@@ -1158,15 +1161,22 @@ void ai_run(edict_t *self, float dist)
 
 			VectorSet(v, d2, -16, 0);
 			G_ProjectSource(self->s.origin, v, v_forward, v_right, left_target);
-			tr = gi.trace(self->s.origin, self->mins, self->maxs, left_target,
-					self, MASK_PLAYERSOLID);
-			left = tr.fraction;
-
 			VectorSet(v, d2, 16, 0);
 			G_ProjectSource(self->s.origin, v, v_forward, v_right, right_target);
-			tr = gi.trace(self->s.origin, self->mins, self->maxs, right_target,
-					self, MASK_PLAYERSOLID);
-			right = tr.fraction;
+
+			/* probe both sides in one batch */
+			for (i = 0; i < 2; i++)
+			{
+				VectorCopy(self->s.origin, rays[i].start);
+				VectorCopy(self->mins, rays[i].mins);
+				VectorCopy(self->maxs, rays[i].maxs);
+			}
+
+			VectorCopy(left_target, rays[0].end);
+			VectorCopy(right_target, rays[1].end);
+			gi.tracebatch(rays, sides, 2, self, MASK_PLAYERSOLID);
+			left = sides[0].fraction;
+			right = sides[1].fraction;
 
 			center = (d1 * center) / d2;
 
@@ -213,6 +213,7 @@ void InitGame(void)
 	game.maxentities = maxentities->value;
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_InitFindIndex();
 	globals.max_edicts = game.maxentities;
 
 	/* initialize all clients for this game */
@@ -530,6 +531,7 @@ void ReadGame(char *filename)
 
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_InitFindIndex();
 
 	fread(&game, sizeof(game), 1, f);
 	game.clients = gi.TagMalloc(game.maxclients * sizeof(game.clients[0]), TAG_GAME);
@@ -789,4 +791,6 @@ void ReadLevel(char *filename)
 			}
 		}
 	}
+
+	G_RebuildFindIndex();
 }
@@ -556,6 +556,7 @@ void SpawnEntities(char *mapname, char *entities, char *spawnpoint)
 
 	memset(&level, 0, sizeof(level));
 	memset(g_edicts, 0, game.maxentities * sizeof(g_edicts[0]));
+	G_RebuildFindIndex();
 
 	strncpy(level.mapname, mapname, sizeof(level.mapname) - 1);
 	strncpy(game.spawnpoint, spawnpoint, sizeof(game.spawnpoint) - 1);
@@ -648,6 +649,7 @@ void SpawnEntities(char *mapname, char *entities, char *spawnpoint)
 	PlayerTrail_Init();
 
 	CTFSpawn();
+	G_RebuildFindIndex();
 }
 
 /* =================================================================== */
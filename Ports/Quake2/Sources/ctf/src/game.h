@@ -37,7 +37,7 @@
 #ifndef CTF_GAME_H
 #define CTF_GAME_H
 
-#define GAME_API_VERSION 3
+#define GAME_API_VERSION 4
 
 /* edict->svflags */
 #define SVF_NOCLIENT 0x00000001 /* don't send entity to clients, even if it has effects */
@@ -170,6 +170,10 @@ typedef struct
 
 	void (*AddCommandString)(char *text);
 	void (*DebugGraph)(float value, int color);
+	/* traces count boxes at once, same as calling trace for each.
+	   Kept last so older game DLLs still line up, new in version 4
+	   so these DLLs refuse to load into engines without it. */
+	void (*tracebatch)(traceray_t *rays, trace_t *traces, int count, edict_t *passent, int contentmask);
 } game_import_t;
 
 /* functions exported by the game subsystem */
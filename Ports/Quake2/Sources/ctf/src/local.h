@@ -612,6 +612,11 @@ void G_InitEdict(edict_t *e);
 edict_t* G_Spawn(void);
 void G_FreeEdict(edict_t *e);
 
+void G_InitFindIndex(void);
+void G_RebuildFindIndex(void);
+void G_FlushFindIndex(void);
+void G_IndexEdict(edict_t *ent);
+
 void G_TouchTriggers(edict_t *ent);
 void G_TouchSolids(edict_t *ent);
 
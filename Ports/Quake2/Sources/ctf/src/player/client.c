@@ -1127,6 +1127,7 @@ void PutClientInServer(edict_t *ent)
 	ent->viewheight = 22;
 	ent->inuse = true;
 	ent->classname = "player";
+	G_IndexEdict(ent);
 	ent->mass = 200;
 	ent->solid = SOLID_BBOX;
 	ent->deadflag = DEAD_NO;
@@ -1287,6 +1288,7 @@ void ClientBegin(edict_t *ent)
 		   ClientConnect() time */
 		G_InitEdict(ent);
 		ent->classname = "player";
+		G_IndexEdict(ent);
 		InitClientResp(ent->client);
 		PutClientInServer(ent);
 	}
@@ -1478,6 +1480,7 @@ void ClientDisconnect(edict_t *ent)
 	ent->solid = SOLID_NOT;
 	ent->inuse = false;
 	ent->classname = "disconnected";
+	G_IndexEdict(ent);
 	ent->client->pers.connected = false;
 
 	playernum = ent - g_edicts - 1;
@@ -74,6 +74,7 @@ void SP_FixCoopSpots(edict_t *self)
 			if ((!self->targetname) || (Q_stricmp(self->targetname, spot->targetname) != 0))
 			{
 				self->targetname = spot->targetname;
+				G_IndexEdict(self);
 			}
 
 			return;
@@ -1685,6 +1686,7 @@ void PutClientInServer(edict_t *ent)
 	ent->viewheight = 22;
 	ent->inuse = true;
 	ent->classname = "player";
+	G_IndexEdict(ent);
 	ent->mass = 200;
 	ent->solid = SOLID_BBOX;
 	ent->deadflag = DEAD_NO;
@@ -1868,6 +1870,7 @@ void ClientBegin(edict_t *ent)
 		   ClientConnect() time */
 		G_InitEdict(ent);
 		ent->classname = "player";
+		G_IndexEdict(ent);
 		InitClientResp(ent->client);
 		PutClientInServer(ent);
 	}
@@ -2104,6 +2107,7 @@ void ClientDisconnect(edict_t *ent)
 	ent->solid = SOLID_NOT;
 	ent->inuse = false;
 	ent->classname = "disconnected";
+	G_IndexEdict(ent);
 	ent->client->pers.connected = false;
 
 	playernum = ent - g_edicts - 1;
@@ -268,6 +268,7 @@ void InitGame(void)
 	game.maxentities = maxentities->value;
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_InitFindIndex();
 	globals.max_edicts = game.maxentities;
 
 	/* initialize all clients for this game */
@@ -885,6 +886,7 @@ void ReadGame(const char *filename)
 
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_InitFindIndex();
 
 	fread(&game, sizeof(game), 1, f);
 	game.clients = gi.TagMalloc(game.maxclients * sizeof(game.clients[0]),
@@ -1139,4 +1141,6 @@ void ReadLevel(const char *filename)
 			}
 		}
 	}
+
+	G_RebuildFindIndex();
 }
@@ -755,6 +755,7 @@ void SpawnEntities(const char *mapname, char *entities, const char *spawnpoint)
 
 	memset(&level, 0, sizeof(level));
 	memset(g_edicts, 0, game.maxentities * sizeof(g_edicts[0]));
+	G_RebuildFindIndex();
 
 	strncpy(level.mapname, mapname, sizeof(level.mapname) - 1);
 	strncpy(game.spawnpoint, spawnpoint, sizeof(game.spawnpoint) - 1);
@@ -912,6 +913,7 @@ void SpawnEntities(const char *mapname, char *entities, const char *spawnpoint)
 			DMGame.PostInitSetup();
 		}
 	}
+	G_RebuildFindIndex();
 }
 
 /* =================================================================== */
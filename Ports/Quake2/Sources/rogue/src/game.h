@@ -18,7 +18,7 @@
 #ifndef ROGUE_GAME_H
 #define ROGUE_GAME_H
 
-#define GAME_API_VERSION 3
+#define GAME_API_VERSION 4
 
 #define SVF_NOCLIENT 0x00000001 /* don't send entity to clients, even if it has effects */
 #define SVF_DEADMONSTER 0x00000002 /* treat as CONTENTS_DEADMONSTER for collision */
@@ -160,6 +160,10 @@ typedef struct
 	void (*AddCommandString)(char *text);
 
 	void (*DebugGraph)(float value, int color);
+	/* traces count boxes at once, same as calling trace for each.
+	   Kept last so older game DLLs still line up, new in version 4
+	   so these DLLs refuse to load into engines without it. */
+	void (*tracebatch)(traceray_t *rays, trace_t *traces, int count, edict_t *passent, int contentmask);
 } game_import_t;
 
 /* functions exported by the game subsystem */
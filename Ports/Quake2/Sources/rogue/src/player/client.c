@@ -1632,6 +1632,7 @@ PutClientInServer(edict_t *ent)
 	ent->viewheight = 22;
 	ent->inuse = true;
 	ent->classname = "player";
+	G_IndexEdict(ent);
 	ent->mass = 200;
 	ent->solid = SOLID_BBOX;
 	ent->deadflag = DEAD_NO;
@@ -1839,6 +1840,7 @@ ClientBegin(edict_t *ent)
 		   ClientConnect() time */
 		G_InitEdict(ent);
 		ent->classname = "player";
+		G_IndexEdict(ent);
 		InitClientResp(ent->client);
 		PutClientInServer(ent);
 	}
@@ -2099,6 +2101,7 @@ ClientDisconnect(edict_t *ent)
 	ent->solid = SOLID_NOT;
 	ent->inuse = false;
 	ent->classname = "disconnected";
+	G_IndexEdict(ent);
 	ent->client->pers.connected = false;
 
 	playernum = ent - g_edicts - 1;
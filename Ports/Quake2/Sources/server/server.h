@@ -33,6 +33,7 @@
 #define MAX_MASTERS 8
 #define LATENCY_COUNTS 16
 #define RATE_MESSAGES 10
+#define MAX_CLIENT_MULTICASTS 256
 
 /* MAX_CHALLENGES is made large to prevent a denial
    of service attack that could cycle all of them
@@ -98,6 +99,15 @@ typedef struct
 	int senttime; /* for ping calculations */
 } client_frame_t;
 
+/* an unreliable multicast in the shared multicast
+   buffer, and where it goes in the client datagram */
+typedef struct
+{
+	int offset;
+	short length;
+	short position;
+} multicastref_t;
+
 typedef struct client_s
 {
 	client_state_t state;
@@ -126,6 +136,19 @@ typedef struct client_s
 	sizebuf_t datagram;
 	byte datagram_buf[MAX_MSGLEN];
 
+	/* Unreliable multicasts are referenced until the
+	   datagram is sent, instead of being copied. */
+	multicastref_t multicasts[MAX_CLIENT_MULTICASTS];
+	int nummulticasts;
+	int multicastsize;
+
+	int cluster, area; /* of the edict when it was last linked */
+
+	/* The encoded frame, written by the send
+	   workers before the datagram is sent. */
+	sizebuf_t framemsg;
+	byte framemsg_buf[MAX_MSGLEN];
+
 	client_frame_t frames[UPDATE_BACKUP]; /* updates can be delta'd from here */
 
 	byte *download; /* file being downloaded */
@@ -186,6 +209,9 @@ extern cvar_t *sv_noreload; /* don't reload level state when reentering */
 extern cvar_t *sv_airaccelerate; /* don't reload level state when reentering */
 /* development tool */
 extern cvar_t *sv_enforcetime;
+extern cvar_t *sv_tracecache;
+extern cvar_t *sv_areagrid;
+extern cvar_t *sv_sendthreads;
 
 extern client_t *sv_client;
 extern edict_t *sv_player;
@@ -221,8 +247,12 @@ void SV_FlushRedirect(int sv_redirected, char *outputbuf);
 
 void SV_DemoCompleted(void);
 void SV_SendClientMessages(void);
+void SV_ShutdownSendWorkers(void);
 
 void SV_Multicast(vec3_t origin, multicast_t to);
+void SV_FlushMulticasts(void);
+void SV_ReleaseMulticasts(void);
+void SV_UpdateClientCluster(client_t *client, vec3_t origin);
 void SV_StartSound(vec3_t origin, edict_t *entity, int channel, int soundindex, float volume, float attenuation, float timeofs);
 void SV_ClientPrintf(client_t *cl, int level, char *fmt, ...);
 void SV_BroadcastPrintf(int level, char *fmt, ...);
@@ -274,4 +304,15 @@ int SV_PointContents(vec3_t p);
 
 trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *passedict, int contentmask);
 
+/* with sv_tracecache set, repeated traces within a frame are answered
+   from memory until an entity that could change them is relinked */
+void SV_ClearTraceCache(void);
+void SV_TraceCache_f(void);
+
+/* prints how many edicts SV_AreaEdicts looked at */
+void SV_AreaStats_f(void);
+
+void SV_MarkClusterEdicts(int cluster, byte *bits);
+void SV_TraceBatch(traceray_t *rays, trace_t *traces, int count, edict_t *passedict, int contentmask);
+
 #endif
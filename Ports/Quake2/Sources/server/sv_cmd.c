@@ -506,6 +506,8 @@ void SV_ServerRecord_f(void)
 		return;
 	}
 
+	FS_FlushFileCache();
+
 	/* setup a buffer to catch all multicasts */
 	SZ_Init(&svs.demo_multicast, svs.demo_multicast_buf,
 		sizeof(svs.demo_multicast_buf));
@@ -623,4 +625,7 @@ void SV_InitOperatorCommands(void)
 	Cmd_AddCommand("killserver", SV_KillServer_f);
 
 	Cmd_AddCommand("sv", SV_ServerCommand_f);
+
+	Cmd_AddCommand("tracecache", SV_TraceCache_f);
+	Cmd_AddCommand("areastats", SV_AreaStats_f);
 }
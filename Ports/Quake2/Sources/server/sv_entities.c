@@ -28,7 +28,27 @@
 
 #include "server/server.h"
 
+#define MAX_FAT_CLUSTERS 64
+#define MAX_VISIBLE_CACHE 8
+
+/* The edicts that passed the area and PVS / PHS checks for one
+   view, shared by all clients looking from the same clusters in a
+   frame. Only the distance check for sounds is left per client. */
+typedef struct
+{
+	int framenum;
+	int area, cluster;
+	int numclusters;
+	int clusters[MAX_FAT_CLUSTERS];
+	byte edicts[MAX_EDICTS / 8];
+} visiblecache_t;
+
 byte fatpvs[65536 / 8];
+int fatclusters[MAX_FAT_CLUSTERS]; /* sorted clusters ored into fatpvs */
+int numfatclusters;
+
+visiblecache_t sv_visiblecache[MAX_VISIBLE_CACHE];
+int sv_visiblecachenext;
 
 /*
  * Writes a delta update of an entity_state_t list to the message.
@@ -398,6 +418,17 @@ void SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
 		lastframe = -1;
 	}
 	else
+	if (svs.next_client_entities -
+		client->frames[client->lastframe & UPDATE_MASK].first_entity >
+		svs.num_client_entities)
+	{
+		/* the entities of the old frame were overwritten by the
+		   frames built after it, all frames are built before
+		   the first one is written */
+		oldframe = NULL;
+		lastframe = -1;
+	}
+	else
 	{
 		/* we have a valid message to delta from */
 		oldframe = &client->frames[client->lastframe & UPDATE_MASK];
@@ -427,7 +458,7 @@ void SV_WriteFrameToClient(client_t *client, sizebuf_t *msg)
  */
 void SV_FatPVS(vec3_t org)
 {
-	int leafs[64];
+	int leafs[MAX_FAT_CLUSTERS];
 	int i, j, count;
 	int longs;
 	byte *src;
@@ -439,7 +470,7 @@ void SV_FatPVS(vec3_t org)
 		maxs[i] = org[i] + 8;
 	}
 
-	count = CM_BoxLeafnums(mins, maxs, leafs, 64, NULL);
+	count = CM_BoxLeafnums(mins, maxs, leafs, MAX_FAT_CLUSTERS, NULL);
 
 	if (count < 1)
 	{
@@ -456,6 +487,9 @@ void SV_FatPVS(vec3_t org)
 
 	memcpy(fatpvs, CM_ClusterPVS(leafs[0]), longs << 2);
 
+	fatclusters[0] = leafs[0];
+	numfatclusters = 1;
+
 	/* or in all the other leaf bits */
 	for (i = 1; i < count; i++)
 	{
@@ -472,6 +506,15 @@ void SV_FatPVS(vec3_t org)
 			continue; /* already have the cluster we want */
 		}
 
+		/* keep them sorted, so views can be compared */
+		for (j = numfatclusters; j > 0 && fatclusters[j - 1] > leafs[i]; j--)
+		{
+			fatclusters[j] = fatclusters[j - 1];
+		}
+
+		fatclusters[j] = leafs[i];
+		numfatclusters++;
+
 		src = CM_ClusterPVS(leafs[i]);
 
 		for (j = 0; j < longs; j++)
@@ -481,6 +524,140 @@ void SV_FatPVS(vec3_t org)
 	}
 }
 
+/*
+ * Checks if an edict can be seen from the area with the fat PVS,
+ * or heard with the PHS for beams.
+ */
+static qboolean SV_EdictVisible(edict_t *ent, int clientarea, byte *clientphs)
+{
+	int i, l;
+
+	/* ignore ents without visible models */
+	if (ent->svflags & SVF_NOCLIENT)
+	{
+		return false;
+	}
+
+	/* ignore ents without visible models unless they have an effect */
+	if (!ent->s.modelindex && !ent->s.effects &&
+	    !ent->s.sound && !ent->s.event)
+	{
+		return false;
+	}
+
+	/* check area */
+	if (!CM_AreasConnected(clientarea, ent->areanum))
+	{
+		/* doors can legally straddle two areas,
+		   so we may need to check another one */
+		if (!ent->areanum2 ||
+		    !CM_AreasConnected(clientarea, ent->areanum2))
+		{
+			return false; /* blocked by a door */
+		}
+	}
+
+	/* beams just check one point for PHS */
+	if (ent->s.renderfx & RF_BEAM)
+	{
+		l = ent->clusternums[0];
+
+		return (clientphs[l >> 3] & (1 << (l & 7))) != 0;
+	}
+
+	if (ent->num_clusters == -1)
+	{
+		/* too many leafs for individual check, go by headnode */
+		return CM_HeadnodeVisible(ent->headnode, fatpvs);
+	}
+
+	/* check individual leafs */
+	for (i = 0; i < ent->num_clusters; i++)
+	{
+		l = ent->clusternums[i];
+
+		if (fatpvs[l >> 3] & (1 << (l & 7)))
+		{
+			return true;
+		}
+	}
+
+	return false; /* not visible */
+}
+
+/*
+ * Returns a bit for every edict visible from the area and the
+ * clusters in fatpvs. Only the edicts filed under a cluster in
+ * the PVS or PHS are looked at, and the result is shared with
+ * the other clients that have the same view this frame.
+ */
+static byte* SV_VisibleEdicts(int clientarea, int clientcluster, byte *clientphs)
+{
+	visiblecache_t *cache;
+	byte candidates[MAX_EDICTS / 8];
+	int i, j, e;
+	int rows, bits;
+
+	for (i = 0; i < MAX_VISIBLE_CACHE; i++)
+	{
+		cache = &sv_visiblecache[i];
+
+		if ((cache->framenum == sv.framenum) && (cache->area == clientarea) &&
+		    (cache->cluster == clientcluster) &&
+		    (cache->numclusters == numfatclusters) &&
+		    !memcmp(cache->clusters, fatclusters, numfatclusters * sizeof(int)))
+		{
+			return cache->edicts;
+		}
+	}
+
+	cache = &sv_visiblecache[sv_visiblecachenext];
+	sv_visiblecachenext = (sv_visiblecachenext + 1) % MAX_VISIBLE_CACHE;
+
+	cache->framenum = sv.framenum;
+	cache->area = clientarea;
+	cache->cluster = clientcluster;
+	cache->numclusters = numfatclusters;
+	memcpy(cache->clusters, fatclusters, numfatclusters * sizeof(int));
+	memset(cache->edicts, 0, sizeof(cache->edicts));
+
+	/* gather everything filed under a visible or audible cluster */
+	memset(candidates, 0, sizeof(candidates));
+	SV_MarkClusterEdicts(-1, candidates);
+
+	rows = (CM_NumClusters() + 7) >> 3;
+
+	for (i = 0; i < rows; i++)
+	{
+		bits = fatpvs[i] | clientphs[i];
+
+		for (j = 0; bits; j++, bits >>= 1)
+		{
+			if (bits & 1)
+			{
+				SV_MarkClusterEdicts((i << 3) + j, candidates);
+			}
+		}
+	}
+
+	for (e = 1; e < ge->num_edicts && e < MAX_EDICTS; e++)
+	{
+		if (!candidates[e >> 3])
+		{
+			e |= 7;
+			continue;
+		}
+
+		if ((candidates[e >> 3] & (1 << (e & 7))) &&
+		    SV_EdictVisible(EDICT_NUM(e), clientarea, clientphs))
+		{
+			cache->edicts[e >> 3] |= 1 << (e & 7);
+		}
+	}
+
+	return cache->edicts;
+}
+
 /*
  * Decides which entities are going to be visible to the client, and
  * copies off the playerstat and areabits.
@@ -493,12 +670,11 @@ void SV_BuildClientFrame(client_t *client)
 	edict_t *clent;
 	client_frame_t *frame;
 	entity_state_t *state;
-	int l;
 	int clientarea, clientcluster;
+	int clientnum;
 	int leafnum;
-	int c_fullsend;
 	byte *clientphs;
-	byte *bitvector;
+	byte *visible;
 
 	clent = client->edict;
 
@@ -531,103 +707,60 @@ void SV_BuildClientFrame(client_t *client)
 
 	SV_FatPVS(org);
 	clientphs = CM_ClusterPHS(clientcluster);
+	visible = SV_VisibleEdicts(clientarea, clientcluster, clientphs);
+	clientnum = NUM_FOR_EDICT(clent);
 
 	/* build up the list of visible entities */
 	frame->num_entities = 0;
 	frame->first_entity = svs.next_client_entities;
 
-	c_fullsend = 0;
-
-	for (e = 1; e < ge->num_edicts; e++)
+	/* edicts past MAX_EDICTS can't be sent anyway */
+	for (e = 1; e < ge->num_edicts && e < MAX_EDICTS; e++)
 	{
-		ent = EDICT_NUM(e);
-
-		/* ignore ents without visible models */
-		if (ent->svflags & SVF_NOCLIENT)
+		if (!visible[e >> 3] && ((e >> 3) != (clientnum >> 3)))
 		{
+			e |= 7;
 			continue;
 		}
 
-		/* ignore ents without visible models unless they have an effect */
-		if (!ent->s.modelindex && !ent->s.effects &&
-		    !ent->s.sound && !ent->s.event)
-		{
-			continue;
-		}
+		ent = EDICT_NUM(e);
 
-		/* ignore if not touching a PV leaf */
 		if (ent != clent)
 		{
-			/* check area */
-			if (!CM_AreasConnected(clientarea, ent->areanum))
+			if (!(visible[e >> 3] & (1 << (e & 7))))
 			{
-				/* doors can legally straddle two areas,
-				   so we may need to check another one */
-				if (!ent->areanum2 ||
-				    !CM_AreasConnected(clientarea, ent->areanum2))
-				{
-					continue; /* blocked by a door */
-				}
+				continue;
 			}
 
-			/* beams just check one point for PHS */
-			if (ent->s.renderfx & RF_BEAM)
+			if (!(ent->s.renderfx & RF_BEAM) && !ent->s.modelindex)
 			{
-				l = ent->clusternums[0];
+				/* don't send sounds if they
+				   will be attenuated away */
+				vec3_t delta;
+				float len;
 
-				if (!(clientphs[l >> 3] & (1 << (l & 7))))
+				VectorSubtract(org, ent->s.origin, delta);
+				len = VectorLength(delta);
+
+				if (len > 400)
 				{
 					continue;
 				}
 			}
-			else
+		}
+		else
+		{
+			/* ignore ents without visible models */
+			if (ent->svflags & SVF_NOCLIENT)
 			{
-				bitvector = fatpvs;
-
-				if (ent->num_clusters == -1)
-				{
-					/* too many leafs for individual check, go by headnode */
-					if (!CM_HeadnodeVisible(ent->headnode, bitvector))
-					{
-						continue;
-					}
-
-					c_fullsend++;
-				}
-				else
-				{
-					/* check individual leafs */
-					for (i = 0; i < ent->num_clusters; i++)
-					{
-						l = ent->clusternums[i];
-
-						if (bitvector[l >> 3] & (1 << (l & 7)))
-						{
-							break;
-						}
-					}
-
-					if (i == ent->num_clusters)
-					{
-						continue; /* not visible */
-					}
-				}
+				continue;
+			}
 
-				if (!ent->s.modelindex)
-				{
-					/* don't send sounds if they
-					   will be attenuated away */
-					vec3_t delta;
-					float len;
-
-					VectorSubtract(org, ent->s.origin, delta);
-					len = VectorLength(delta);
-
-					if (len > 400)
-					{
-						continue;
-					}
-				}
+			/* ignore ents without visible models unless they have an effect */
+			if (!ent->s.modelindex && !ent->s.effects &&
+			    !ent->s.sound && !ent->s.event)
+			{
+				continue;
 			}
 		}
 
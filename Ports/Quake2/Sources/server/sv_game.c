@@ -61,6 +61,8 @@ void PF_Unicast(edict_t *ent, qboolean reliable)
 	}
 	else
 	{
+		/* keep it behind the multicasts sent before */
+		SV_FlushMulticasts();
 		SZ_Write(&client->datagram, sv.multicast.data, sv.multicast.cursize);
 	}
 
@@ -332,6 +334,13 @@ void PF_StartSound(edict_t *entity, int channel, int sound_num, float volume, fl
 		volume, attenuation, timeofs);
 }
 
+void PF_SetAreaPortalState(int portalnum, qboolean open)
+{
+	/* the queued multicasts went out with the old portals */
+	SV_FlushMulticasts();
+	CM_SetAreaPortalState(portalnum, open);
+}
+
 /*
  * Called when either the entire server is being killed, or
  * it is changing to a different game directory.
@@ -376,6 +385,7 @@ void SV_InitGameProgs()
 	import.unlinkentity = SV_UnlinkEdict;
 	import.BoxEdicts = SV_AreaEdicts;
 	import.trace = SV_Trace;
+	import.tracebatch = SV_TraceBatch;
 	import.pointcontents = SV_PointContents;
 	import.setmodel = PF_setmodel;
 	import.inPVS = PF_inPVS;
@@ -417,7 +427,7 @@ void SV_InitGameProgs()
 	import.DebugGraph = SCR_DebugGraph;
 	#endif
 
-	import.SetAreaPortalState = CM_SetAreaPortalState;
+	import.SetAreaPortalState = PF_SetAreaPortalState;
 	import.AreasConnected = CM_AreasConnected;
 
 	ge = (game_export_t *)Sys_GetGameAPI(&import);
@@ -426,7 +436,9 @@ void SV_InitGameProgs()
 		Com_Error(ERR_FATAL, "Failed to load game DLL");
 	}
 
-	if (ge->apiversion != GAME_API_VERSION)
+	/* older DLLs don't know about tracebatch and run just as well */
+	if ((ge->apiversion != GAME_API_VERSION) &&
+		(ge->apiversion != GAME_API_VERSION_NOBATCH))
 	{
 		Com_Error(ERR_FATAL, "The game DLL version is %i whereas is should be %i", ge->apiversion, GAME_API_VERSION);
 	}
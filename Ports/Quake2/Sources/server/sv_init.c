@@ -28,7 +28,9 @@
 
 #include <stdbool.h>
 
+#ifndef DEDICATED_ONLY
 void CL_Pause(bool pauseFlag);
+#endif
 
 server_static_t svs; /* persistant server info */
 server_t sv; /* local server */
@@ -180,8 +182,10 @@ void SV_SpawnServer(char *server, char *spawnpoint, server_state_t serverstate,
 	int i;
 	unsigned checksum;
 
+	#ifndef DEDICATED_ONLY
 	if (attractloop)
         CL_Pause(false);
+	#endif
 
 	Com_Printf("------- server initialization ------\n");
 	Com_DPrintf("SpawnServer: %s\n", server);
@@ -216,6 +220,8 @@ void SV_SpawnServer(char *server, char *spawnpoint, server_state_t serverstate,
 	}
 
 	SZ_Init(&sv.multicast, sv.multicast_buf, sizeof(sv.multicast_buf));
+	SV_FlushMulticasts();
+	SV_ReleaseMulticasts();
 
 	strcpy(sv.name, server);
 
@@ -35,6 +35,9 @@ client_t *sv_client; /* current client */
 cvar_t *sv_paused;
 cvar_t *sv_timedemo;
 cvar_t *sv_enforcetime;
+cvar_t *sv_tracecache;
+cvar_t *sv_areagrid; /* loose grid instead of area nodes */
+cvar_t *sv_sendthreads; /* threads encoding client frames */
 cvar_t *timeout; /* seconds without any message */
 cvar_t *zombietime; /* seconds to sink messages after disconnect */
 cvar_t *rcon_password; /* password for remote server commands */
@@ -76,6 +79,7 @@ void SV_DropClient(client_t *drop)
 		drop->download = NULL;
 	}
 
+	SV_FlushMulticasts();
 	drop->state = cs_zombie; /* become free in a few seconds */
 	drop->name[0] = 0;
 }
@@ -340,6 +344,8 @@ void SV_RunGameFrame(void)
 	sv.framenum++;
 	sv.time = sv.framenum * 100;
 
+	SV_ClearTraceCache();
+
 	/* don't run if paused */
 	if (!sv_paused->value || (maxclients->value > 1))
 	{
@@ -367,6 +373,26 @@ void SV_RunGameFrame(void)
 	#endif
 }
 
+/*
+ * Milliseconds until the next server frame is due.
+ * Qcommon_Run sleeps that long, waking up early
+ * for packets on a dedicated server.
+ */
+int SV_FrameDelay()
+{
+	if (!svs.initialized)
+	{
+		return 100; /* nothing to run, just check the console now and then */
+	}
+
+	if (sv_timedemo->value)
+	{
+		return 0;
+	}
+
+	return sv.time - svs.realtime;
+}
+
 void SV_Frame(int msec)
 {
 	#ifndef DEDICATED_ONLY
@@ -404,7 +430,6 @@ void SV_Frame(int msec)
 			svs.realtime = sv.time - 100;
 		}
 
-		NET_Sleep(sv.time - svs.realtime);
 		return;
 	}
 
@@ -588,6 +613,9 @@ void SV_Init(void)
 	sv_paused = Cvar_Get("paused", "0", 0);
 	sv_timedemo = Cvar_Get("timedemo", "0", 0);
 	sv_enforcetime = Cvar_Get("sv_enforcetime", "0", 0);
+	sv_tracecache = Cvar_Get("sv_tracecache", "0", 0);
+	sv_areagrid = Cvar_Get("sv_areagrid", "0", CVAR_LATCH);
+	sv_sendthreads = Cvar_Get("sv_sendthreads", "0", 0);
 	allow_download = Cvar_Get("allow_download", "1", CVAR_ARCHIVE);
 	allow_download_players = Cvar_Get("allow_download_players", "0", CVAR_ARCHIVE);
 	allow_download_models = Cvar_Get("allow_download_models", "1", CVAR_ARCHIVE);
@@ -661,6 +689,7 @@ void SV_Shutdown(char *finalmsg, qboolean reconnect)
 	}
 
 	Master_Shutdown();
+	SV_ShutdownSendWorkers();
 	SV_ShutdownGameProgs();
 
 	/* free current level */
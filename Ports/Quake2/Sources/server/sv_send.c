@@ -135,6 +135,349 @@ void SV_BroadcastCommand(char *fmt, ...)
 	SV_Multicast(NULL, MULTICAST_ALL_R);
 }
 
+/*
+ * Unreliable multicasts are queued with the cluster and area of their
+ * origin, and their data is written once to a shared buffer. The queue
+ * is resolved in one pass over the clients grouped by cluster, using
+ * the cluster and area of each client from when it was last linked.
+ * The clients reference the data and the multicasts are only copied
+ * into the message when the datagram is sent.
+ *
+ * The queue must be flushed before anything that changes who gets a
+ * multicast: a client moving to another cluster or area, a client
+ * entering or leaving the game, an area portal, or a unicast written
+ * to the datagram in between.
+ */
+#define MAX_QUEUED_MULTICASTS 1024
+#define MAX_MULTICAST_DATA 0x10000
+
+typedef struct
+{
+	multicast_t to;
+	int cluster, area;
+	int offset, length;
+} queuedmulticast_t;
+
+typedef struct
+{
+	int cluster;
+	int firstclient, numclients;
+} clusterbucket_t;
+
+queuedmulticast_t sv_queuedmulticasts[MAX_QUEUED_MULTICASTS];
+int sv_numqueuedmulticasts;
+
+byte sv_multicastdata[MAX_MULTICAST_DATA];
+int sv_multicastsize;
+
+clusterbucket_t sv_clusterbuckets[MAX_CLIENTS];
+int sv_numclusterbuckets;
+client_t *sv_bucketclients[MAX_CLIENTS];
+
+/*
+ * Writes the datagram of the client with the referenced multicasts
+ * put back where they were sent.
+ */
+static void SV_WriteClientDatagram(client_t *client, sizebuf_t *msg)
+{
+	multicastref_t *ref;
+	int pos;
+	int i;
+
+	pos = 0;
+
+	for (i = 0, ref = client->multicasts; i < client->nummulticasts; i++, ref++)
+	{
+		SZ_Write(msg, client->datagram.data + pos, ref->position - pos);
+		SZ_Write(msg, sv_multicastdata + ref->offset, ref->length);
+		pos = ref->position;
+	}
+
+	SZ_Write(msg, client->datagram.data + pos, client->datagram.cursize - pos);
+}
+
+/*
+ * Copies the referenced multicasts into the datagram of the client.
+ */
+static void SV_CopyClientMulticasts(client_t *client)
+{
+	byte msg_buf[MAX_MSGLEN];
+	sizebuf_t msg;
+
+	if (!client->nummulticasts)
+	{
+		return;
+	}
+
+	if (client->datagram.cursize + client->multicastsize >
+		client->datagram.maxsize)
+	{
+		SZ_Clear(&client->datagram);
+		client->datagram.overflowed = true;
+	}
+	else
+	if (!client->datagram.overflowed)
+	{
+		SZ_Init(&msg, msg_buf, sizeof(msg_buf));
+		SV_WriteClientDatagram(client, &msg);
+		memcpy(client->datagram.data, msg.data, msg.cursize);
+		client->datagram.cursize = msg.cursize;
+	}
+
+	client->nummulticasts = 0;
+	client->multicastsize = 0;
+}
+
+/*
+ * Copies all referenced multicasts into the datagrams, after
+ * which the shared multicast buffer can be reused.
+ */
+void SV_ReleaseMulticasts(void)
+{
+	client_t *client;
+	int i;
+
+	for (i = 0, client = svs.clients; i < maxclients->value; i++, client++)
+	{
+		SV_CopyClientMulticasts(client);
+	}
+
+	sv_multicastsize = 0;
+}
+
+static void SV_AddClientMulticast(client_t *client, queuedmulticast_t *m)
+{
+	multicastref_t *ref;
+
+	/* an overflowed datagram isn't sent */
+	if (client->datagram.overflowed)
+	{
+		return;
+	}
+
+	if (client->datagram.cursize + client->multicastsize + m->length >
+		client->datagram.maxsize)
+	{
+		SZ_Clear(&client->datagram);
+		client->datagram.overflowed = true;
+		client->nummulticasts = 0;
+		client->multicastsize = 0;
+		return;
+	}
+
+	if (client->nummulticasts == MAX_CLIENT_MULTICASTS)
+	{
+		SV_CopyClientMulticasts(client);
+	}
+
+	ref = &client->multicasts[client->nummulticasts++];
+	ref->offset = m->offset;
+	ref->length = m->length;
+	ref->position = client->datagram.cursize;
+	client->multicastsize += m->length;
+}
+
+/*
+ * Groups the clients in the game by the cluster they are in.
+ */
+static void SV_BuildClusterBuckets(void)
+{
+	clusterbucket_t *bucket;
+	client_t *client;
+	int i, j, n;
+
+	sv_numclusterbuckets = 0;
+
+	for (i = 0, client = svs.clients; i < maxclients->value; i++, client++)
+	{
+		if (client->state != cs_spawned)
+		{
+			continue;
+		}
+
+		for (j = 0; j < sv_numclusterbuckets; j++)
+		{
+			if (sv_clusterbuckets[j].cluster == client->cluster)
+			{
+				break;
+			}
+		}
+
+		bucket = &sv_clusterbuckets[j];
+
+		if (j == sv_numclusterbuckets)
+		{
+			bucket->cluster = client->cluster;
+			bucket->numclients = 0;
+			sv_numclusterbuckets++;
+		}
+
+		bucket->numclients++;
+	}
+
+	for (j = 0, n = 0; j < sv_numclusterbuckets; j++)
+	{
+		sv_clusterbuckets[j].firstclient = n;
+		n += sv_clusterbuckets[j].numclients;
+		sv_clusterbuckets[j].numclients = 0;
+	}
+
+	/* keep the clients in order inside a bucket */
+	for (i = 0, client = svs.clients; i < maxclients->value; i++, client++)
+	{
+		if (client->state != cs_spawned)
+		{
+			continue;
+		}
+
+		for (j = 0; sv_clusterbuckets[j].cluster != client->cluster; j++)
+		{
+		}
+
+		bucket = &sv_clusterbuckets[j];
+		sv_bucketclients[bucket->firstclient + bucket->numclients++] = client;
+	}
+}
+
+/*
+ * Hands the queued multicasts to the clients that can see or hear them.
+ */
+void SV_FlushMulticasts(void)
+{
+	queuedmulticast_t *m;
+	clusterbucket_t *bucket;
+	client_t *client;
+	byte *mask;
+	int lastcluster;
+	multicast_t lastto;
+	int i, j, k;
+
+	if (!sv_numqueuedmulticasts)
+	{
+		return;
+	}
+
+	SV_BuildClusterBuckets();
+
+	mask = NULL;
+	lastcluster = -1;
+	lastto = MULTICAST_ALL;
+
+	for (i = 0, m = sv_queuedmulticasts; i < sv_numqueuedmulticasts; i++, m++)
+	{
+		if (m->to == MULTICAST_ALL)
+		{
+			for (k = 0; k < sv_numclusterbuckets; k++)
+			{
+				bucket = &sv_clusterbuckets[k];
+
+				for (j = 0; j < bucket->numclients; j++)
+				{
+					SV_AddClientMulticast(sv_bucketclients[bucket->firstclient + j], m);
+				}
+			}
+
+			continue;
+		}
+
+		/* explosions and trails come in runs from the same place */
+		if (!mask || (m->cluster != lastcluster) || (m->to != lastto))
+		{
+			if (m->to == MULTICAST_PHS)
+			{
+				mask = CM_ClusterPHS(m->cluster);
+			}
+			else
+			{
+				mask = CM_ClusterPVS(m->cluster);
+			}
+
+			lastcluster = m->cluster;
+			lastto = m->to;
+		}
+
+		for (k = 0; k < sv_numclusterbuckets; k++)
+		{
+			bucket = &sv_clusterbuckets[k];
+
+			if ((bucket->cluster < 0) ||
+				!(mask[bucket->cluster >> 3] & (1 << (bucket->cluster & 7))))
+			{
+				continue;
+			}
+
+			for (j = 0; j < bucket->numclients; j++)
+			{
+				client = sv_bucketclients[bucket->firstclient + j];
+
+				if (CM_AreasConnected(m->area, client->area))
+				{
+					SV_AddClientMulticast(client, m);
+				}
+			}
+		}
+	}
+
+	sv_numqueuedmulticasts = 0;
+}
+
+/*
+ * Remembers where a client is for multicasts, the queued
+ * multicasts were sent before it got there.
+ */
+void SV_UpdateClientCluster(client_t *client, vec3_t origin)
+{
+	int leafnum;
+	int cluster, area;
+
+	leafnum = CM_PointLeafnum(origin);
+	cluster = CM_LeafCluster(leafnum);
+	area = CM_LeafArea(leafnum);
+
+	if ((cluster == client->cluster) && (area == client->area))
+	{
+		return;
+	}
+
+	SV_FlushMulticasts();
+
+	client->cluster = cluster;
+	client->area = area;
+}
+
+static void SV_QueueMulticast(vec3_t origin, multicast_t to)
+{
+	queuedmulticast_t *m;
+	int leafnum;
+
+	if (sv_multicastsize + sv.multicast.cursize > MAX_MULTICAST_DATA)
+	{
+		SV_FlushMulticasts();
+		SV_ReleaseMulticasts();
+	}
+
+	if (sv_numqueuedmulticasts == MAX_QUEUED_MULTICASTS)
+	{
+		SV_FlushMulticasts();
+	}
+
+	m = &sv_queuedmulticasts[sv_numqueuedmulticasts++];
+	m->to = to;
+	m->offset = sv_multicastsize;
+	m->length = sv.multicast.cursize;
+
+	memcpy(sv_multicastdata + sv_multicastsize, sv.multicast.data,
+			sv.multicast.cursize);
+	sv_multicastsize += sv.multicast.cursize;
+
+	if (to != MULTICAST_ALL)
+	{
+		leafnum = CM_PointLeafnum(origin);
+		m->cluster = CM_LeafCluster(leafnum);
+		m->area = CM_LeafArea(leafnum);
+	}
+}
+
 /*
  * Sends the contents of sv.multicast to a subset of the clients,
  * then clears sv.multicast.
@@ -142,6 +485,8 @@ void SV_BroadcastCommand(char *fmt, ...)
  * MULTICAST_ALL	same as broadcast (origin can be NULL)
  * MULTICAST_PVS	send to clients potentially visible from org
  * MULTICAST_PHS	send to clients potentially hearable from org
+ *
+ * The unreliable ones are queued until SV_FlushMulticasts().
  */
 void SV_Multicast(vec3_t origin, multicast_t to)
 {
@@ -149,12 +494,23 @@ void SV_Multicast(vec3_t origin, multicast_t to)
 	byte *mask;
 	int leafnum = 0, cluster;
 	int j;
-	qboolean reliable;
 	int area1, area2;
 
-	reliable = false;
+	/* if doing a serverrecord, store everything */
+	if (svs.demofile)
+	{
+		SZ_Write(&svs.demo_multicast, sv.multicast.data, sv.multicast.cursize);
+	}
+
+	if ((to == MULTICAST_ALL) || (to == MULTICAST_PHS) ||
+		(to == MULTICAST_PVS))
+	{
+		SV_QueueMulticast(origin, to);
+		SZ_Clear(&sv.multicast);
+		return;
+	}
 
-	if ((to != MULTICAST_ALL_R) && (to != MULTICAST_ALL))
+	if (to != MULTICAST_ALL_R)
 	{
 		leafnum = CM_PointLeafnum(origin);
 		area1 = CM_LeafArea(leafnum);
@@ -164,32 +520,18 @@ void SV_Multicast(vec3_t origin, multicast_t to)
 		area1 = 0;
 	}
 
-	/* if doing a serverrecord, store everything */
-	if (svs.demofile)
-	{
-		SZ_Write(&svs.demo_multicast, sv.multicast.data, sv.multicast.cursize);
-	}
-
 	switch (to)
 	{
 	case MULTICAST_ALL_R:
-		reliable = true;         /* intentional fallthrough */
-	case MULTICAST_ALL:
 		mask = NULL;
 		break;
 
 	case MULTICAST_PHS_R:
-		reliable = true;         /* intentional fallthrough */
-	case MULTICAST_PHS:
-		leafnum = CM_PointLeafnum(origin);
 		cluster = CM_LeafCluster(leafnum);
 		mask = CM_ClusterPHS(cluster);
 		break;
 
 	case MULTICAST_PVS_R:
-		reliable = true;         /* intentional fallthrough */
-	case MULTICAST_PVS:
-		leafnum = CM_PointLeafnum(origin);
 		cluster = CM_LeafCluster(leafnum);
 		mask = CM_ClusterPVS(cluster);
 		break;
@@ -207,11 +549,6 @@ void SV_Multicast(vec3_t origin, multicast_t to)
 			continue;
 		}
 
-		if ((client->state != cs_spawned) && !reliable)
-		{
-			continue;
-		}
-
 		if (mask)
 		{
 			leafnum = CM_PointLeafnum(client->edict->s.origin);
@@ -223,21 +560,15 @@ void SV_Multicast(vec3_t origin, multicast_t to)
 				continue;
 			}
 
-			if (mask && (!(mask[cluster >> 3] & (1 << (cluster & 7)))))
+			/* outside the map */
+			if ((cluster < 0) || !(mask[cluster >> 3] & (1 << (cluster & 7))))
 			{
 				continue;
 			}
 		}
 
-		if (reliable)
-		{
-			SZ_Write(&client->netchan.message, sv.multicast.data,
-				sv.multicast.cursize);
-		}
-		else
-		{
-			SZ_Write(&client->datagram, sv.multicast.data, sv.multicast.cursize);
-		}
+		SZ_Write(&client->netchan.message, sv.multicast.data,
+			sv.multicast.cursize);
 	}
 
 	SZ_Clear(&sv.multicast);
@@ -409,34 +740,243 @@ void SV_StartSound(vec3_t origin, edict_t *entity, int channel, int soundindex,
 	}
 }
 
+/*
+ * The frames of the spawned clients are built first, then encoded
+ * by sv_sendthreads worker threads together with the main thread,
+ * and sent in client order afterwards. Encoding only reads the
+ * built frames, so the clients can be split between the threads.
+ */
+#define MAX_SEND_WORKERS 16
+#define MAX_FRAMEMSG 0x10000 /* a frame with every edict in it fits */
+
+typedef struct
+{
+	void *thread;
+	void *start;
+	sizebuf_t msg;
+	byte msg_buf[MAX_FRAMEMSG];
+} sendworker_t;
+
+sendworker_t sv_sendworkers[MAX_SEND_WORKERS + 1]; /* 0 is the main thread */
+int sv_numsendworkers;
+void *sv_sendworkersdone;
+qboolean sv_sendworkersquit;
+
+client_t *sv_sendclients[MAX_CLIENTS];
+int sv_numsendclients;
+
+/*
+ * Encodes every stride'th built frame into the client's frame message.
+ * The frame is written to a scratch buffer large enough that it can't
+ * overflow, a worker must not print.
+ */
+static void SV_EncodeClientFrames(int first, int stride)
+{
+	sendworker_t *worker;
+	client_t *client;
+	int i;
+
+	worker = &sv_sendworkers[first];
+
+	for (i = first; i < sv_numsendclients; i += stride)
+	{
+		client = sv_sendclients[i];
+
+		SZ_Init(&worker->msg, worker->msg_buf, sizeof(worker->msg_buf));
+		worker->msg.allowoverflow = true;
+
+		/* send over all the relevant entity_state_t
+		   and the player_state_t */
+		SV_WriteFrameToClient(client, &worker->msg);
+
+		SZ_Init(&client->framemsg, client->framemsg_buf,
+				sizeof(client->framemsg_buf));
+
+		if (worker->msg.cursize > client->framemsg.maxsize)
+		{
+			client->framemsg.overflowed = true;
+		}
+		else
+		{
+			SZ_Write(&client->framemsg, worker->msg.data, worker->msg.cursize);
+		}
+	}
+}
+
+static int SV_SendWorkerThread(void *data)
+{
+	int first;
+
+	first = (int)(size_t)data;
+
+	while (1)
+	{
+		Sys_SemaphoreWait(sv_sendworkers[first].start);
+
+		if (sv_sendworkersquit)
+		{
+			break;
+		}
+
+		SV_EncodeClientFrames(first, sv_numsendworkers + 1);
+		Sys_SemaphorePost(sv_sendworkersdone);
+	}
+
+	return 0;
+}
+
+void SV_ShutdownSendWorkers(void)
+{
+	int i;
+
+	if (!sv_numsendworkers)
+	{
+		return;
+	}
+
+	sv_sendworkersquit = true;
+
+	for (i = 1; i <= sv_numsendworkers; i++)
+	{
+		Sys_SemaphorePost(sv_sendworkers[i].start);
+		Sys_WaitThread(sv_sendworkers[i].thread);
+		Sys_DestroySemaphore(sv_sendworkers[i].start);
+		sv_sendworkers[i].thread = NULL;
+		sv_sendworkers[i].start = NULL;
+	}
+
+	Sys_DestroySemaphore(sv_sendworkersdone);
+	sv_sendworkersdone = NULL;
+	sv_sendworkersquit = false;
+	sv_numsendworkers = 0;
+}
+
+static void SV_StartSendWorkers(int count)
+{
+	sendworker_t *worker;
+	int i;
+
+	sv_sendworkersdone = Sys_CreateSemaphore(0);
+
+	if (!sv_sendworkersdone)
+	{
+		count = 0;
+	}
+
+	for (i = 1; i <= count; i++)
+	{
+		worker = &sv_sendworkers[i];
+		worker->start = Sys_CreateSemaphore(0);
+
+		if (!worker->start)
+		{
+			break;
+		}
+
+		worker->thread = Sys_CreateThread(SV_SendWorkerThread, (void *)(size_t)i);
+
+		if (!worker->thread)
+		{
+			Sys_DestroySemaphore(worker->start);
+			worker->start = NULL;
+			break;
+		}
+
+		sv_numsendworkers++;
+	}
+
+	if (sv_numsendworkers != count)
+	{
+		Com_Printf("Couldn't start %i send threads, using %i.\n",
+				count, sv_numsendworkers);
+		Cvar_SetValue("sv_sendthreads", sv_numsendworkers);
+	}
+
+	if (!sv_numsendworkers && sv_sendworkersdone)
+	{
+		Sys_DestroySemaphore(sv_sendworkersdone);
+		sv_sendworkersdone = NULL;
+	}
+}
+
+static void SV_RunSendWorkers(void)
+{
+	int count;
+	int i;
+
+	count = (int)sv_sendthreads->value;
+
+	if (count < 0)
+	{
+		count = 0;
+	}
+	else
+	if (count > MAX_SEND_WORKERS)
+	{
+		count = MAX_SEND_WORKERS;
+	}
+
+	if (count != sv_numsendworkers)
+	{
+		SV_ShutdownSendWorkers();
+		SV_StartSendWorkers(count);
+	}
+
+	if (!sv_numsendworkers || (sv_numsendclients < 2))
+	{
+		SV_EncodeClientFrames(0, 1);
+		return;
+	}
+
+	for (i = 1; i <= sv_numsendworkers; i++)
+	{
+		Sys_SemaphorePost(sv_sendworkers[i].start);
+	}
+
+	SV_EncodeClientFrames(0, sv_numsendworkers + 1);
+
+	for (i = 1; i <= sv_numsendworkers; i++)
+	{
+		Sys_SemaphoreWait(sv_sendworkersdone);
+	}
+}
+
 qboolean SV_SendClientDatagram(client_t *client)
 {
 	byte msg_buf[MAX_MSGLEN];
 	sizebuf_t msg;
 
-	SV_BuildClientFrame(client);
-
 	SZ_Init(&msg, msg_buf, sizeof(msg_buf));
 	msg.allowoverflow = true;
 
-	/* send over all the relevant entity_state_t
-	   and the player_state_t */
-	SV_WriteFrameToClient(client, &msg);
+	/* the frame encoded by SV_EncodeClientFrames */
+	if (client->framemsg.overflowed)
+	{
+		msg.overflowed = true;
+	}
+	else
+	{
+		SZ_Write(&msg, client->framemsg.data, client->framemsg.cursize);
+	}
 
 	/* copy the accumulated multicast datagram
 	   for this client out to the message
 	   it is necessary for this to be after the WriteEntities
 	   so that entity references will be current */
-	if (client->datagram.overflowed)
+	if (client->datagram.overflowed ||
+		(client->datagram.cursize + client->multicastsize >
+		 client->datagram.maxsize))
 	{
 		Com_Printf("WARNING: datagram overflowed for %s\n", client->name);
 	}
 	else
 	{
-		SZ_Write(&msg, client->datagram.data, client->datagram.cursize);
+		SV_WriteClientDatagram(client, &msg);
 	}
 
 	SZ_Clear(&client->datagram);
+	client->nummulticasts = 0;
+	client->multicastsize = 0;
 
 	if (msg.overflowed)
 	{
@@ -549,7 +1089,13 @@ void SV_SendClientMessages()
 		}
 	}
 
-	/* send a message to each connected client */
+	SV_FlushMulticasts();
+	NET_QueuePackets(NS_SERVER);
+
+	sv_numsendclients = 0;
+
+	/* send a message to each connected client,
+	   spawned clients only get their frame built */
 	for (i = 0, c = svs.clients; i < maxclients->value; i++, c++)
 	{
 		if (!c->state)
@@ -564,6 +1110,8 @@ void SV_SendClientMessages()
 		{
 			SZ_Clear(&c->netchan.message);
 			SZ_Clear(&c->datagram);
+			c->nummulticasts = 0;
+			c->multicastsize = 0;
 			SV_BroadcastPrintf(PRINT_HIGH, "%s overflowed\n", c->name);
 			SV_DropClient(c);
 		}
@@ -583,7 +1131,8 @@ void SV_SendClientMessages()
 				continue;
 			}
 
-			SV_SendClientDatagram(c);
+			SV_BuildClientFrame(c);
+			sv_sendclients[sv_numsendclients++] = c;
 		}
 		else
 		{
@@ -595,4 +1144,19 @@ void SV_SendClientMessages()
 			}
 		}
 	}
+
+	if (sv_numsendclients)
+	{
+		SV_RunSendWorkers();
+
+		for (i = 0; i < sv_numsendclients; i++)
+		{
+			SV_SendClientDatagram(sv_sendclients[i]);
+		}
+	}
+
+	/* keep what the rate dropped clients didn't get */
+	SV_ReleaseMulticasts();
+
+	NET_FlushPackets(NS_SERVER);
 }
@@ -230,7 +230,9 @@ void SV_Begin_f(void)
 		return;
 	}
 
+	SV_FlushMulticasts();
 	sv_client->state = cs_spawned;
+	SV_UpdateClientCluster(sv_client, sv_player->s.origin);
 
 	/* call the game begin function */
 	ge->ClientBegin(sv_player);
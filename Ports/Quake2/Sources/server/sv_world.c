@@ -28,7 +28,12 @@
 
 #define AREA_DEPTH 4
 #define AREA_NODES 32
+#define AREA_CELL_SIZE 128 /* finest grid cells */
+#define AREA_GRID_SIZE 64 /* most cells along an axis, halved on each level */
+#define AREA_GRID_LEVELS 7
+#define AREA_GRID_CELLS (AREA_GRID_SIZE * AREA_GRID_SIZE * 4 / 3 + 1)
 #define MAX_TOTAL_ENT_LEAFS 128
+#define TRACE_CACHE_SIZE 512 /* must be a power of two */
 
 #define STRUCT_FROM_LINK(l, t, m) ((t *)((byte *)l - (byte *)&(((t *)NULL)->m)))
 #define EDICT_FROM_AREA(l) STRUCT_FROM_LINK(l, edict_t, area)
@@ -42,9 +47,64 @@ typedef struct areanode_s
 	link_t solid_edicts;
 } areanode_t;
 
+typedef struct
+{
+	link_t trigger_edicts;
+	link_t solid_edicts;
+} areacell_t;
+
+/* one of the clusters an edict was linked in */
+typedef struct
+{
+	int list; /* -1 if unused */
+	int prev, next;
+} clusterlink_t;
+
+typedef struct
+{
+	float cellsize;
+	int size[2];
+	areacell_t *cells;
+} arealevel_t;
+
+/* A trace remembered for the rest of the frame. Box encloses
+   every entity that could have changed it. */
+typedef struct
+{
+	int generation;
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	edict_t *passedict;
+	int contentmask;
+	vec3_t boxmins, boxmaxs;
+	trace_t trace;
+} tracecache_t;
+
 areanode_t sv_areanodes[AREA_NODES];
 int sv_numareanodes;
 
+/* the loose grid used instead of the nodes with sv_areagrid */
+qboolean sv_areagrid_active;
+areacell_t sv_areacells[AREA_GRID_CELLS];
+arealevel_t sv_arealevels[AREA_GRID_LEVELS];
+int sv_numarealevels;
+vec3_t sv_areaorigin;
+
+int area_queries, area_tested, area_found;
+
+/* The edicts in each cluster as of their last link, numbered
+   edict * MAX_ENT_CLUSTERS + slot. The extra last list holds the
+   edicts without clusters, which are found by headnode. */
+clusterlink_t sv_clusterlinks[MAX_EDICTS * MAX_ENT_CLUSTERS];
+int sv_clusterlists[MAX_MAP_LEAFS + 1];
+int sv_numclusterlists;
+
+tracecache_t trace_cache[TRACE_CACHE_SIZE];
+int trace_cached[TRACE_CACHE_SIZE]; /* slots filled this generation */
+int trace_numcached;
+int trace_generation = 1;
+int trace_frames, trace_hits, trace_misses, trace_invalidated;
+
 float *area_mins, *area_maxs;
 edict_t **area_list;
 int area_count, area_maxcount;
@@ -119,11 +179,394 @@ areanode_t* SV_CreateAreaNode(int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+ * Forgets all remembered traces, called at the start of each
+ * frame and whenever the world changes.
+ */
+void SV_ClearTraceCache(void)
+{
+	trace_generation++;
+	trace_numcached = 0;
+	trace_frames++;
+}
+
+/*
+ * Drops the remembered traces an entity in the given box could
+ * have touched.
+ */
+void SV_InvalidateTraces(vec3_t mins, vec3_t maxs)
+{
+	tracecache_t *entry;
+	int i;
+
+	for (i = 0; i < trace_numcached; i++)
+	{
+		entry = &trace_cache[trace_cached[i]];
+
+		if (entry->generation != trace_generation)
+		{
+			continue;
+		}
+
+		if ((mins[0] > entry->boxmaxs[0]) || (mins[1] > entry->boxmaxs[1]) ||
+		    (mins[2] > entry->boxmaxs[2]) || (maxs[0] < entry->boxmins[0]) ||
+		    (maxs[1] < entry->boxmins[1]) || (maxs[2] < entry->boxmins[2]))
+		{
+			continue;
+		}
+
+		entry->generation = 0;
+		trace_invalidated++;
+	}
+}
+
+static int SV_TraceCacheSlot(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *passedict, int contentmask)
+{
+	unsigned hash;
+	int i;
+
+	/* the key is compared exactly, only the
+	   slot comes from the rounded positions */
+	hash = (unsigned)contentmask * 31 + (unsigned)(size_t)passedict;
+
+	for (i = 0; i < 3; i++)
+	{
+		hash = hash * 31 + (int)start[i];
+		hash = hash * 31 + (int)end[i];
+		hash = hash * 7 + (int)(maxs[i] - mins[i]);
+	}
+
+	hash ^= hash >> 15;
+	hash *= 0x2c1b3c6d;
+	hash ^= hash >> 12;
+
+	return hash & (TRACE_CACHE_SIZE - 1);
+}
+
+static qboolean SV_TraceCacheMatch(tracecache_t *entry, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *passedict, int contentmask)
+{
+	return (entry->generation == trace_generation) &&
+		(entry->passedict == passedict) && (entry->contentmask == contentmask) &&
+		VectorCompare(entry->start, start) && VectorCompare(entry->end, end) &&
+		VectorCompare(entry->mins, mins) && VectorCompare(entry->maxs, maxs);
+}
+
+static void SV_TraceCacheStore(int slot, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *passedict, int contentmask, vec3_t boxmins, vec3_t boxmaxs, trace_t *trace)
+{
+	tracecache_t *entry;
+
+	entry = &trace_cache[slot];
+
+	if (entry->generation != trace_generation)
+	{
+		if (trace_numcached == TRACE_CACHE_SIZE)
+		{
+			return; /* slots were refilled too often, wait for the next frame */
+		}
+
+		trace_cached[trace_numcached++] = slot;
+	}
+
+	entry->generation = trace_generation;
+	VectorCopy(start, entry->start);
+	VectorCopy(end, entry->end);
+	VectorCopy(mins, entry->mins);
+	VectorCopy(maxs, entry->maxs);
+	entry->passedict = passedict;
+	entry->contentmask = contentmask;
+	VectorCopy(boxmins, entry->boxmins);
+	VectorCopy(boxmaxs, entry->boxmaxs);
+	entry->trace = *trace;
+}
+
+void SV_TraceCache_f(void)
+{
+	int lookups;
+
+	lookups = trace_hits + trace_misses;
+
+	Com_Printf("%i traces in %i frames, %i hits (%.1f%%), %i invalidated\n",
+			lookups, trace_frames, trace_hits,
+			lookups ? 100.0f * trace_hits / lookups : 0.0f,
+			trace_invalidated);
+
+	if ((Cmd_Argc() > 1) && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		trace_frames = 0;
+		trace_hits = 0;
+		trace_misses = 0;
+		trace_invalidated = 0;
+	}
+}
+
+/*
+ * Builds a loose grid over the world. Each level has cells twice
+ * as large as the one below and the last one is a single cell. An
+ * entity goes into the first level its size fits in, in the cell
+ * holding its center, so it sticks out by half a cell at most.
+ */
+void SV_CreateAreaGrid(vec3_t mins, vec3_t maxs)
+{
+	arealevel_t *level;
+	float cellsize;
+	int i, j, size;
+	int numcells;
+
+	memset(sv_areacells, 0, sizeof(sv_areacells));
+	VectorCopy(mins, sv_areaorigin);
+
+	sv_numarealevels = 0;
+	numcells = 0;
+	cellsize = AREA_CELL_SIZE;
+	size = AREA_GRID_SIZE;
+
+	while (1)
+	{
+		level = &sv_arealevels[sv_numarealevels];
+		sv_numarealevels++;
+
+		level->cellsize = cellsize;
+		level->cells = &sv_areacells[numcells];
+
+		for (j = 0; j < 2; j++)
+		{
+			level->size[j] = (int)ceilf((maxs[j] - mins[j]) / cellsize);
+
+			if (level->size[j] < 1)
+			{
+				level->size[j] = 1;
+			}
+
+			if (level->size[j] > size)
+			{
+				level->size[j] = size;
+			}
+		}
+
+		for (i = 0; i < level->size[0] * level->size[1]; i++)
+		{
+			ClearLink(&level->cells[i].trigger_edicts);
+			ClearLink(&level->cells[i].solid_edicts);
+		}
+
+		numcells += level->size[0] * level->size[1];
+
+		if ((level->size[0] == 1) && (level->size[1] == 1))
+		{
+			break;
+		}
+
+		cellsize *= 2;
+		size /= 2;
+	}
+}
+
+/*
+ * Cell along one axis, everything outside the
+ * world goes into the cells along its edges
+ */
+static int SV_AreaCell(arealevel_t *level, int axis, float v)
+{
+	int cell;
+
+	cell = (int)floorf((v - sv_areaorigin[axis]) / level->cellsize);
+
+	if (cell < 0)
+	{
+		return 0;
+	}
+
+	if (cell >= level->size[axis])
+	{
+		return level->size[axis] - 1;
+	}
+
+	return cell;
+}
+
+static areacell_t* SV_AreaCellForBox(vec3_t mins, vec3_t maxs)
+{
+	arealevel_t *level;
+	float extent;
+	int i;
+
+	extent = maxs[0] - mins[0];
+
+	if (maxs[1] - mins[1] > extent)
+	{
+		extent = maxs[1] - mins[1];
+	}
+
+	for (i = 0; i < sv_numarealevels - 1; i++)
+	{
+		if (sv_arealevels[i].cellsize >= extent)
+		{
+			break;
+		}
+	}
+
+	level = &sv_arealevels[i];
+
+	return &level->cells[SV_AreaCell(level, 1, 0.5f * (mins[1] + maxs[1])) * level->size[0] +
+		SV_AreaCell(level, 0, 0.5f * (mins[0] + maxs[0]))];
+}
+
+void SV_AreaStats_f(void)
+{
+	Com_Printf("%s: %i queries, %.1f edicts tested and %.1f found per query\n",
+			sv_areagrid_active ? "grid" : "nodes", area_queries,
+			area_queries ? (float)area_tested / area_queries : 0.0f,
+			area_queries ? (float)area_found / area_queries : 0.0f);
+
+	if ((Cmd_Argc() > 1) && !strcmp(Cmd_Argv(1), "reset"))
+	{
+		area_queries = 0;
+		area_tested = 0;
+		area_found = 0;
+	}
+}
+
+static void SV_UnlinkClusters(int num)
+{
+	clusterlink_t *link;
+	int i, id;
+
+	for (i = 0; i < MAX_ENT_CLUSTERS; i++)
+	{
+		id = num * MAX_ENT_CLUSTERS + i;
+		link = &sv_clusterlinks[id];
+
+		if (link->list == -1)
+		{
+			break;
+		}
+
+		if (link->prev != -1)
+		{
+			sv_clusterlinks[link->prev].next = link->next;
+		}
+		else
+		{
+			sv_clusterlists[link->list] = link->next;
+		}
+
+		if (link->next != -1)
+		{
+			sv_clusterlinks[link->next].prev = link->prev;
+		}
+
+		link->list = -1;
+	}
+}
+
+static void SV_LinkCluster(int id, int list)
+{
+	clusterlink_t *link;
+
+	link = &sv_clusterlinks[id];
+	link->list = list;
+	link->prev = -1;
+	link->next = sv_clusterlists[list];
+
+	if (link->next != -1)
+	{
+		sv_clusterlinks[link->next].prev = id;
+	}
+
+	sv_clusterlists[list] = id;
+}
+
+/*
+ * Files the edict under the clusters it touches
+ */
+static void SV_LinkClusters(edict_t *ent)
+{
+	int i, num, cluster;
+
+	num = NUM_FOR_EDICT(ent);
+
+	if ((num < 0) || (num >= MAX_EDICTS))
+	{
+		return;
+	}
+
+	SV_UnlinkClusters(num);
+
+	if (ent->num_clusters <= 0)
+	{
+		SV_LinkCluster(num * MAX_ENT_CLUSTERS, sv_numclusterlists - 1);
+		return;
+	}
+
+	for (i = 0; i < ent->num_clusters; i++)
+	{
+		cluster = ent->clusternums[i];
+
+		if ((cluster < 0) || (cluster >= sv_numclusterlists - 1))
+		{
+			/* not from this map, let the headnode list have it */
+			SV_UnlinkClusters(num);
+			SV_LinkCluster(num * MAX_ENT_CLUSTERS, sv_numclusterlists - 1);
+			return;
+		}
+
+		SV_LinkCluster(num * MAX_ENT_CLUSTERS + i, cluster);
+	}
+}
+
+/*
+ * Sets the bit of every edict filed under the cluster,
+ * -1 for the edicts that have to be checked by headnode
+ */
+void SV_MarkClusterEdicts(int cluster, byte *bits)
+{
+	int id, num;
+
+	if (cluster == -1)
+	{
+		cluster = sv_numclusterlists - 1;
+	}
+
+	for (id = sv_clusterlists[cluster]; id != -1; id = sv_clusterlinks[id].next)
+	{
+		num = id / MAX_ENT_CLUSTERS;
+		bits[num >> 3] |= 1 << (num & 7);
+	}
+}
+
 void SV_ClearWorld(void)
 {
+	int i;
+
+	SV_ClearTraceCache();
+
+	/* the edicts keep their clusters until they are linked again */
+	memset(sv_clusterlinks, -1, sizeof(sv_clusterlinks));
+	sv_numclusterlists = CM_NumClusters() + 1;
+
+	for (i = 0; i < sv_numclusterlists; i++)
+	{
+		sv_clusterlists[i] = -1;
+	}
+
+	if (ge)
+	{
+		for (i = 1; i < ge->num_edicts; i++)
+		{
+			SV_LinkClusters(EDICT_NUM(i));
+		}
+	}
+
 	memset(sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
 	SV_CreateAreaNode(0, sv.models[1]->mins, sv.models[1]->maxs);
+
+	sv_areagrid_active = sv_areagrid->value != 0;
+
+	if (sv_areagrid_active)
+	{
+		SV_CreateAreaGrid(sv.models[1]->mins, sv.models[1]->maxs);
+	}
 }
 
 void SV_UnlinkEdict(edict_t *ent)
@@ -133,6 +576,11 @@ void SV_UnlinkEdict(edict_t *ent)
 		return; /* not linked in anywhere */
 	}
 
+	if (trace_numcached)
+	{
+		SV_InvalidateTraces(ent->absmin, ent->absmax);
+	}
+
 	RemoveLink(&ent->area);
 	ent->area.prev = ent->area.next = NULL;
 }
@@ -140,6 +588,7 @@ void SV_UnlinkEdict(edict_t *ent)
 void SV_LinkEdict(edict_t *ent)
 {
 	areanode_t *node;
+	areacell_t *cell;
 	int leafs[MAX_TOTAL_ENT_LEAFS];
 	int clusters[MAX_TOTAL_ENT_LEAFS];
 	int num_leafs;
@@ -346,6 +795,16 @@ void SV_LinkEdict(edict_t *ent)
 		}
 	}
 
+	SV_LinkClusters(ent);
+
+	/* multicasts check the clients where they were last linked */
+	i = NUM_FOR_EDICT(ent);
+
+	if ((i >= 1) && (i <= maxclients->value))
+	{
+		SV_UpdateClientCluster(svs.clients + (i - 1), ent->s.origin);
+	}
+
 	/* if first time, make sure old_origin is valid */
 	if (!ent->linkcount)
 	{
@@ -359,61 +818,76 @@ void SV_LinkEdict(edict_t *ent)
 		return;
 	}
 
-	/* find the first node that the ent's box crosses */
-	node = sv_areanodes;
-
-	while (1)
+	if (sv_areagrid_active)
 	{
-		if (node->axis == -1)
+		cell = SV_AreaCellForBox(ent->absmin, ent->absmax);
+
+		if (ent->solid == SOLID_TRIGGER)
 		{
-			break;
+			InsertLinkBefore(&ent->area, &cell->trigger_edicts);
 		}
+		else
+		{
+			InsertLinkBefore(&ent->area, &cell->solid_edicts);
+		}
+	}
+	else
+	{
+		/* find the first node that the ent's box crosses */
+		node = sv_areanodes;
 
-		if (ent->absmin[node->axis] > node->dist)
+		while (1)
 		{
-			node = node->children[0];
+			if (node->axis == -1)
+			{
+				break;
+			}
+
+			if (ent->absmin[node->axis] > node->dist)
+			{
+				node = node->children[0];
+			}
+			else
+			if (ent->absmax[node->axis] < node->dist)
+			{
+				node = node->children[1];
+			}
+			else
+			{
+				break; /* crosses the node */
+			}
 		}
-		else
-		if (ent->absmax[node->axis] < node->dist)
+
+		/* link it in */
+		if (ent->solid == SOLID_TRIGGER)
 		{
-			node = node->children[1];
+			InsertLinkBefore(&ent->area, &node->trigger_edicts);
 		}
 		else
 		{
-			break; /* crosses the node */
+			InsertLinkBefore(&ent->area, &node->solid_edicts);
 		}
 	}
 
-	/* link it in */
-	if (ent->solid == SOLID_TRIGGER)
-	{
-		InsertLinkBefore(&ent->area, &node->trigger_edicts);
-	}
-	else
+	if (trace_numcached)
 	{
-		InsertLinkBefore(&ent->area, &node->solid_edicts);
+		SV_InvalidateTraces(ent->absmin, ent->absmax);
 	}
 }
 
-void SV_AreaEdicts_r(areanode_t *node)
+/*
+ * Adds the edicts of one list touching the area, false once the list is full
+ */
+static qboolean SV_AreaEdictsInList(link_t *start)
 {
-	link_t *l, *next, *start;
+	link_t *l, *next;
 	edict_t *check;
 
-	/* touch linked edicts */
-	if (area_type == AREA_SOLID)
-	{
-		start = &node->solid_edicts;
-	}
-	else
-	{
-		start = &node->trigger_edicts;
-	}
-
 	for (l = start->next; l != start; l = next)
 	{
 		next = l->next;
 		check = (EDICT_FROM_AREA(l));
+		area_tested++;
 
 		if (check->solid == SOLID_NOT)
 		{
@@ -433,13 +907,34 @@ void SV_AreaEdicts_r(areanode_t *node)
 		if (area_count == area_maxcount)
 		{
 			Com_Printf("SV_AreaEdicts: MAXCOUNT\n");
-			return;
+			return false;
 		}
 
 		area_list[area_count] = check;
 		area_count++;
 	}
 
+	return true;
+}
+
+void SV_AreaEdicts_r(areanode_t *node)
+{
+	/* touch linked edicts */
+	if (area_type == AREA_SOLID)
+	{
+		if (!SV_AreaEdictsInList(&node->solid_edicts))
+		{
+			return;
+		}
+	}
+	else
+	{
+		if (!SV_AreaEdictsInList(&node->trigger_edicts))
+		{
+			return;
+		}
+	}
+
 	if (node->axis == -1)
 	{
 		return; /* terminal node */
@@ -457,6 +952,42 @@ void SV_AreaEdicts_r(areanode_t *node)
 	}
 }
 
+/*
+ * Visits the cells an edict touching the area can be in, which
+ * is the area grown by half a cell on each level
+ */
+void SV_AreaEdictsGrid(void)
+{
+	arealevel_t *level;
+	areacell_t *cell;
+	int i, x, y;
+	int mins[2], maxs[2];
+
+	for (i = 0; i < sv_numarealevels; i++)
+	{
+		level = &sv_arealevels[i];
+
+		mins[0] = SV_AreaCell(level, 0, area_mins[0] - 0.5f * level->cellsize);
+		mins[1] = SV_AreaCell(level, 1, area_mins[1] - 0.5f * level->cellsize);
+		maxs[0] = SV_AreaCell(level, 0, area_maxs[0] + 0.5f * level->cellsize);
+		maxs[1] = SV_AreaCell(level, 1, area_maxs[1] + 0.5f * level->cellsize);
+
+		for (y = mins[1]; y <= maxs[1]; y++)
+		{
+			for (x = mins[0]; x <= maxs[0]; x++)
+			{
+				cell = &level->cells[y * level->size[0] + x];
+
+				if (!SV_AreaEdictsInList(area_type == AREA_SOLID ?
+							&cell->solid_edicts : &cell->trigger_edicts))
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
 int SV_AreaEdicts(vec3_t mins, vec3_t maxs, edict_t **list, int maxcount, int areatype)
 {
 	area_mins = mins;
@@ -466,7 +997,17 @@ int SV_AreaEdicts(vec3_t mins, vec3_t maxs, edict_t **list, int maxcount, int ar
 	area_type = areatype;
 	area_count = 0;
 
-	SV_AreaEdicts_r(sv_areanodes);
+	if (sv_areagrid_active)
+	{
+		SV_AreaEdictsGrid();
+	}
+	else
+	{
+		SV_AreaEdicts_r(sv_areanodes);
+	}
+
+	area_queries++;
+	area_found += area_count;
 
 	area_mins = 0;
 	area_maxs = 0;
@@ -666,6 +1207,7 @@ void SV_TraceBounds(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, vec3_t b
 trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *passedict, int contentmask)
 {
 	moveclip_t clip;
+	int slot;
 
 	if (!mins)
 	{
@@ -677,6 +1219,21 @@ trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *pa
 		maxs = vec3_origin;
 	}
 
+	slot = -1;
+
+	if (sv_tracecache->value)
+	{
+		slot = SV_TraceCacheSlot(start, mins, maxs, end, passedict, contentmask);
+
+		if (SV_TraceCacheMatch(&trace_cache[slot], start, mins, maxs, end, passedict, contentmask))
+		{
+			trace_hits++;
+			return trace_cache[slot].trace;
+		}
+
+		trace_misses++;
+	}
+
 	memset(&clip, 0, sizeof(moveclip_t));
 
 	/* clip to world */
@@ -685,6 +1242,15 @@ trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *pa
 
 	if (clip.trace.fraction == 0)
 	{
+		if (slot != -1)
+		{
+			/* no entity can change this, so an inside out box */
+			VectorSet(clip.boxmins, 99999, 99999, 99999);
+			VectorSet(clip.boxmaxs, -99999, -99999, -99999);
+			SV_TraceCacheStore(slot, start, mins, maxs, end, passedict,
+					contentmask, clip.boxmins, clip.boxmaxs, &clip.trace);
+		}
+
 		return clip.trace; /* blocked by the world */
 	}
 
@@ -705,5 +1271,55 @@ trace_t SV_Trace(vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, edict_t *pa
 	/* clip to other solid entities */
 	SV_ClipMoveToEntities(&clip);
 
+	if (slot != -1)
+	{
+		SV_TraceCacheStore(slot, start, mins, maxs, end, passedict,
+				contentmask, clip.boxmins, clip.boxmaxs, &clip.trace);
+	}
+
 	return clip.trace;
 }
+
+/*
+ * SV_Trace for several boxes, the world part is traced as one batch.
+ */
+void SV_TraceBatch(traceray_t *rays, trace_t *traces, int count, edict_t *passedict, int contentmask)
+{
+	moveclip_t clip;
+	int i;
+
+	/* clip to world */
+	CM_BoxTraceBatch(rays, traces, count, 0, contentmask);
+
+	for (i = 0; i < count; i++)
+	{
+		traces[i].ent = ge->edicts;
+
+		if (traces[i].fraction == 0)
+		{
+			continue; /* blocked by the world */
+		}
+
+		memset(&clip, 0, sizeof(moveclip_t));
+
+		clip.trace = traces[i];
+		clip.contentmask = contentmask;
+		clip.start = rays[i].start;
+		clip.end = rays[i].end;
+		clip.mins = rays[i].mins;
+		clip.maxs = rays[i].maxs;
+		clip.passedict = passedict;
+
+		VectorCopy(rays[i].mins, clip.mins2);
+		VectorCopy(rays[i].maxs, clip.maxs2);
+
+		/* create the bounding box of the entire move */
+		SV_TraceBounds(rays[i].start, clip.mins2, clip.maxs2,
+			rays[i].end, clip.boxmins, clip.boxmaxs);
+
+		/* clip to other solid entities */
+		SV_ClipMoveToEntities(&clip);
+
+		traces[i] = clip.trace;
+	}
+}
@@ -389,6 +389,9 @@ void G_RunFrame(void)
 	level.framenum++;
 	level.time = level.framenum * FRAMETIME;
 
+	/* entities spawned or renamed during the last frame */
+	G_FlushFindIndex();
+
 	/* choose a client for monsters to target this frame */
 	AI_SetSightClient();
 
@@ -16,6 +16,302 @@ void G_ProjectSource(vec3_t point, vec3_t distance, vec3_t forward, vec3_t right
 	result[2] = point[2] + forward[2] * distance[0] + right[2] * distance[1] + distance[2];
 }
 
+/*
+ * Entities by classname and targetname, so G_Find
+ * only looks at the ones that can match. The buckets
+ * are built when a level starts. Entities spawned,
+ * freed or renamed since then are kept on a pending
+ * list that is searched too, and go to their buckets
+ * at the start of the next frame. Code that renames
+ * an entity calls G_IndexEdict(). Every candidate is
+ * checked against the field before it's returned.
+ */
+#define FIND_HASH_SIZE 1024
+#define FIND_NUMFIELDS 2
+
+typedef struct
+{
+	int fieldofs;
+	int first[FIND_HASH_SIZE]; /* lowest entity in each bucket, -1 for none */
+	int *next;
+	int *bucket; /* -1 when the entity isn't in the index */
+} findindex_t;
+
+static findindex_t find_index[FIND_NUMFIELDS];
+static int find_maxentities;
+static int *find_pending;
+static int find_numpending;
+static qboolean *find_ispending;
+
+static unsigned G_FindHash(const char *s)
+{
+	unsigned hash = 0;
+	int c;
+
+	/* case insensitive, like Q_stricmp */
+	while (*s)
+	{
+		c = (unsigned char)*s++;
+
+		if ((c >= 'A') && (c <= 'Z'))
+		{
+			c += 'a' - 'A';
+		}
+
+		hash = hash * 31 + c;
+	}
+
+	return (hash ^ (hash >> 16)) & (FIND_HASH_SIZE - 1);
+}
+
+static void G_UnindexField(findindex_t *index, int num)
+{
+	int *link;
+
+	if (index->bucket[num] < 0)
+	{
+		return;
+	}
+
+	link = &index->first[index->bucket[num]];
+
+	while (*link != num)
+	{
+		link = &index->next[*link];
+	}
+
+	*link = index->next[num];
+	index->bucket[num] = -1;
+}
+
+static void G_IndexField(findindex_t *index, int num, const char *s)
+{
+	int bucket;
+	int *link;
+
+	bucket = G_FindHash(s);
+
+	if (index->bucket[num] == bucket)
+	{
+		return;
+	}
+
+	G_UnindexField(index, num);
+
+	/* buckets are kept in entity order */
+	link = &index->first[bucket];
+
+	while ((*link >= 0) && (*link < num))
+	{
+		link = &index->next[*link];
+	}
+
+	index->next[num] = *link;
+	*link = num;
+	index->bucket[num] = bucket;
+}
+
+static void G_ReindexEdict(int num)
+{
+	edict_t *ent;
+	findindex_t *index;
+	char *s;
+	int i;
+
+	ent = &g_edicts[num];
+
+	for (i = 0; i < FIND_NUMFIELDS; i++)
+	{
+		index = &find_index[i];
+		s = ent->inuse ? *(char **)((byte *)ent + index->fieldofs) : NULL;
+
+		if (s)
+		{
+			G_IndexField(index, num, s);
+		}
+		else
+		{
+			G_UnindexField(index, num);
+		}
+	}
+}
+
+static qboolean G_FindMatches(findindex_t *index, edict_t *ent, const char *match)
+{
+	char *s;
+
+	if (!ent->inuse)
+	{
+		return false;
+	}
+
+	s = *(char **)((byte *)ent + index->fieldofs);
+
+	return s && !Q_stricmp(s, match);
+}
+
+static findindex_t* G_FindIndexFor(int fieldofs)
+{
+	int i;
+
+	if (!find_pending)
+	{
+		return NULL;
+	}
+
+	for (i = 0; i < FIND_NUMFIELDS; i++)
+	{
+		if (find_index[i].fieldofs == fieldofs)
+		{
+			return &find_index[i];
+		}
+	}
+
+	return NULL;
+}
+
+static edict_t* G_FindIndexed(findindex_t *index, edict_t *from, char *match)
+{
+	edict_t *best;
+	int start, num, i;
+
+	best = NULL;
+	start = from - g_edicts;
+
+	for (num = index->first[G_FindHash(match)]; num >= 0; num = index->next[num])
+	{
+		if (num >= globals.num_edicts)
+		{
+			break;
+		}
+
+		if ((num >= start) && G_FindMatches(index, &g_edicts[num], match))
+		{
+			best = &g_edicts[num];
+			break;
+		}
+	}
+
+	for (i = 0; i < find_numpending; i++)
+	{
+		num = find_pending[i];
+
+		if ((num < start) || (num >= globals.num_edicts) ||
+		    (best && (&g_edicts[num] >= best)))
+		{
+			continue;
+		}
+
+		if (G_FindMatches(index, &g_edicts[num], match))
+		{
+			best = &g_edicts[num];
+		}
+	}
+
+	return best;
+}
+
+static void G_ClearFindIndex(void)
+{
+	int i;
+
+	for (i = 0; i < FIND_NUMFIELDS; i++)
+	{
+		memset(find_index[i].first, -1, sizeof(find_index[i].first));
+		memset(find_index[i].bucket, -1, find_maxentities * sizeof(int));
+	}
+
+	memset(find_ispending, 0, find_maxentities * sizeof(qboolean));
+	find_numpending = 0;
+}
+
+/*
+ * Allocates the index, called whenever
+ * g_edicts is allocated.
+ */
+void G_InitFindIndex(void)
+{
+	int i;
+
+	find_maxentities = game.maxentities;
+	find_index[0].fieldofs = FOFS(classname);
+	find_index[1].fieldofs = FOFS(targetname);
+
+	for (i = 0; i < FIND_NUMFIELDS; i++)
+	{
+		find_index[i].next = gi.TagMalloc(find_maxentities * sizeof(int), TAG_GAME);
+		find_index[i].bucket = gi.TagMalloc(find_maxentities * sizeof(int), TAG_GAME);
+	}
+
+	find_pending = gi.TagMalloc(find_maxentities * sizeof(int), TAG_GAME);
+	find_ispending = gi.TagMalloc(find_maxentities * sizeof(qboolean), TAG_GAME);
+
+	G_ClearFindIndex();
+}
+
+/*
+ * Puts every entity in its buckets, called
+ * when the entities are replaced wholesale.
+ */
+void G_RebuildFindIndex(void)
+{
+	int i;
+
+	if (!find_pending)
+	{
+		return;
+	}
+
+	G_ClearFindIndex();
+
+	for (i = 0; i < globals.num_edicts; i++)
+	{
+		G_ReindexEdict(i);
+	}
+}
+
+/*
+ * Moves the pending entities to their
+ * buckets, called once a frame.
+ */
+void G_FlushFindIndex(void)
+{
+	int i, num;
+
+	for (i = 0; i < find_numpending; i++)
+	{
+		num = find_pending[i];
+		find_ispending[num] = false;
+		G_ReindexEdict(num);
+	}
+
+	find_numpending = 0;
+}
+
+/*
+ * Must be called when the classname or
+ * targetname of an entity changes.
+ */
+void G_IndexEdict(edict_t *ent)
+{
+	int num;
+
+	if (!find_pending || !ent)
+	{
+		return;
+	}
+
+	num = ent - g_edicts;
+
+	if (find_ispending[num])
+	{
+		return;
+	}
+
+	find_ispending[num] = true;
+	find_pending[find_numpending++] = num;
+}
+
 /*
  * Searches all active entities for the next one that holds
  * the matching string at fieldofs (use the FOFS() macro) in the structure.
@@ -25,6 +321,7 @@ void G_ProjectSource(vec3_t point, vec3_t distance, vec3_t forward, vec3_t right
  */
 edict_t* G_Find(edict_t *from, int fieldofs, char *match)
 {
+	findindex_t *index;
 	char *s;
 
 	if (!from)
@@ -36,6 +333,13 @@ edict_t* G_Find(edict_t *from, int fieldofs, char *match)
 		from++;
 	}
 
+	index = G_FindIndexFor(fieldofs);
+
+	if (index && match)
+	{
+		return G_FindIndexed(index, from, match);
+	}
+
 	for (; from < &g_edicts[globals.num_edicts]; from++)
 	{
 		if (!from->inuse)
@@ -60,46 +364,116 @@ edict_t* G_Find(edict_t *from, int fieldofs, char *match)
 }
 
 /*
- * Returns entities that have origins within a spherical area
+ * findradius collects the entities near org once per loop, sorted by
+ * number, and steps through that list on the following calls. The list
+ * is rebuilt whenever a loop starts, or when a nested loop around some
+ * other point replaced it. Each step checks the entity again, since the
+ * caller may have freed or moved it in the meantime.
  */
-edict_t* findradius(edict_t *from, vec3_t org, float rad)
+static edict_t *radius_list[MAX_EDICTS];
+static int radius_count;
+static vec3_t radius_org;
+static float radius_rad;
+
+static int RadiusCompare(const void *a, const void *b)
 {
-	vec3_t eorg;
-	int j;
+	edict_t *ea = *(edict_t **)a;
+	edict_t *eb = *(edict_t **)b;
 
-	if (!from)
+	return (ea > eb) - (ea < eb);
+}
+
+/*
+ * Returns the index of the first
+ * collected entity after from
+ */
+static int RadiusStart(edict_t *from, vec3_t org, float rad)
+{
+	vec3_t mins, maxs;
+	int j, lo, hi, mid;
+
+	if (!from || !VectorCompare(org, radius_org) || (rad != radius_rad))
 	{
-		from = g_edicts;
+		/* anything with its center within rad
+		   is linked with a box touching this one */
+		for (j = 0; j < 3; j++)
+		{
+			mins[j] = org[j] - rad;
+			maxs[j] = org[j] + rad;
+		}
+
+		radius_count = gi.BoxEdicts(mins, maxs, radius_list, MAX_EDICTS, AREA_SOLID);
+		radius_count += gi.BoxEdicts(mins, maxs, radius_list + radius_count, MAX_EDICTS - radius_count, AREA_TRIGGERS);
+
+		/* return them lowest numbered first,
+		   like a scan over all entities would */
+		qsort(radius_list, radius_count, sizeof(radius_list[0]), RadiusCompare);
+
+		VectorCopy(org, radius_org);
+		radius_rad = rad;
 	}
-	else
+
+	if (!from)
 	{
-		from++;
+		return 0;
 	}
 
-	for (; from < &g_edicts[globals.num_edicts]; from++)
+	lo = 0;
+	hi = radius_count;
+
+	while (lo < hi)
 	{
-		if (!from->inuse)
-		{
-			continue;
-		}
+		mid = (lo + hi) / 2;
 
-		if (from->solid == SOLID_NOT)
+		if (radius_list[mid] <= from)
 		{
-			continue;
+			lo = mid + 1;
 		}
-
-		for (j = 0; j < 3; j++)
+		else
 		{
-			eorg[j] = org[j] - (from->s.origin[j] +
-			                    (from->mins[j] + from->maxs[j]) * 0.5f);
+			hi = mid;
 		}
+	}
+
+	return lo;
+}
 
-		if (VectorLength(eorg) > rad)
+static qboolean RadiusCheck(edict_t *check, vec3_t org, float rad)
+{
+	vec3_t eorg;
+	int j;
+
+	if (!check->inuse)
+	{
+		return false;
+	}
+
+	if (check->solid == SOLID_NOT)
+	{
+		return false;
+	}
+
+	for (j = 0; j < 3; j++)
+	{
+		eorg[j] = org[j] - (check->s.origin[j] + (check->mins[j] + check->maxs[j]) * 0.5f);
+	}
+
+	return VectorLength(eorg) <= rad;
+}
+
+/*
+ * Returns entities that have origins within a spherical area
+ */
+edict_t* findradius(edict_t *from, vec3_t org, float rad)
+{
+	int i;
+
+	for (i = RadiusStart(from, org, rad); i < radius_count; i++)
+	{
+		if (RadiusCheck(radius_list[i], org, rad))
 		{
-			continue;
+			return radius_list[i];
 		}
-
-		return from;
 	}
 
 	return NULL;
@@ -435,6 +809,8 @@ void G_InitEdict(edict_t *e)
 	e->classname = "noclass";
 	e->gravity = 1.0f;
 	e->s.number = e - g_edicts;
+
+	G_IndexEdict(e);
 }
 
 /*
@@ -488,6 +864,8 @@ void G_FreeEdict(edict_t *ed)
 	ed->classname = "freed";
 	ed->freetime = level.time;
 	ed->inuse = false;
+
+	G_IndexEdict(ed);
 }
 
 void G_TouchTriggers(edict_t *ent)
@@ -245,6 +245,7 @@ InitGame(void)
 	game.maxentities = maxentities->value;
 	g_edicts =  gi.TagMalloc (game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_InitFindIndex();
 	globals.max_edicts = game.maxentities;
 
 	/* initialize all clients for this game */
@@ -872,6 +873,7 @@ ReadGame(const char *filename)
 
 	g_edicts = gi.TagMalloc(game.maxentities * sizeof(g_edicts[0]), TAG_GAME);
 	globals.edicts = g_edicts;
+	G_InitFindIndex();
 
 	fread(&game, sizeof(game), 1, f);
 	game.clients = gi.TagMalloc(game.maxclients * sizeof(game.clients[0]),
@@ -1132,5 +1134,7 @@ ReadLevel(const char *filename)
 			}
 		}
 	}
+
+	G_RebuildFindIndex();
 }
 